@@ -0,0 +1,216 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanBindlessTextures.h"
+#include "VulkanTools.h"
+#include "VulkanInitializer.hpp"
+
+#include <algorithm>
+
+VulkanBindlessTextures::VulkanBindlessTextures(VulkanDevice *pDevice,
+                                               uint32_t maxFramesInFlight,
+                                               uint32_t maxTextureCount,
+                                               const VkAllocationCallbacks *pAllocator)
+{
+    if (pDevice == nullptr || pDevice->GetDevice() == VK_NULL_HANDLE)
+    {
+        FATAL("Bindless textures must be created with a valid device!");
+    }
+    if (!pDevice->DescriptorIndexingSupport())
+    {
+        FATAL("Bindless textures need descriptor indexing!");
+    }
+    if (maxFramesInFlight == 0 || maxTextureCount == 0)
+    {
+        FATAL("Bindless texture capacity must not be 0!");
+    }
+    p_Device = pDevice;
+    p_Allocator = pAllocator;
+    m_MaxFramesInFlight = maxFramesInFlight;
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 GPUProperties2{};
+    GPUProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    GPUProperties2.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(p_Device->GetGPU(), &GPUProperties2);
+    // Every combined image sampler counts against both the sampled image and the sampler limits
+    m_MaxTextureCount = (std::min)({maxTextureCount,
+                                    indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                    indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                    indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                    indexingProperties.maxDescriptorSetUpdateAfterBindSamplers});
+    if (m_MaxTextureCount < maxTextureCount)
+    {
+        WARNING("Bindless texture count %u exceeds the device limit, clamped to %u!\n", maxTextureCount, m_MaxTextureCount);
+    }
+
+    VkDescriptorSetLayoutBinding binding = vkinfo::SetLayoutBinding(0, m_MaxTextureCount, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+    // Unregistered elements are never written, so the array is partially bound
+    VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCI{};
+    bindingFlagsCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsCI.bindingCount = 1;
+    bindingFlagsCI.pBindingFlags = &bindingFlags;
+    VkDescriptorSetLayoutCreateInfo setLayoutCI = vkinfo::SetLayoutInfo();
+    setLayoutCI.pNext = &bindingFlagsCI;
+    setLayoutCI.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    setLayoutCI.bindingCount = 1;
+    setLayoutCI.pBindings = &binding;
+    CHECK_VK_RESULT(vkCreateDescriptorSetLayout(p_Device->GetDevice(), &setLayoutCI, p_Allocator, &m_SetLayout));
+
+    VkDescriptorPoolSize poolSize = vkinfo::PoolSize(m_MaxTextureCount * m_MaxFramesInFlight, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    VkDescriptorPoolCreateInfo poolCI = vkinfo::DescripotrPoolInfo(m_MaxFramesInFlight);
+    poolCI.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolCI.poolSizeCount = 1;
+    poolCI.pPoolSizes = &poolSize;
+    CHECK_VK_RESULT(vkCreateDescriptorPool(p_Device->GetDevice(), &poolCI, p_Allocator, &m_DescriptorPool));
+
+    m_Sets.resize(m_MaxFramesInFlight, VK_NULL_HANDLE);
+    std::vector<VkDescriptorSetLayout> setLayouts(m_MaxFramesInFlight, m_SetLayout);
+    VkDescriptorSetAllocateInfo allocInfo = vkinfo::DescriptorSetAllocateInfo(m_DescriptorPool, setLayouts.data(), setLayouts.size());
+    CHECK_VK_RESULT(vkAllocateDescriptorSets(p_Device->GetDevice(), &allocInfo, m_Sets.data()));
+
+    m_DirtyIndices.resize(m_MaxFramesInFlight);
+}
+
+VulkanBindlessTextures::~VulkanBindlessTextures()
+{
+    if (m_DescriptorPool != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorPool(p_Device->GetDevice(), m_DescriptorPool, p_Allocator);
+    }
+    if (m_SetLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorSetLayout(p_Device->GetDevice(), m_SetLayout, p_Allocator);
+    }
+}
+
+uint32_t VulkanBindlessTextures::Add(const VulkanTexture *pTexture)
+{
+    if (pTexture == nullptr)
+    {
+        FATAL("Can not add an empty texture to bindless textures!");
+    }
+    auto it = m_Indices.find(pTexture);
+    if (it != m_Indices.end())
+    {
+        return it->second;
+    }
+
+    uint32_t index = 0U;
+    if (!m_FreeIndices.empty())
+    {
+        index = m_FreeIndices.back();
+        m_FreeIndices.pop_back();
+        m_Textures[index] = pTexture;
+    }
+    else if (m_Textures.size() < m_MaxTextureCount)
+    {
+        index = static_cast<uint32_t>(m_Textures.size());
+        m_Textures.push_back(pTexture);
+    }
+    else
+    {
+        FATAL("Bindless textures are full! Capacity: %u", m_MaxTextureCount);
+    }
+    m_Indices.emplace(pTexture, index);
+    for (auto &dirtyIndices : m_DirtyIndices)
+    {
+        dirtyIndices.push_back(index);
+    }
+
+    return index;
+}
+
+void VulkanBindlessTextures::Remove(const VulkanTexture *pTexture)
+{
+    auto it = m_Indices.find(pTexture);
+    if (it == m_Indices.end())
+    {
+        return;
+    }
+
+    // The stale descriptor is left in place, partially bound elements are valid as long as shaders do not sample them
+    m_Textures[it->second] = nullptr;
+    m_FreeIndices.push_back(it->second);
+    m_Indices.erase(it);
+}
+
+void VulkanBindlessTextures::Refresh(const VulkanTexture *pTexture)
+{
+    auto it = m_Indices.find(pTexture);
+    if (it == m_Indices.end())
+    {
+        return;
+    }
+
+    for (auto &dirtyIndices : m_DirtyIndices)
+    {
+        dirtyIndices.push_back(it->second);
+    }
+}
+
+void VulkanBindlessTextures::Flush(uint32_t currentFrame)
+{
+    std::vector<uint32_t> &dirtyIndices = m_DirtyIndices[currentFrame];
+    if (dirtyIndices.empty())
+    {
+        return;
+    }
+
+    std::sort(dirtyIndices.begin(), dirtyIndices.end());
+    dirtyIndices.erase(std::unique(dirtyIndices.begin(), dirtyIndices.end()), dirtyIndices.end());
+    std::vector<VkWriteDescriptorSet> writes = {};
+    writes.reserve(dirtyIndices.size());
+    for (uint32_t index : dirtyIndices)
+    {
+        // Removed before the slot caught up
+        const VulkanTexture *pTexture = m_Textures[index];
+        if (pTexture == nullptr || pTexture->View == VK_NULL_HANDLE)
+        {
+            continue;
+        }
+        VkWriteDescriptorSet write = vkinfo::DescriptorWriteInfo(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_Sets[currentFrame], 0, index, 1);
+        write.pImageInfo = &pTexture->DescriptorImageInfo;
+        writes.push_back(write);
+    }
+    if (!writes.empty())
+    {
+        vkUpdateDescriptorSets(p_Device->GetDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+    dirtyIndices.clear();
+}
+
+void VulkanBindlessTextures::Bind(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t setIndex, uint32_t currentFrame)
+{
+    vkCmdBindDescriptorSets(cmdBuffer, bindPoint, layout, setIndex, 1, &m_Sets[currentFrame], 0, nullptr);
+}
+
+uint32_t VulkanBindlessTextures::GetIndex(const VulkanTexture *pTexture) const
+{
+    auto it = m_Indices.find(pTexture);
+    if (it == m_Indices.end())
+    {
+        FATAL("Texture %p is not registered to bindless textures!", pTexture);
+    }
+
+    return it->second;
+}
@@ -0,0 +1,92 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_BINDLESS_TEXTURES_HEADER
+#define VULKAN_BINDLESS_TEXTURES_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "VulkanDevice.h"
+#include "VulkanTexture.h"
+
+#include <vector>
+#include <unordered_map>
+
+/**
+ * @brief Global texture table, a partially bound, update-after-bind array of combined image samplers at binding 0
+ * indexed by material or draw parameters in shaders, e.g. textures[nonuniformEXT(index)].
+ * @note Each frame slot has its own set. Changes are queued for every slot and written by Flush once the slot is idle,
+ * so descriptors sampled by frames in flight are never touched.
+ */
+class DVAPI_ATTR VulkanBindlessTextures final
+{
+private:
+    VulkanDevice *p_Device = nullptr;
+    const VkAllocationCallbacks *p_Allocator = nullptr;
+    uint32_t m_MaxFramesInFlight = 0U;
+    uint32_t m_MaxTextureCount = 0U;
+    // Registered texture of each array element, nullptr for free elements
+    std::vector<const VulkanTexture *> m_Textures = {};
+    std::vector<uint32_t> m_FreeIndices = {};
+    std::unordered_map<const VulkanTexture *, uint32_t> m_Indices = {};
+    // Array elements out of date in the set of each frame slot
+    std::vector<std::vector<uint32_t>> m_DirtyIndices = {};
+
+public:
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_Sets = {};
+
+public:
+    /**
+     * @param maxTextureCount The array size, clamped to the update-after-bind sampled image limits of the device.
+     * @note The device must support descriptor indexing, see VulkanDevice::DescriptorIndexingSupport.
+     */
+    explicit VulkanBindlessTextures(VulkanDevice *pDevice,
+                                    uint32_t maxFramesInFlight,
+                                    uint32_t maxTextureCount,
+                                    const VkAllocationCallbacks *pAllocator = nullptr);
+    ~VulkanBindlessTextures();
+    VulkanBindlessTextures(const VulkanBindlessTextures &) = delete;
+    VulkanBindlessTextures &operator=(const VulkanBindlessTextures &) = delete;
+    VulkanBindlessTextures(VulkanBindlessTextures &&) = delete;
+    VulkanBindlessTextures &operator=(VulkanBindlessTextures &&) = delete;
+
+    /**
+     * @brief Register the texture, the texture object must stay at the same address until it is removed.
+     * @return The array index, the same index if the texture is registered already.
+     */
+    uint32_t Add(const VulkanTexture *pTexture);
+    // Free the array index of the texture for reuse, nothing happens if the texture is not registered
+    void Remove(const VulkanTexture *pTexture);
+    // Queue a rewrite of the texture descriptor after its image, view or sampler changed, nothing happens if the texture is not registered
+    void Refresh(const VulkanTexture *pTexture);
+    // Write the queued descriptors of the frame slot, call it after the slot fence is signaled and before recording
+    void Flush(uint32_t currentFrame);
+    void Bind(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t setIndex, uint32_t currentFrame);
+
+    // The array index of a registered texture
+    uint32_t GetIndex(const VulkanTexture *pTexture) const;
+    inline uint32_t GetTextureCount() const { return static_cast<uint32_t>(m_Indices.size()); }
+    inline uint32_t GetMaxTextureCount() const { return m_MaxTextureCount; }
+};
+
+#endif
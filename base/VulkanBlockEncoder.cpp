@@ -0,0 +1,632 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanBlockEncoder.h"
+#include "VulkanTools.h"
+
+#include "stb_image.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <future>
+#include <vector>
+
+namespace
+{
+    // BC7 4-bit index weights
+    const uint32_t BC7_WEIGHTS[16] = {0U, 4U, 9U, 13U, 17U, 21U, 26U, 30U, 34U, 38U, 43U, 47U, 51U, 55U, 60U, 64U};
+
+    struct BitWriter
+    {
+        uint8_t *pDst = nullptr;
+        uint32_t Bit = 0U;
+
+        // Write count bits of value, least significant bit first
+        void Write(uint32_t value, uint32_t count)
+        {
+            for (uint32_t i = 0; i < count; ++i, ++Bit)
+            {
+                if ((value >> i) & 1U)
+                {
+                    pDst[Bit >> 3U] |= static_cast<uint8_t>(1U << (Bit & 7U));
+                }
+            }
+        }
+    };
+
+    /**
+     * @brief Fit the line through the texels with the largest variance and return its end points.
+     * @param pMask Texels taking part in the fit, nullptr for all.
+     */
+    void FitLine(const float (*texels)[4], const bool *pMask, uint32_t channels, float e0[4], float e1[4])
+    {
+        float mean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float count = 0.0f;
+        for (uint32_t i = 0; i < 16U; ++i)
+        {
+            if (pMask == nullptr || pMask[i])
+            {
+                for (uint32_t c = 0; c < channels; ++c)
+                {
+                    mean[c] += texels[i][c];
+                }
+                count += 1.0f;
+            }
+        }
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            mean[c] /= count;
+        }
+
+        float covariance[4][4] = {};
+        for (uint32_t i = 0; i < 16U; ++i)
+        {
+            if (pMask == nullptr || pMask[i])
+            {
+                for (uint32_t r = 0; r < channels; ++r)
+                {
+                    for (uint32_t c = 0; c < channels; ++c)
+                    {
+                        covariance[r][c] += (texels[i][r] - mean[r]) * (texels[i][c] - mean[c]);
+                    }
+                }
+            }
+        }
+
+        // Power iteration for the principal axis
+        float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        for (uint32_t iteration = 0; iteration < 8U; ++iteration)
+        {
+            float next[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            float length = 0.0f;
+            for (uint32_t r = 0; r < channels; ++r)
+            {
+                for (uint32_t c = 0; c < channels; ++c)
+                {
+                    next[r] += covariance[r][c] * axis[c];
+                }
+                length += next[r] * next[r];
+            }
+            if (length < 1e-12f)
+            {
+                break;
+            }
+            length = 1.0f / std::sqrt(length);
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                axis[c] = next[c] * length;
+            }
+        }
+
+        float minT = 0.0f, maxT = 0.0f;
+        for (uint32_t i = 0; i < 16U; ++i)
+        {
+            if (pMask == nullptr || pMask[i])
+            {
+                float t = 0.0f;
+                for (uint32_t c = 0; c < channels; ++c)
+                {
+                    t += (texels[i][c] - mean[c]) * axis[c];
+                }
+                minT = (std::min)(minT, t);
+                maxT = (std::max)(maxT, t);
+            }
+        }
+        // Inset the end points a little, the extreme texels are rarely worth a whole palette entry
+        const float inset = (maxT - minT) / 32.0f;
+        minT += inset;
+        maxT -= inset;
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            e0[c] = (std::min)((std::max)(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+            e1[c] = (std::min)((std::max)(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+        }
+    }
+
+    /**
+     * @brief Least squares end points for fixed interpolation weights.
+     * @return false if the weights do not determine both end points.
+     */
+    bool RefineLine(const float (*texels)[4], const float *weights, const bool *pMask, uint32_t channels, float e0[4], float e1[4])
+    {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float bx[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (uint32_t i = 0; i < 16U; ++i)
+        {
+            if (pMask == nullptr || pMask[i])
+            {
+                const float b = weights[i];
+                const float a = 1.0f - b;
+                aa += a * a;
+                ab += a * b;
+                bb += b * b;
+                for (uint32_t c = 0; c < channels; ++c)
+                {
+                    ax[c] += a * texels[i][c];
+                    bx[c] += b * texels[i][c];
+                }
+            }
+        }
+
+        const float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f)
+        {
+            return false;
+        }
+        const float inverse = 1.0f / determinant;
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            e0[c] = (std::min)((std::max)((bb * ax[c] - ab * bx[c]) * inverse, 0.0f), 255.0f);
+            e1[c] = (std::min)((std::max)((aa * bx[c] - ab * ax[c]) * inverse, 0.0f), 255.0f);
+        }
+        return true;
+    }
+
+    struct BC1Block
+    {
+        uint16_t Color0 = 0U;
+        uint16_t Color1 = 0U;
+        uint32_t Indices = 0U;
+        float Error = 0.0f;
+        // Interpolation weight of each texel towards Color1
+        float Weights[16] = {};
+    };
+
+    inline uint16_t PackRGB565(const float color[4])
+    {
+        const uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+        const uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+        const uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+        return static_cast<uint16_t>((r << 11U) | (g << 5U) | b);
+    }
+
+    inline void UnpackRGB565(uint16_t packed, float color[3])
+    {
+        const uint32_t r = (packed >> 11U) & 31U;
+        const uint32_t g = (packed >> 5U) & 63U;
+        const uint32_t b = packed & 31U;
+        color[0] = static_cast<float>((r << 3U) | (r >> 2U));
+        color[1] = static_cast<float>((g << 2U) | (g >> 4U));
+        color[2] = static_cast<float>((b << 3U) | (b >> 2U));
+    }
+
+    BC1Block QuantizeBC1(const float (*texels)[4], const bool *pTransparent, bool threeColor, const float e0[4], const float e1[4])
+    {
+        BC1Block block{};
+        block.Color0 = PackRGB565(e0);
+        block.Color1 = PackRGB565(e1);
+        // Color0 > Color1 selects the 4 color mode, otherwise the 3 color mode with transparent black
+        if ((threeColor && block.Color0 > block.Color1) || (!threeColor && block.Color0 < block.Color1))
+        {
+            std::swap(block.Color0, block.Color1);
+        }
+        threeColor = block.Color0 <= block.Color1;
+
+        float palette[4][3] = {};
+        UnpackRGB565(block.Color0, palette[0]);
+        UnpackRGB565(block.Color1, palette[1]);
+        const float paletteWeights[4] = {0.0f, 1.0f, threeColor ? 0.5f : 1.0f / 3.0f, threeColor ? 0.0f : 2.0f / 3.0f};
+        for (uint32_t c = 0; c < 3U; ++c)
+        {
+            if (threeColor)
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) * 0.5f;
+            }
+            else
+            {
+                palette[2][c] = (palette[0][c] * 2.0f + palette[1][c]) / 3.0f;
+                palette[3][c] = (palette[0][c] + palette[1][c] * 2.0f) / 3.0f;
+            }
+        }
+
+        const uint32_t colorCount = threeColor ? 3U : 4U;
+        for (uint32_t i = 0; i < 16U; ++i)
+        {
+            uint32_t bestIndex = 0U;
+            if (pTransparent != nullptr && pTransparent[i])
+            {
+                bestIndex = 3U;
+            }
+            else
+            {
+                float bestError = 1e30f;
+                for (uint32_t p = 0; p < colorCount; ++p)
+                {
+                    float error = 0.0f;
+                    for (uint32_t c = 0; c < 3U; ++c)
+                    {
+                        const float d = texels[i][c] - palette[p][c];
+                        error += d * d;
+                    }
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        bestIndex = p;
+                    }
+                }
+                block.Error += bestError;
+            }
+            block.Indices |= bestIndex << (i * 2U);
+            block.Weights[i] = paletteWeights[bestIndex];
+        }
+        return block;
+    }
+
+    struct BC7Block
+    {
+        uint32_t Endpoints[2][4] = {};
+        uint32_t PBits[2] = {};
+        uint32_t Indices[16] = {};
+        float Error = 0.0f;
+    };
+
+    BC7Block QuantizeBC7(const float (*texels)[4], const float e0[4], const float e1[4])
+    {
+        BC7Block block{};
+        const float *pEndpoints[2] = {e0, e1};
+        // Mode 6 end points are 7 bits per channel plus one shared p-bit per end point
+        for (uint32_t e = 0; e < 2U; ++e)
+        {
+            float bestError = 1e30f;
+            for (uint32_t p = 0; p < 2U; ++p)
+            {
+                float error = 0.0f;
+                uint32_t quantized[4] = {};
+                for (uint32_t c = 0; c < 4U; ++c)
+                {
+                    const int32_t q = static_cast<int32_t>(std::floor((pEndpoints[e][c] - static_cast<float>(p)) * 0.5f + 0.5f));
+                    quantized[c] = static_cast<uint32_t>((std::min)((std::max)(q, 0), 127));
+                    const float d = pEndpoints[e][c] - static_cast<float>((quantized[c] << 1U) | p);
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    block.PBits[e] = p;
+                    std::copy(quantized, quantized + 4, block.Endpoints[e]);
+                }
+            }
+        }
+
+        uint32_t endpoints[2][4] = {};
+        for (uint32_t e = 0; e < 2U; ++e)
+        {
+            for (uint32_t c = 0; c < 4U; ++c)
+            {
+                endpoints[e][c] = (block.Endpoints[e][c] << 1U) | block.PBits[e];
+            }
+        }
+        float palette[16][4] = {};
+        for (uint32_t p = 0; p < 16U; ++p)
+        {
+            for (uint32_t c = 0; c < 4U; ++c)
+            {
+                palette[p][c] = static_cast<float>(((64U - BC7_WEIGHTS[p]) * endpoints[0][c] + BC7_WEIGHTS[p] * endpoints[1][c] + 32U) >> 6U);
+            }
+        }
+
+        for (uint32_t i = 0; i < 16U; ++i)
+        {
+            float bestError = 1e30f;
+            for (uint32_t p = 0; p < 16U; ++p)
+            {
+                float error = 0.0f;
+                for (uint32_t c = 0; c < 4U; ++c)
+                {
+                    const float d = texels[i][c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    block.Indices[i] = p;
+                }
+            }
+            block.Error += bestError;
+        }
+
+        // The most significant bit of the first index is implied zero, swap the end points to clear it
+        if (block.Indices[0] & 8U)
+        {
+            std::swap(block.Endpoints[0], block.Endpoints[1]);
+            std::swap(block.PBits[0], block.PBits[1]);
+            for (uint32_t i = 0; i < 16U; ++i)
+            {
+                block.Indices[i] = 15U - block.Indices[i];
+            }
+        }
+        return block;
+    }
+
+    inline void LoadBlock(const uint8_t *pBlock, float texels[16][4])
+    {
+        for (uint32_t i = 0; i < 16U; ++i)
+        {
+            for (uint32_t c = 0; c < 4U; ++c)
+            {
+                texels[i][c] = static_cast<float>(pBlock[i * 4U + c]);
+            }
+        }
+    }
+
+    inline float SRGBToLinear(float value)
+    {
+        value /= 255.0f;
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    inline uint8_t LinearToSRGB(float value)
+    {
+        value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>((std::min)((std::max)(value * 255.0f + 0.5f, 0.0f), 255.0f));
+    }
+
+    // Box filter the image to half its extent, color channels of sRGB images are averaged in linear space
+    std::vector<uint8_t> Downsample(const std::vector<uint8_t> &src, uint32_t width, uint32_t height, bool srgb)
+    {
+        static const std::vector<float> s_SRGBToLinear = []() -> std::vector<float>
+        {
+            std::vector<float> table(256U);
+            for (uint32_t i = 0; i < 256U; ++i)
+            {
+                table[i] = SRGBToLinear(static_cast<float>(i));
+            }
+            return table;
+        }();
+
+        const uint32_t dstWidth = (std::max)(width / 2U, 1U);
+        const uint32_t dstHeight = (std::max)(height / 2U, 1U);
+        std::vector<uint8_t> dst(static_cast<size_t>(dstWidth) * dstHeight * 4U);
+        for (uint32_t y = 0; y < dstHeight; ++y)
+        {
+            const uint32_t y0 = (std::min)(y * 2U, height - 1U);
+            const uint32_t y1 = (std::min)(y * 2U + 1U, height - 1U);
+            for (uint32_t x = 0; x < dstWidth; ++x)
+            {
+                const uint32_t x0 = (std::min)(x * 2U, width - 1U);
+                const uint32_t x1 = (std::min)(x * 2U + 1U, width - 1U);
+                const uint8_t *pTexels[4] = {&src[(static_cast<size_t>(y0) * width + x0) * 4U],
+                                             &src[(static_cast<size_t>(y0) * width + x1) * 4U],
+                                             &src[(static_cast<size_t>(y1) * width + x0) * 4U],
+                                             &src[(static_cast<size_t>(y1) * width + x1) * 4U]};
+                uint8_t *pDst = &dst[(static_cast<size_t>(y) * dstWidth + x) * 4U];
+                for (uint32_t c = 0; c < 4U; ++c)
+                {
+                    if (srgb && c < 3U)
+                    {
+                        const float sum = s_SRGBToLinear[pTexels[0][c]] + s_SRGBToLinear[pTexels[1][c]] + s_SRGBToLinear[pTexels[2][c]] + s_SRGBToLinear[pTexels[3][c]];
+                        pDst[c] = LinearToSRGB(sum * 0.25f);
+                    }
+                    else
+                    {
+                        pDst[c] = static_cast<uint8_t>((pTexels[0][c] + pTexels[1][c] + pTexels[2][c] + pTexels[3][c] + 2U) >> 2U);
+                    }
+                }
+            }
+        }
+        return dst;
+    }
+}
+
+void VulkanBlockEncoder::EncodeBC1(const uint8_t *pBlock, uint8_t *pDst, bool punchThroughAlpha)
+{
+    float texels[16][4] = {};
+    LoadBlock(pBlock, texels);
+
+    bool transparent[16] = {};
+    bool opaque[16] = {};
+    bool anyTransparent = false, anyOpaque = false;
+    for (uint32_t i = 0; i < 16U; ++i)
+    {
+        transparent[i] = punchThroughAlpha && pBlock[i * 4U + 3U] < 128U;
+        opaque[i] = !transparent[i];
+        anyTransparent = anyTransparent || transparent[i];
+        anyOpaque = anyOpaque || opaque[i];
+    }
+
+    BC1Block block{};
+    if (!anyOpaque)
+    {
+        // Equal colors select the 3 color mode, index 3 is transparent black
+        block.Indices = 0xFFFFFFFFU;
+    }
+    else
+    {
+        float e0[4] = {}, e1[4] = {};
+        FitLine(texels, opaque, 3U, e0, e1);
+        block = QuantizeBC1(texels, anyTransparent ? transparent : nullptr, anyTransparent, e0, e1);
+        if (RefineLine(texels, block.Weights, opaque, 3U, e0, e1))
+        {
+            BC1Block refined = QuantizeBC1(texels, anyTransparent ? transparent : nullptr, anyTransparent, e0, e1);
+            if (refined.Error < block.Error)
+            {
+                block = refined;
+            }
+        }
+    }
+
+    memcpy(pDst, &block.Color0, sizeof(uint16_t));
+    memcpy(pDst + 2, &block.Color1, sizeof(uint16_t));
+    memcpy(pDst + 4, &block.Indices, sizeof(uint32_t));
+}
+
+void VulkanBlockEncoder::EncodeBC7(const uint8_t *pBlock, uint8_t *pDst)
+{
+    float texels[16][4] = {};
+    LoadBlock(pBlock, texels);
+
+    float e0[4] = {}, e1[4] = {};
+    FitLine(texels, nullptr, 4U, e0, e1);
+    BC7Block block = QuantizeBC7(texels, e0, e1);
+
+    float weights[16] = {};
+    for (uint32_t i = 0; i < 16U; ++i)
+    {
+        weights[i] = static_cast<float>(BC7_WEIGHTS[block.Indices[i]]) / 64.0f;
+    }
+    // The weights refer to the swapped end points, which is fine for the fit
+    if (RefineLine(texels, weights, nullptr, 4U, e0, e1))
+    {
+        BC7Block refined = QuantizeBC7(texels, e0, e1);
+        if (refined.Error < block.Error)
+        {
+            block = refined;
+        }
+    }
+
+    memset(pDst, 0, 16U);
+    BitWriter writer{pDst, 0U};
+    // Mode 6
+    writer.Write(1U << 6U, 7U);
+    for (uint32_t c = 0; c < 4U; ++c)
+    {
+        writer.Write(block.Endpoints[0][c], 7U);
+        writer.Write(block.Endpoints[1][c], 7U);
+    }
+    writer.Write(block.PBits[0], 1U);
+    writer.Write(block.PBits[1], 1U);
+    writer.Write(block.Indices[0], 3U);
+    for (uint32_t i = 1; i < 16U; ++i)
+    {
+        writer.Write(block.Indices[i], 4U);
+    }
+}
+
+void VulkanBlockEncoder::EncodeImage(const uint8_t *pPixels, uint32_t width, uint32_t height, VkFormat format, uint8_t *pDst, VulkanThreadPool *pThreadPool)
+{
+    bool bc7 = false, punchThroughAlpha = false;
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        break;
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        punchThroughAlpha = true;
+        break;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        bc7 = true;
+        break;
+    default:
+        FATAL("Block encoder does not support format %u!", static_cast<uint32_t>(format));
+    }
+
+    const uint32_t blockSize = VulkanKTX2::GetBlockSize(format);
+    const uint32_t blockCountX = (width + 3U) / 4U;
+    const uint32_t blockCountY = (height + 3U) / 4U;
+    auto encodeRow = [=](uint32_t by) -> void
+    {
+        uint8_t texels[64] = {};
+        for (uint32_t bx = 0; bx < blockCountX; ++bx)
+        {
+            for (uint32_t y = 0; y < 4U; ++y)
+            {
+                const uint32_t sy = (std::min)(by * 4U + y, height - 1U);
+                for (uint32_t x = 0; x < 4U; ++x)
+                {
+                    const uint32_t sx = (std::min)(bx * 4U + x, width - 1U);
+                    memcpy(texels + (y * 4U + x) * 4U, pPixels + (static_cast<size_t>(sy) * width + sx) * 4U, 4U);
+                }
+            }
+            uint8_t *pBlock = pDst + (static_cast<size_t>(by) * blockCountX + bx) * blockSize;
+            if (bc7)
+            {
+                EncodeBC7(texels, pBlock);
+            }
+            else
+            {
+                EncodeBC1(texels, pBlock, punchThroughAlpha);
+            }
+        }
+    };
+
+    if (pThreadPool == nullptr)
+    {
+        for (uint32_t by = 0; by < blockCountY; ++by)
+        {
+            encodeRow(by);
+        }
+        return;
+    }
+
+    std::vector<std::future<void>> futures = {};
+    futures.reserve(blockCountY);
+    for (uint32_t by = 0; by < blockCountY; ++by)
+    {
+        futures.push_back(pThreadPool->Enqueue(encodeRow, by));
+    }
+    for (std::future<void> &future : futures)
+    {
+        future.get();
+    }
+}
+
+void VulkanBlockEncoder::Cook(const std::string &srcPath,
+                              const std::string &dstPath,
+                              VkFormat format,
+                              bool generateMipmap,
+                              bool flipVerticallyOnLoad,
+                              VulkanThreadPool *pThreadPool)
+{
+    int width, height, channel;
+    stbi_set_flip_vertically_on_load_thread(flipVerticallyOnLoad);
+    stbi_uc *pixels = stbi_load(srcPath.c_str(), &width, &height, &channel, 4);
+    if (pixels == nullptr)
+    {
+        FATAL("Failed to load texture at %s!", srcPath.c_str());
+    }
+    std::vector<uint8_t> level(pixels, pixels + static_cast<size_t>(width) * height * 4U);
+    stbi_image_free(pixels);
+
+    VulkanKTX2 image{};
+    image.Format = format;
+    image.Width = static_cast<uint32_t>(width);
+    image.Height = static_cast<uint32_t>(height);
+    const uint32_t levelCount = generateMipmap ? static_cast<uint32_t>(std::floor(std::log2((std::max)(width, height))) + 1) : 1U;
+    VkDeviceSize dataSize = 0U;
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        VulkanKTX2::Level range{};
+        range.Offset = dataSize;
+        range.Size = VulkanKTX2::GetImageSize(format, (std::max)(image.Width >> i, 1U), (std::max)(image.Height >> i, 1U));
+        image.Levels.push_back(range);
+        dataSize += range.Size;
+    }
+    image.Data.resize(static_cast<size_t>(dataSize));
+
+    const bool srgb = format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+    uint32_t levelWidth = image.Width, levelHeight = image.Height;
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        EncodeImage(level.data(), levelWidth, levelHeight, format, image.Data.data() + image.Levels[i].Offset, pThreadPool);
+        if (i + 1U < levelCount)
+        {
+            level = Downsample(level, levelWidth, levelHeight, srgb);
+            levelWidth = (std::max)(levelWidth / 2U, 1U);
+            levelHeight = (std::max)(levelHeight / 2U, 1U);
+        }
+    }
+
+    image.Save(dstPath);
+    INFO("Cooked %s into %s with %u mip levels.\n", srcPath.c_str(), dstPath.c_str(), levelCount);
+}
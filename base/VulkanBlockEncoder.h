@@ -0,0 +1,70 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_BLOCK_ENCODER_HEADER
+#define VULKAN_BLOCK_ENCODER_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "VulkanKTX2.h"
+#include "VulkanThreadPool.h"
+#include "vulkan/vulkan.h"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief CPU encoder of BC1 and BC7 (mode 6) blocks for offline texture cooking.
+ * @note Endpoints come from the principal axis of the block and are refined once by least squares,
+ * the quality is meant for cooking, not for real-time encoding.
+ */
+class DVAPI_ATTR VulkanBlockEncoder final
+{
+public:
+    VulkanBlockEncoder() = delete;
+
+    /**
+     * @brief Encode one 4x4 block.
+     * @param pBlock 16 RGBA8 texels, row by row.
+     * @param pDst 8 bytes for BC1, 16 bytes for BC7.
+     * @param punchThroughAlpha BC1 only, texels with alpha below 128 become transparent.
+     */
+    static void EncodeBC1(const uint8_t *pBlock, uint8_t *pDst, bool punchThroughAlpha = false);
+    static void EncodeBC7(const uint8_t *pBlock, uint8_t *pDst);
+    /**
+     * @brief Encode an RGBA8 image into BC1 or BC7 blocks, the edge texels are repeated for extents not a multiple of 4.
+     * @param pThreadPool Encode rows of blocks on the pool if not nullptr.
+     */
+    static void EncodeImage(const uint8_t *pPixels, uint32_t width, uint32_t height, VkFormat format, uint8_t *pDst, VulkanThreadPool *pThreadPool = nullptr);
+    /**
+     * @brief Cook an image file into a KTX2 file with a full mip chain, mipmaps of sRGB formats are filtered in linear space.
+     * @param format VK_FORMAT_BC1_RGB(A)_UNORM/SRGB_BLOCK or VK_FORMAT_BC7_UNORM/SRGB_BLOCK.
+     * @note Compressed blocks can not be flipped at load time, flip while cooking instead.
+     */
+    static void Cook(const std::string &srcPath,
+                     const std::string &dstPath,
+                     VkFormat format,
+                     bool generateMipmap = true,
+                     bool flipVerticallyOnLoad = false,
+                     VulkanThreadPool *pThreadPool = nullptr);
+};
+
+#endif
@@ -30,6 +30,16 @@ void VulkanBuffer::Map(VkDeviceSize size, VkDeviceSize offset)
         FATAL("No valid device for buffer operation!");
     }
 
+    // Sub-allocated memory is mapped once by the allocator
+    if (MemoryAllocator != nullptr)
+    {
+        if (Allocation.Mapped == nullptr)
+        {
+            FATAL("Buffer memory is not host visible!");
+        }
+        Mapped = static_cast<char *>(Allocation.Mapped) + offset;
+        return;
+    }
     CHECK_VK_RESULT(vkMapMemory(Device, Memory, offset, size, 0, &Mapped));
 }
 
@@ -40,10 +50,11 @@ void VulkanBuffer::Unmap()
         FATAL("No valid device for buffer operation!");
     }
 
-    if (Mapped != nullptr)
+    if (Mapped != nullptr && MemoryAllocator == nullptr)
     {
         vkUnmapMemory(Device, Memory);
     }
+    Mapped = nullptr;
 }
 
 void VulkanBuffer::Bind(VkDeviceSize offset)
@@ -53,7 +64,7 @@ void VulkanBuffer::Bind(VkDeviceSize offset)
         FATAL("No valid device for buffer operation!");
     }
 
-    CHECK_VK_RESULT(vkBindBufferMemory(Device, Buffer, Memory, offset));
+    CHECK_VK_RESULT(vkBindBufferMemory(Device, Buffer, Memory, Allocation.Offset + offset));
 }
 
 void VulkanBuffer::SetDescriptorBuffer(VkDeviceSize size, VkDeviceSize offset)
@@ -83,10 +94,15 @@ void VulkanBuffer::Flush(VkDeviceSize size, VkDeviceSize offset)
         FATAL("No valid device for buffer operation!");
     }
 
+    // Whole size of a sub-allocated buffer is its range, not the rest of the block
+    if (MemoryAllocator != nullptr && size == VK_WHOLE_SIZE)
+    {
+        size = Allocation.Size - offset;
+    }
     VkMappedMemoryRange mappedRange = {};
     mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
     mappedRange.memory = Memory;
-    mappedRange.offset = offset;
+    mappedRange.offset = Allocation.Offset + offset;
     mappedRange.size = size;
     CHECK_VK_RESULT(vkFlushMappedMemoryRanges(Device, 1, &mappedRange));
 }
@@ -98,10 +114,15 @@ void VulkanBuffer::Invalidate(VkDeviceSize size, VkDeviceSize offset)
         FATAL("No valid device for buffer operation!");
     }
 
+    // Whole size of a sub-allocated buffer is its range, not the rest of the block
+    if (MemoryAllocator != nullptr && size == VK_WHOLE_SIZE)
+    {
+        size = Allocation.Size - offset;
+    }
     VkMappedMemoryRange mappedRange = {};
     mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
     mappedRange.memory = Memory;
-    mappedRange.offset = offset;
+    mappedRange.offset = Allocation.Offset + offset;
     mappedRange.size = size;
     CHECK_VK_RESULT(vkInvalidateMappedMemoryRanges(Device, 1, &mappedRange));
 }
@@ -117,12 +138,19 @@ void VulkanBuffer::Destroy()
         FATAL("No valid device for buffer operation!");
     }
 
-    if (Memory != VK_NULL_HANDLE)
-    {
-        vkFreeMemory(Device, Memory, Allocator);
-    }
     if (Buffer != VK_NULL_HANDLE)
     {
         vkDestroyBuffer(Device, Buffer, Allocator);
+        Buffer = VK_NULL_HANDLE;
+    }
+    if (MemoryAllocator != nullptr)
+    {
+        MemoryAllocator->Free(&Allocation);
+    }
+    else if (Memory != VK_NULL_HANDLE)
+    {
+        vkFreeMemory(Device, Memory, Allocator);
     }
+    Memory = VK_NULL_HANDLE;
+    Mapped = nullptr;
 }
@@ -25,6 +25,7 @@
 
 #include "VulkanCore.h"
 #include "vulkan/vulkan.h"
+#include "VulkanMemoryAllocator.h"
 
 class DVAPI_ATTR VulkanBuffer final
 {
@@ -36,6 +37,9 @@ public:
     VkMemoryPropertyFlags MemoryProperty = 0U;
     VkBuffer Buffer = VK_NULL_HANDLE;
     VkDeviceMemory Memory = VK_NULL_HANDLE;
+    // The allocator the memory range comes from, nullptr if Memory is owned by the buffer
+    VulkanMemoryAllocator *MemoryAllocator = nullptr;
+    VulkanMemoryAllocation Allocation{};
     VkDescriptorBufferInfo DescriptorBufferInfo{};
     VkDeviceSize Size = 0U;
     VkDeviceSize Alignment = 0U;
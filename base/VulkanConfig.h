@@ -104,7 +104,14 @@
 
 /////////////////////////////// allocation callback ///////////////////////////////
 
+// Route driver host allocations through VulkanHostAllocator, comment out to use the driver allocator
+#define USE_HOST_ALLOCATOR
+
+#ifdef USE_HOST_ALLOCATOR
+#define ALLOCATE_CALLBACK VulkanHostAllocator::GetInstance().GetCallbacks(HOST_ALLOCATION_SCOPE_DEVICE)
+#else
 #define ALLOCATE_CALLBACK nullptr
+#endif
 
 /////////////////////////////// allocation callback ///////////////////////////////
 
@@ -19,6 +19,7 @@
  */
 
 #include "VulkanDevice.h"
+#include "VulkanUploadBatch.h"
 #include "VulkanTools.h"
 #include "VulkanInitializer.hpp"
 
@@ -33,10 +34,38 @@ VulkanDevice::VulkanDevice(bool enableValidationLayer, const VkAllocationCallbac
 
 VulkanDevice::~VulkanDevice()
 {
+    if (m_Device != VK_NULL_HANDLE)
+    {
+        CollectUploads(true);
+    }
+    if (m_UploadTimeline != VK_NULL_HANDLE)
+    {
+        ReleaseTimelineSemaphore(m_UploadTimeline, m_UploadTimelineValue);
+    }
+    if (m_GraphicsCmdPool != VK_NULL_HANDLE)
+    {
+        DestroyCommandPool(m_GraphicsCmdPool);
+    }
     if (m_TransferCmdPool != VK_NULL_HANDLE)
     {
         DestroyCommandPool(m_TransferCmdPool);
     }
+    if (p_StagingRing != nullptr)
+    {
+        delete p_StagingRing;
+    }
+    if (m_Device != VK_NULL_HANDLE)
+    {
+        DestroySyncObjectPools();
+    }
+    if (p_SamplerCache != nullptr)
+    {
+        delete p_SamplerCache;
+    }
+    if (p_MemoryAllocator != nullptr)
+    {
+        delete p_MemoryAllocator;
+    }
     if (m_Device != VK_NULL_HANDLE)
     {
         DestroyLogicalDevice();
@@ -863,6 +892,60 @@ void VulkanDevice::InitDevice(VkInstance instance,
         vkGetPhysicalDeviceProperties2(m_GPU, &GPUProperties2);
     }
 
+    // Timeline semaphores hand off asynchronous uploads from the transfer queue to the graphics queue
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    if (ExtensionSupport(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) && API_VERSION > VK_API_VERSION_1_0)
+    {
+        VkPhysicalDeviceFeatures2 GPUFeatures2{};
+        GPUFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        GPUFeatures2.pNext = &timelineFeatures;
+        vkGetPhysicalDeviceFeatures2(m_GPU, &GPUFeatures2);
+        if (timelineFeatures.timelineSemaphore == VK_TRUE)
+        {
+            m_TimelineSemaphoreSupport = true;
+            if (std::find(deviceExtensions.begin(), deviceExtensions.end(), std::string(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) == deviceExtensions.end())
+            {
+                deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+            }
+        }
+    }
+
+    // Partially bound, update-after-bind sampled image arrays back the bindless texture table
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    if (ExtensionSupport(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) && ExtensionSupport(VK_KHR_MAINTENANCE3_EXTENSION_NAME) && API_VERSION > VK_API_VERSION_1_0)
+    {
+        VkPhysicalDeviceFeatures2 GPUFeatures2{};
+        GPUFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        GPUFeatures2.pNext = &indexingFeatures;
+        vkGetPhysicalDeviceFeatures2(m_GPU, &GPUFeatures2);
+        if (indexingFeatures.runtimeDescriptorArray == VK_TRUE &&
+            indexingFeatures.descriptorBindingPartiallyBound == VK_TRUE &&
+            indexingFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+            indexingFeatures.shaderSampledImageArrayNonUniformIndexing == VK_TRUE)
+        {
+            m_DescriptorIndexingSupport = true;
+            for (const char *extension : {VK_KHR_MAINTENANCE3_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME})
+            {
+                if (std::find(deviceExtensions.begin(), deviceExtensions.end(), std::string(extension)) == deviceExtensions.end())
+                {
+                    deviceExtensions.push_back(extension);
+                }
+            }
+        }
+    }
+
+    // Heap budgets reported by the driver, usage includes other processes
+    if (ExtensionSupport(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) && API_VERSION > VK_API_VERSION_1_0)
+    {
+        m_MemoryBudgetSupport = true;
+        if (std::find(deviceExtensions.begin(), deviceExtensions.end(), std::string(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) == deviceExtensions.end())
+        {
+            deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+    }
+
     // Logical device
     float queuePriority = 1.0f;
     std::vector<VkDeviceQueueCreateInfo> deviceQueueInfos;
@@ -888,6 +971,19 @@ void VulkanDevice::InitDevice(VkInstance instance,
     deviceCI.queueCreateInfoCount = static_cast<uint32_t>(deviceQueueInfos.size());
     deviceCI.pQueueCreateInfos = deviceQueueInfos.data();
     deviceCI.pEnabledFeatures = &m_GPUFeatures;
+    // Supported feature structs are chained as queried
+    void *pFeatureChain = nullptr;
+    if (m_DescriptorIndexingSupport)
+    {
+        indexingFeatures.pNext = pFeatureChain;
+        pFeatureChain = &indexingFeatures;
+    }
+    if (m_TimelineSemaphoreSupport)
+    {
+        timelineFeatures.pNext = pFeatureChain;
+        pFeatureChain = &timelineFeatures;
+    }
+    deviceCI.pNext = pFeatureChain;
     if (m_EnableValidationLayer)
     {
         deviceCI.enabledLayerCount = static_cast<uint32_t>(deviceLayers.size());
@@ -906,6 +1002,13 @@ void VulkanDevice::InitDevice(VkInstance instance,
     m_UniqueQueueFamilyIndexCount = static_cast<uint32_t>(uniqueIndices.size());
     p_Queues = pQueues;
 
+    p_MemoryAllocator = new VulkanMemoryAllocator(m_GPU, m_Device, m_GPUProperties.limits.bufferImageGranularity, 64ULL * 1024ULL * 1024ULL, p_Allocator);
+    p_SamplerCache = new VulkanSamplerCache(m_Device, p_Allocator);
+    p_StagingRing = new VulkanStagingRing(this,
+                                          32ULL * 1024ULL * 1024ULL,
+                                          std::max(m_GPUProperties.limits.optimalBufferCopyOffsetAlignment, m_GPUProperties.limits.nonCoherentAtomSize),
+                                          p_Allocator);
+
     if (queueType & QUEUE_TYPE_COMPUTE)
     {
         INFO("Compute queue family index: %d.\n", pIndices->Compute);
@@ -925,6 +1028,23 @@ void VulkanDevice::InitDevice(VkInstance instance,
 
     m_TransferCmdPool = CreateCommandPool(p_QueueFamilyIndices->Transfer, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
     INFO("Transfer command pool %p created!\n", m_TransferCmdPool);
+    if (p_QueueFamilyIndices->GraphicsHasValue)
+    {
+        m_GraphicsCmdPool = CreateCommandPool(p_QueueFamilyIndices->Graphics, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        INFO("Upload graphics command pool %p created!\n", m_GraphicsCmdPool);
+    }
+
+    if (m_TimelineSemaphoreSupport)
+    {
+        m_UploadTimeline = AcquireTimelineSemaphore(&m_UploadTimelineValue);
+    }
+    INFO("Asynchronous transfer: %s, timeline semaphore: %s, descriptor indexing: %s.\n",
+         AsyncTransferSupport() ? "on" : "off",
+         m_TimelineSemaphoreSupport ? "on" : "off",
+         m_DescriptorIndexingSupport ? "on" : "off");
+
+    UpdateMemoryBudget();
+    INFO("Memory budget: %s.\n", m_MemoryBudgetSupport ? "VK_EXT_memory_budget" : "allocator statistics");
 }
 
 VkCommandPool VulkanDevice::CreateCommandPool(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags)
@@ -980,17 +1100,15 @@ void VulkanDevice::CreateBuffer(VkDeviceSize size,
     VkMemoryRequirements requirements;
     vkGetBufferMemoryRequirements(m_Device, pBuffer->Buffer, &requirements);
 
-    uint32_t idx = FindMemoryTypeIndex(m_GPU, requirements.memoryTypeBits, properties);
-    VkMemoryAllocateInfo allocInfo = vkinfo::MemoryAllocInfo(requirements.size, idx);
     // If the buffer has VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT flag, we need to enable the appropriate flag during allocation
-    VkMemoryAllocateFlagsInfoKHR allocFlagsInfo{};
+    VkMemoryAllocateFlags allocateFlags = 0U;
     if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
     {
-        allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR;
-        allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
-        allocInfo.pNext = &allocFlagsInfo;
+        allocateFlags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
     }
-    CHECK_VK_RESULT(vkAllocateMemory(m_Device, &allocInfo, p_Allocator, &pBuffer->Memory));
+    p_MemoryAllocator->Allocate(requirements, properties, true, &pBuffer->Allocation, allocateFlags);
+    pBuffer->Memory = pBuffer->Allocation.Memory;
+    pBuffer->MemoryAllocator = p_MemoryAllocator;
 
     pBuffer->Device = m_Device;
     pBuffer->IsInitialized = true;
@@ -1014,6 +1132,48 @@ void VulkanDevice::CreateBuffer(VkDeviceSize size,
     pBuffer->Bind();
 }
 
+void VulkanDevice::CreateImage(const VkImageCreateInfo *pImageCI, VkMemoryPropertyFlags properties, VulkanTexture *pTexture)
+{
+    if (m_Device == VK_NULL_HANDLE)
+    {
+        FATAL("No valid device!");
+    }
+    if (pImageCI == nullptr || pTexture == nullptr)
+    {
+        FATAL("The address must be valid!");
+    }
+
+    CHECK_VK_RESULT(vkCreateImage(m_Device, pImageCI, p_Allocator, &pTexture->Image));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_Device, pTexture->Image, &requirements);
+    p_MemoryAllocator->Allocate(requirements, properties, pImageCI->tiling == VK_IMAGE_TILING_LINEAR, &pTexture->Allocation);
+    pTexture->Memory = pTexture->Allocation.Memory;
+    pTexture->MemoryAllocator = p_MemoryAllocator;
+    CHECK_VK_RESULT(vkBindImageMemory(m_Device, pTexture->Image, pTexture->Memory, pTexture->Allocation.Offset));
+}
+
+void VulkanDevice::CreateSampler(const VkSamplerCreateInfo *pSamplerCI, VulkanTexture *pTexture)
+{
+    if (m_Device == VK_NULL_HANDLE)
+    {
+        FATAL("No valid device!");
+    }
+    if (pSamplerCI == nullptr || pTexture == nullptr)
+    {
+        FATAL("The address must be valid!");
+    }
+
+    if (pSamplerCI->pNext != nullptr)
+    {
+        CHECK_VK_RESULT(vkCreateSampler(m_Device, pSamplerCI, p_Allocator, &pTexture->Sampler));
+        pTexture->SamplerCache = nullptr;
+        return;
+    }
+    pTexture->Sampler = p_SamplerCache->Acquire(*pSamplerCI);
+    pTexture->SamplerCache = p_SamplerCache;
+}
+
 VkCommandBuffer VulkanDevice::CreateCommandBuffer(VkCommandBufferLevel level, VkCommandPool pool, bool begin)
 {
     VkCommandBuffer cmdBuffer;
@@ -1044,17 +1204,13 @@ void VulkanDevice::FlushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue que
     VkSubmitInfo submitInfo = vkinfo::SubmitInfo();
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
-    // Create fence to ensure that the command buffer has finished executing
-    VkFenceCreateInfo fenceInfo = vkinfo::FenceInfo(VK_FENCE_CREATE_SIGNALED_BIT);
-    VkFence fence;
-    CHECK_VK_RESULT(vkCreateFence(m_Device, &fenceInfo, p_Allocator, &fence));
-    // Reset fence
-    CHECK_VK_RESULT(vkResetFences(m_Device, 1, &fence));
+    // Fence to ensure that the command buffer has finished executing
+    VkFence fence = AcquireFence();
     // Submit to the queue
     CHECK_VK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, fence));
     // Wait for the fence to signal that command buffer has finished executing
     CHECK_VK_RESULT(vkWaitForFences(m_Device, 1, &fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
-    vkDestroyFence(m_Device, fence, p_Allocator);
+    ReleaseFence(fence);
     if (free)
     {
         vkFreeCommandBuffers(m_Device, pool, 1, &commandBuffer);
@@ -1066,6 +1222,177 @@ void VulkanDevice::FlushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue que
     FlushCommandBuffer(commandBuffer, queue, m_TransferCmdPool, free);
 }
 
+void VulkanDevice::FreeCommandBuffer(VkCommandBuffer commandBuffer)
+{
+    FreeCommandBuffer(commandBuffer, m_TransferCmdPool);
+}
+
+void VulkanDevice::FreeCommandBuffer(VkCommandBuffer commandBuffer, VkCommandPool pool)
+{
+    if (commandBuffer != VK_NULL_HANDLE)
+    {
+        vkFreeCommandBuffers(m_Device, pool, 1, &commandBuffer);
+    }
+}
+
+void VulkanDevice::TrackUpload(VkFence fence,
+                               VkCommandBuffer transferCmdBuffer,
+                               VkCommandBuffer graphicsCmdBuffer,
+                               VkSemaphore semaphore,
+                               std::vector<std::function<void()>> &&deleters)
+{
+    PendingUpload upload{};
+    upload.Fence = fence;
+    upload.TransferCmdBuffer = transferCmdBuffer;
+    upload.GraphicsCmdBuffer = graphicsCmdBuffer;
+    upload.Semaphore = semaphore;
+    upload.Deleters = std::move(deleters);
+    m_PendingUploads.push_back(std::move(upload));
+}
+
+void VulkanDevice::CollectUploads(bool wait)
+{
+    // Uploads finish in submission order on the graphics queue
+    while (!m_PendingUploads.empty())
+    {
+        PendingUpload &upload = m_PendingUploads.front();
+        if (wait)
+        {
+            CHECK_VK_RESULT(vkWaitForFences(m_Device, 1, &upload.Fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
+        }
+        else if (vkGetFenceStatus(m_Device, upload.Fence) != VK_SUCCESS)
+        {
+            break;
+        }
+        ReleaseFence(upload.Fence);
+        FreeCommandBuffer(upload.TransferCmdBuffer, m_TransferCmdPool);
+        FreeCommandBuffer(upload.GraphicsCmdBuffer, m_GraphicsCmdPool);
+        if (upload.Semaphore != VK_NULL_HANDLE)
+        {
+            ReleaseSemaphore(upload.Semaphore);
+        }
+        for (size_t i = 0; i < upload.Deleters.size(); ++i)
+        {
+            upload.Deleters[i]();
+        }
+        m_PendingUploads.pop_front();
+    }
+}
+
+VkFence VulkanDevice::AcquireFence()
+{
+    VkFence fence = VK_NULL_HANDLE;
+    if (m_FreeFences.empty())
+    {
+        VkFenceCreateInfo fenceInfo = vkinfo::FenceInfo(0);
+        CHECK_VK_RESULT(vkCreateFence(m_Device, &fenceInfo, p_Allocator, &fence));
+        ++m_SyncObjectCreateCount;
+    }
+    else
+    {
+        fence = m_FreeFences.back();
+        m_FreeFences.pop_back();
+        ++m_SyncObjectReuseCount;
+    }
+    return fence;
+}
+
+void VulkanDevice::ReleaseFence(VkFence fence)
+{
+    if (fence == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    CHECK_VK_RESULT(vkResetFences(m_Device, 1, &fence));
+    m_FreeFences.push_back(fence);
+}
+
+VkSemaphore VulkanDevice::AcquireSemaphore()
+{
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    if (m_FreeSemaphores.empty())
+    {
+        VkSemaphoreCreateInfo semaphoreInfo = vkinfo::SemaphoreInfo();
+        CHECK_VK_RESULT(vkCreateSemaphore(m_Device, &semaphoreInfo, p_Allocator, &semaphore));
+        ++m_SyncObjectCreateCount;
+    }
+    else
+    {
+        semaphore = m_FreeSemaphores.back();
+        m_FreeSemaphores.pop_back();
+        ++m_SyncObjectReuseCount;
+    }
+    return semaphore;
+}
+
+void VulkanDevice::ReleaseSemaphore(VkSemaphore semaphore)
+{
+    if (semaphore != VK_NULL_HANDLE)
+    {
+        m_FreeSemaphores.push_back(semaphore);
+    }
+}
+
+VkSemaphore VulkanDevice::AcquireTimelineSemaphore(uint64_t *pValue)
+{
+    if (!m_TimelineSemaphoreSupport)
+    {
+        FATAL("Timeline semaphore is not supported by the device!");
+    }
+
+    TimelineSemaphore timeline{};
+    if (m_FreeTimelineSemaphores.empty())
+    {
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0U;
+        VkSemaphoreCreateInfo semaphoreInfo = vkinfo::SemaphoreInfo();
+        semaphoreInfo.pNext = &typeInfo;
+        CHECK_VK_RESULT(vkCreateSemaphore(m_Device, &semaphoreInfo, p_Allocator, &timeline.Semaphore));
+        ++m_SyncObjectCreateCount;
+    }
+    else
+    {
+        timeline = m_FreeTimelineSemaphores.back();
+        m_FreeTimelineSemaphores.pop_back();
+        ++m_SyncObjectReuseCount;
+    }
+    if (pValue != nullptr)
+    {
+        *pValue = timeline.Value;
+    }
+    return timeline.Semaphore;
+}
+
+void VulkanDevice::ReleaseTimelineSemaphore(VkSemaphore semaphore, uint64_t value)
+{
+    if (semaphore != VK_NULL_HANDLE)
+    {
+        m_FreeTimelineSemaphores.push_back({semaphore, value});
+    }
+}
+
+void VulkanDevice::DestroySyncObjectPools()
+{
+    for (auto fence : m_FreeFences)
+    {
+        vkDestroyFence(m_Device, fence, p_Allocator);
+    }
+    for (auto semaphore : m_FreeSemaphores)
+    {
+        vkDestroySemaphore(m_Device, semaphore, p_Allocator);
+    }
+    for (const auto &timeline : m_FreeTimelineSemaphores)
+    {
+        vkDestroySemaphore(m_Device, timeline.Semaphore, p_Allocator);
+    }
+    m_FreeFences.clear();
+    m_FreeSemaphores.clear();
+    m_FreeTimelineSemaphores.clear();
+    INFO("Synchronization object pools created %u objects and reused %u times.\n", m_SyncObjectCreateCount, m_SyncObjectReuseCount);
+}
+
 void VulkanDevice::CopyBuffer(VulkanBuffer *src, VulkanBuffer *dst, VkQueue queue, VkBufferCopy *copyRegin)
 {
     if (dst->Size < src->Size)
@@ -1144,6 +1471,13 @@ void VulkanDevice::CopyBuffer(VulkanBuffer *src, VulkanBuffer *dst, VkBufferCopy
     }
 }
 
+void VulkanDevice::UploadBuffer(const void *pData, VkDeviceSize size, VulkanBuffer *pDsts, size_t dstCount, VkDeviceSize dstOffset)
+{
+    VulkanUploadBatch batch{this, p_Allocator};
+    batch.CopyBuffer(pData, size, pDsts, dstCount, dstOffset);
+    batch.SubmitAsync();
+}
+
 void VulkanDevice::CopyBufferToImage(VulkanBuffer *src,
                                      VulkanTexture *dst,
                                      VkQueue queue,
@@ -1272,3 +1606,50 @@ bool VulkanDevice::LayerSupport(const std::string &layerName)
     }
     return false;
 }
+
+void VulkanDevice::UpdateMemoryBudget()
+{
+    if (m_GPU == VK_NULL_HANDLE || p_MemoryAllocator == nullptr)
+    {
+        FATAL("Memory budget can only be queried after device creation!");
+    }
+
+    const VkPhysicalDeviceMemoryProperties &memoryProperties = p_MemoryAllocator->GetMemoryProperties();
+    m_HeapBudgets.resize(memoryProperties.memoryHeapCount);
+    if (m_MemoryBudgetSupport)
+    {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 memoryProperties2{};
+        memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProperties2.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2(m_GPU, &memoryProperties2);
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+        {
+            m_HeapBudgets[i].Usage = budgetProperties.heapUsage[i];
+            m_HeapBudgets[i].Budget = budgetProperties.heapBudget[i];
+            m_HeapBudgets[i].DeviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+    {
+        m_HeapBudgets[i].Usage = p_MemoryAllocator->GetHeapUsage(i);
+        m_HeapBudgets[i].Budget = memoryProperties.memoryHeaps[i].size / 10 * 8;
+        m_HeapBudgets[i].DeviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+}
+
+float VulkanDevice::GetDeviceLocalBudgetRatio() const
+{
+    float ratio = 0.0f;
+    for (const auto &heap : m_HeapBudgets)
+    {
+        if (heap.DeviceLocal && heap.Budget != 0)
+        {
+            ratio = std::max(ratio, static_cast<float>(heap.Usage) / static_cast<float>(heap.Budget));
+        }
+    }
+    return ratio;
+}
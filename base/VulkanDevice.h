@@ -27,12 +27,26 @@
 #include "VulkanMedium.hpp"
 #include "VulkanBuffer.h"
 #include "VulkanTexture.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanSamplerCache.h"
+#include "VulkanStagingRing.h"
 
+#include <deque>
+#include <functional>
 #include <string>
 #include <vector>
 
 class DVAPI_ATTR VulkanDevice final
 {
+public:
+    // Usage and budget of a memory heap in bytes
+    struct HeapBudget
+    {
+        VkDeviceSize Usage = 0U;
+        VkDeviceSize Budget = 0U;
+        bool DeviceLocal = false;
+    };
+
 private:
     bool m_EnableValidationLayer = true;
     const VkAllocationCallbacks *p_Allocator = nullptr;
@@ -44,6 +58,50 @@ private:
     Queues *p_Queues = nullptr;
     // For buffer operation(copy/create/destroy buffer)
     VkCommandPool m_TransferCmdPool = VK_NULL_HANDLE;
+    // For upload work that needs the graphics queue, e.g. ownership acquire and mip blits
+    VkCommandPool m_GraphicsCmdPool = VK_NULL_HANDLE;
+    // Sub-allocates buffer and image memory from large blocks
+    VulkanMemoryAllocator *p_MemoryAllocator = nullptr;
+    VulkanSamplerCache *p_SamplerCache = nullptr;
+    // Persistently mapped staging memory shared by all uploads
+    VulkanStagingRing *p_StagingRing = nullptr;
+    bool m_TimelineSemaphoreSupport = false;
+    bool m_DescriptorIndexingSupport = false;
+    // Signaled by the transfer queue and waited by the graphics queue for asynchronous uploads
+    VkSemaphore m_UploadTimeline = VK_NULL_HANDLE;
+    uint64_t m_UploadTimelineValue = 0U;
+
+    // Submitted asynchronous upload, released once Fence is signaled
+    struct PendingUpload
+    {
+        VkFence Fence = VK_NULL_HANDLE;
+        VkCommandBuffer TransferCmdBuffer = VK_NULL_HANDLE;
+        VkCommandBuffer GraphicsCmdBuffer = VK_NULL_HANDLE;
+        // Binary handoff semaphore, only used without timeline semaphore support
+        VkSemaphore Semaphore = VK_NULL_HANDLE;
+        // Destroy transient objects used by the upload commands
+        std::vector<std::function<void()>> Deleters = {};
+    };
+    std::deque<PendingUpload> m_PendingUploads = {};
+
+    // Recycled synchronization objects, pooled fences are unsignaled
+    struct TimelineSemaphore
+    {
+        VkSemaphore Semaphore = VK_NULL_HANDLE;
+        // The last value signaled or waited, new uses must go above it
+        uint64_t Value = 0U;
+    };
+    std::vector<VkFence> m_FreeFences = {};
+    std::vector<VkSemaphore> m_FreeSemaphores = {};
+    std::vector<TimelineSemaphore> m_FreeTimelineSemaphores = {};
+    uint32_t m_SyncObjectCreateCount = 0U;
+    uint32_t m_SyncObjectReuseCount = 0U;
+
+    // Heap budgets come from VK_EXT_memory_budget if enabled, otherwise from the allocator statistics
+    bool m_MemoryBudgetSupport = false;
+    std::vector<HeapBudget> m_HeapBudgets = {};
+
+    void DestroySyncObjectPools();
 
 public:
     explicit VulkanDevice(bool enableValidationLayer, const VkAllocationCallbacks *pAllocator = nullptr);
@@ -91,6 +149,18 @@ public:
                       VkMemoryPropertyFlags properties,
                       VulkanBuffer *pBuffer,
                       const void *data = nullptr);
+    /**
+     * @brief Create an image and bind it to memory sub-allocated from the memory allocator.
+     * @param pTexture The address of the texture object, the image and memory members are written.
+     * @note The texture frees its memory range back to the allocator in VulkanTexture::Destroy.
+     */
+    void CreateImage(const VkImageCreateInfo *pImageCI, VkMemoryPropertyFlags properties, VulkanTexture *pTexture);
+    /**
+     * @brief Get a sampler of the state shared with other textures from the sampler cache.
+     * @param pTexture The address of the texture object, the sampler members are written.
+     * @note The texture releases its reference in VulkanTexture::Destroy. Create infos with a pNext chain get a sampler owned by the texture.
+     */
+    void CreateSampler(const VkSamplerCreateInfo *pSamplerCI, VulkanTexture *pTexture);
     /**
      * @brief Allocate a command buffer from the command pool.
      * @param level Level(primary or secondary) of the new command buffer.
@@ -125,6 +195,47 @@ public:
      * @note Uses a fence to ensure command buffer has finished executing.
      */
     void FlushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free = true);
+    // Free a command buffer allocated from the transfer command pool
+    void FreeCommandBuffer(VkCommandBuffer commandBuffer);
+    // Free a command buffer allocated from the command pool
+    void FreeCommandBuffer(VkCommandBuffer commandBuffer, VkCommandPool pool);
+    /**
+     * @brief Keep the resources of a submitted upload alive until its fence is signaled.
+     * @note The device takes ownership of the fence, the command buffers and the semaphore, the sync objects go back to the pools.
+     * The deleters run after the fence is signaled.
+     */
+    void TrackUpload(VkFence fence,
+                     VkCommandBuffer transferCmdBuffer,
+                     VkCommandBuffer graphicsCmdBuffer,
+                     VkSemaphore semaphore = VK_NULL_HANDLE,
+                     std::vector<std::function<void()>> &&deleters = {});
+    // Release finished uploads, or wait for all of them if wait is true
+    void CollectUploads(bool wait = false);
+    // Get an unsignaled fence from the pool, a new one is created if the pool is empty
+    VkFence AcquireFence();
+    // Return a fence to the pool, it is reset here and must not be in use by any pending submission
+    void ReleaseFence(VkFence fence);
+    // Get an unsignaled binary semaphore from the pool
+    VkSemaphore AcquireSemaphore();
+    // Return a binary semaphore to the pool, it must be unsignaled with no pending wait
+    void ReleaseSemaphore(VkSemaphore semaphore);
+    /**
+     * @brief Get a timeline semaphore from the pool.
+     * @param pValue Receives the current counter value, signal values must be greater than it.
+     * @note Timeline semaphores require timeline semaphore support.
+     */
+    VkSemaphore AcquireTimelineSemaphore(uint64_t *pValue);
+    // Return a timeline semaphore with its last signaled value, it must not be in use by any pending submission
+    void ReleaseTimelineSemaphore(VkSemaphore semaphore, uint64_t value);
+    /**
+     * @brief Query the usage and budget of every memory heap, call it once per frame.
+     * @note Without VK_EXT_memory_budget, usage is the device memory allocated by the memory allocator and budget is 80% of the heap size.
+     */
+    void UpdateMemoryBudget();
+    // The highest usage to budget ratio of device local heaps, as of the last UpdateMemoryBudget
+    float GetDeviceLocalBudgetRatio() const;
+    // Reserve the next value of the upload timeline semaphore
+    inline uint64_t NextUploadTimelineValue() { return ++m_UploadTimelineValue; }
     /**
      * @brief Copy buffer memory.
      * @note If the copyRegin is nullptr, then copy the whole src buffer memory size.
@@ -135,6 +246,14 @@ public:
      * @note If the copyRegin is nullptr, then copy the whole src buffer memory size.
      */
     void CopyBuffer(VulkanBuffer *src, VulkanBuffer *dst, VkBufferCopy *copyRegin = nullptr);
+    /**
+     * @brief Upload host data to buffers through the staging ring, the data is staged once and copied to every dst buffer.
+     * @param pDsts The dst buffer array pointer.
+     * @param dstCount The count of dst buffers.
+     * @param dstOffset The byte offset into each dst buffer.
+     * @note Runs asynchronously on the transfer queue if it is a dedicated family, the buffers are handed over to the graphics queue.
+     */
+    void UploadBuffer(const void *pData, VkDeviceSize size, VulkanBuffer *pDsts, size_t dstCount = 1, VkDeviceSize dstOffset = 0U);
     /**
      * @brief Copy buffer to image. This will change the image layout to transfer dstination optimal.
      * @param queue The transfer queue.
@@ -179,6 +298,27 @@ public:
     {
         return p_Queues;
     }
+    inline VulkanMemoryAllocator *GetMemoryAllocator() { return p_MemoryAllocator; }
+    inline VulkanSamplerCache *GetSamplerCache() { return p_SamplerCache; }
+    inline VulkanStagingRing *GetStagingRing() { return p_StagingRing; }
+    inline VkCommandPool GetTransferCommandPool() { return m_TransferCmdPool; }
+    inline VkCommandPool GetGraphicsCommandPool() { return m_GraphicsCmdPool; }
+    inline VkSemaphore GetUploadTimeline() { return m_UploadTimeline; }
+    inline bool TimelineSemaphoreSupport() const { return m_TimelineSemaphoreSupport; }
+    inline bool MemoryBudgetSupport() const { return m_MemoryBudgetSupport; }
+    // Whether bindless sampled image arrays (partially bound, update after bind, non-uniform indexing) are enabled
+    inline bool DescriptorIndexingSupport() const { return m_DescriptorIndexingSupport; }
+    inline const std::vector<HeapBudget> &GetHeapBudgets() const { return m_HeapBudgets; }
+    // Fences and semaphores created by the pools
+    inline uint32_t GetSyncObjectCreateCount() const { return m_SyncObjectCreateCount; }
+    // Fences and semaphores handed out again by the pools
+    inline uint32_t GetSyncObjectReuseCount() const { return m_SyncObjectReuseCount; }
+    // Whether uploads run on a transfer queue family other than the graphics one
+    inline bool AsyncTransferSupport() const
+    {
+        return p_QueueFamilyIndices->TransferHasValue && p_QueueFamilyIndices->GraphicsHasValue &&
+               p_QueueFamilyIndices->Transfer != p_QueueFamilyIndices->Graphics;
+    }
 
     // Destroy command pool
     void DestroyCommandPool(VkCommandPool pool);
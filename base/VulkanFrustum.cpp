@@ -0,0 +1,206 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanFrustum.h"
+#include "VulkanTools.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(opm::mat4) == 16 * sizeof(opm::T), "opm::mat4 must be 16 tightly packed elements!");
+
+// Copy a row-major math matrix into plain floats
+static void LoadMatrix(const opm::mat4 &mat, float out[16])
+{
+    opm::T elements[16];
+    std::memcpy(elements, &mat, sizeof(elements));
+    for (int i = 0; i < 16; ++i)
+    {
+        out[i] = static_cast<float>(elements[i]);
+    }
+}
+
+void VulkanFrustum::Update(const opm::mat4 &projection, const opm::mat4 &view)
+{
+    float p[16], v[16], m[16];
+    LoadMatrix(projection, p);
+    LoadMatrix(view, v);
+    for (int r = 0; r < 4; ++r)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            m[r * 4 + c] = p[r * 4 + 0] * v[0 * 4 + c] + p[r * 4 + 1] * v[1 * 4 + c] + p[r * 4 + 2] * v[2 * 4 + c] + p[r * 4 + 3] * v[3 * 4 + c];
+        }
+    }
+
+    // Gribb-Hartmann plane extraction, clip = m * position
+    const float *row0 = m + 0;
+    const float *row1 = m + 4;
+    const float *row2 = m + 8;
+    const float *row3 = m + 12;
+    for (int i = 0; i < 4; ++i)
+    {
+        m_Planes[0][i] = row3[i] + row0[i];
+        m_Planes[1][i] = row3[i] - row0[i];
+        m_Planes[2][i] = row3[i] + row1[i];
+        m_Planes[3][i] = row3[i] - row1[i];
+        m_Planes[4][i] = row2[i];
+        m_Planes[5][i] = row3[i] - row2[i];
+    }
+
+    for (auto &plane : m_Planes)
+    {
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length > 0.0f)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                plane[i] /= length;
+            }
+        }
+    }
+}
+
+uint32_t VulkanFrustum::Cull(VulkanModel *const *ppModels, size_t modelCount)
+{
+    size_t paddedCount = (modelCount + 7) & ~static_cast<size_t>(7);
+    m_CenterX.resize(paddedCount, 0.0f);
+    m_CenterY.resize(paddedCount, 0.0f);
+    m_CenterZ.resize(paddedCount, 0.0f);
+    m_ExtentX.resize(paddedCount, 0.0f);
+    m_ExtentY.resize(paddedCount, 0.0f);
+    m_ExtentZ.resize(paddedCount, 0.0f);
+    m_Radius.resize(paddedCount, 0.0f);
+
+    // Transform local bounds to world space
+    for (size_t i = 0; i < modelCount; ++i)
+    {
+        const VulkanModel *pModel = ppModels[i];
+        float m[16];
+        LoadMatrix(pModel->m_UniqueModelMat, m);
+
+        const opm::vec3 &boundsMin = pModel->GetBoundsMin();
+        const opm::vec3 &boundsMax = pModel->GetBoundsMax();
+        float center[3] = {
+            static_cast<float>(boundsMin.x + boundsMax.x) * 0.5f,
+            static_cast<float>(boundsMin.y + boundsMax.y) * 0.5f,
+            static_cast<float>(boundsMin.z + boundsMax.z) * 0.5f};
+        float extent[3] = {
+            static_cast<float>(boundsMax.x - boundsMin.x) * 0.5f,
+            static_cast<float>(boundsMax.y - boundsMin.y) * 0.5f,
+            static_cast<float>(boundsMax.z - boundsMin.z) * 0.5f};
+
+        float worldCenter[3], worldExtent[3];
+        float maxScaleSquared = 0.0f;
+        for (int r = 0; r < 3; ++r)
+        {
+            const float *row = m + r * 4;
+            worldCenter[r] = row[0] * center[0] + row[1] * center[1] + row[2] * center[2] + row[3];
+            // Arvo's method, the box stays axis aligned after rotation
+            worldExtent[r] = std::fabs(row[0]) * extent[0] + std::fabs(row[1]) * extent[1] + std::fabs(row[2]) * extent[2];
+        }
+        for (int c = 0; c < 3; ++c)
+        {
+            float scaleSquared = m[0 * 4 + c] * m[0 * 4 + c] + m[1 * 4 + c] * m[1 * 4 + c] + m[2 * 4 + c] * m[2 * 4 + c];
+            maxScaleSquared = std::max(maxScaleSquared, scaleSquared);
+        }
+
+        m_CenterX[i] = worldCenter[0];
+        m_CenterY[i] = worldCenter[1];
+        m_CenterZ[i] = worldCenter[2];
+        m_ExtentX[i] = worldExtent[0];
+        m_ExtentY[i] = worldExtent[1];
+        m_ExtentZ[i] = worldExtent[2];
+        m_Radius[i] = static_cast<float>(pModel->GetBoundsRadius()) * std::sqrt(maxScaleSquared);
+    }
+
+    // AVX2 and FMA are only used by the kernel built for them, the CPU is checked once at run time
+    static const bool avx = SupportsAVX();
+    m_DrawnCount = 0U;
+    for (size_t i = 0; i < paddedCount; i += 8)
+    {
+        // Bit n is set if the bounds i + n are outside of any plane
+        int outsideMask = avx ? TestBoundsAVX(i) : TestBounds(i);
+
+        size_t laneCount = std::min<size_t>(8, modelCount - i);
+        for (size_t lane = 0; lane < laneCount; ++lane)
+        {
+            bool visible = ((outsideMask >> lane) & 1) == 0;
+            ppModels[i + lane]->m_Visible = visible;
+            m_DrawnCount += visible ? 1U : 0U;
+        }
+    }
+    m_CulledCount = static_cast<uint32_t>(modelCount) - m_DrawnCount;
+
+    return m_DrawnCount;
+}
+
+int VulkanFrustum::TestBounds(size_t first) const
+{
+    int outsideMask = 0;
+    for (size_t lane = 0; lane < 8; ++lane)
+    {
+        size_t index = first + lane;
+        for (const auto &plane : m_Planes)
+        {
+            float distance = plane[0] * m_CenterX[index] + plane[1] * m_CenterY[index] + plane[2] * m_CenterZ[index] + plane[3];
+            float projected = std::fabs(plane[0]) * m_ExtentX[index] + std::fabs(plane[1]) * m_ExtentY[index] + std::fabs(plane[2]) * m_ExtentZ[index];
+            if (distance < -std::min(m_Radius[index], projected))
+            {
+                outsideMask |= 1 << lane;
+                break;
+            }
+        }
+    }
+
+    return outsideMask;
+}
+
+bool VulkanFrustum::SupportsAVX()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    // FMA, OSXSAVE and AVX bits, then the OS must save the YMM registers
+    __cpuid(info, 1);
+    const int featureBits = (1 << 12) | (1 << 27) | (1 << 28);
+    if ((info[2] & featureBits) != featureBits || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
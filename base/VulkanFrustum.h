@@ -0,0 +1,84 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_FRUSTUM_HEADER
+#define VULKAN_FRUSTUM_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "VulkanModel.h"
+
+#include <vector>
+
+/**
+ * @brief View frustum for CPU culling. Bounds are stored as structure of arrays and tested 8 at a time with AVX if the CPU supports AVX2.
+ * @note Matrices are the math (row-major) matrices, e.g. VulkanCamera::GetProjectionMat() and VulkanCamera::GetViewMat().
+ */
+class DVAPI_ATTR VulkanFrustum final
+{
+private:
+    // Left, right, bottom, top, near, far planes (a, b, c, d) with normalized normals pointing inside
+    float m_Planes[6][4] = {};
+    // World bounds of the models being culled, padded to a multiple of 8
+    std::vector<float> m_CenterX = {};
+    std::vector<float> m_CenterY = {};
+    std::vector<float> m_CenterZ = {};
+    std::vector<float> m_ExtentX = {};
+    std::vector<float> m_ExtentY = {};
+    std::vector<float> m_ExtentZ = {};
+    std::vector<float> m_Radius = {};
+    uint32_t m_DrawnCount = 0U;
+    uint32_t m_CulledCount = 0U;
+
+    // Outside mask of the 8 bounds starting at first, bit n is set if the bounds first + n are outside of any plane
+    int TestBounds(size_t first) const;
+    /**
+     * @brief TestBounds with AVX, defined in VulkanFrustumAVX.cpp which is the only file built with AVX2 and FMA.
+     * @note Call only if SupportsAVX returns true. Builds without ENABLE_AVX fall back to TestBounds.
+     */
+    int TestBoundsAVX(size_t first) const;
+    // Whether the CPU and the OS support AVX2 and FMA
+    static bool SupportsAVX();
+
+public:
+    VulkanFrustum() = default;
+    ~VulkanFrustum() = default;
+    VulkanFrustum(const VulkanFrustum &) = delete;
+    VulkanFrustum &operator=(const VulkanFrustum &) = delete;
+    VulkanFrustum(VulkanFrustum &&) = default;
+    VulkanFrustum &operator=(VulkanFrustum &&) = default;
+
+    // Extract frustum planes from projection * view, the clip space depth ranges from 0 to 1
+    void Update(const opm::mat4 &projection, const opm::mat4 &view);
+    /**
+     * @brief Test models against the frustum and write the result to VulkanModel::m_Visible.
+     * @note The world bounds are the local bounds transformed by VulkanModel::m_UniqueModelMat.
+     * @return The visible model count.
+     */
+    uint32_t Cull(VulkanModel *const *ppModels, size_t modelCount);
+
+    // Visible model count of the last Cull
+    inline uint32_t GetDrawnCount() const { return m_DrawnCount; }
+    // Invisible model count of the last Cull
+    inline uint32_t GetCulledCount() const { return m_CulledCount; }
+};
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanFrustum.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// The only translation unit built with AVX2 and FMA, VulkanFrustum::Cull calls into it after checking the CPU
+int VulkanFrustum::TestBoundsAVX(size_t first) const
+{
+#if defined(__AVX__)
+    __m256 centerX = _mm256_loadu_ps(m_CenterX.data() + first);
+    __m256 centerY = _mm256_loadu_ps(m_CenterY.data() + first);
+    __m256 centerZ = _mm256_loadu_ps(m_CenterZ.data() + first);
+    __m256 extentX = _mm256_loadu_ps(m_ExtentX.data() + first);
+    __m256 extentY = _mm256_loadu_ps(m_ExtentY.data() + first);
+    __m256 extentZ = _mm256_loadu_ps(m_ExtentZ.data() + first);
+    __m256 radius = _mm256_loadu_ps(m_Radius.data() + first);
+    __m256 outside = _mm256_setzero_ps();
+    for (const auto &plane : m_Planes)
+    {
+        __m256 a = _mm256_set1_ps(plane[0]);
+        __m256 b = _mm256_set1_ps(plane[1]);
+        __m256 c = _mm256_set1_ps(plane[2]);
+        __m256 d = _mm256_set1_ps(plane[3]);
+        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, centerX), _mm256_mul_ps(b, centerY)),
+                                        _mm256_add_ps(_mm256_mul_ps(c, centerZ), d));
+        // Projected box extent onto the plane normal
+        __m256 projected = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::fabs(plane[0])), extentX),
+                                                       _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane[1])), extentY)),
+                                         _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane[2])), extentZ));
+        // Both volumes are conservative, the smaller one decides
+        __m256 limit = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_min_ps(radius, projected));
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, limit, _CMP_LT_OQ));
+    }
+    return _mm256_movemask_ps(outside);
+#else
+    return TestBounds(first);
+#endif
+}
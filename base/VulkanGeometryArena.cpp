@@ -0,0 +1,305 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanGeometryArena.h"
+#include "VulkanTools.h"
+#include "VulkanUploadBatch.h"
+
+#include <cstring>
+
+VulkanGeometryArena::VulkanGeometryArena(VulkanDevice *pDevice,
+                                         uint32_t maxFramesInFlight,
+                                         uint32_t maxVertexCount,
+                                         uint32_t maxIndexCount,
+                                         uint32_t maxDrawCount,
+                                         bool positionStream,
+                                         const VkAllocationCallbacks *pAllocator)
+    : m_VertexBuffer{pAllocator}, m_PositionBuffer{pAllocator}, m_IndexBuffer{pAllocator}
+{
+    if (pDevice == nullptr || pDevice->GetDevice() == VK_NULL_HANDLE)
+    {
+        FATAL("Geometry arena must be created with a valid device!");
+    }
+    if (maxFramesInFlight == 0 || maxVertexCount == 0 || maxIndexCount == 0 || maxDrawCount == 0)
+    {
+        FATAL("Geometry arena capacity must not be 0!");
+    }
+
+    p_Device = pDevice;
+    p_Allocator = pAllocator;
+    m_MaxFramesInFlight = maxFramesInFlight;
+    m_MaxVertexCount = maxVertexCount;
+    m_MaxIndexCount = maxIndexCount;
+    m_MaxDrawCount = maxDrawCount;
+    m_PositionStream = positionStream;
+    m_MultiDrawIndirect = p_Device->m_GPUFeatures.multiDrawIndirect == VK_TRUE;
+    m_DrawIndirectFirstInstance = p_Device->m_GPUFeatures.drawIndirectFirstInstance == VK_TRUE;
+    if (!m_MultiDrawIndirect)
+    {
+        WARNING("Device feature: multi draw indirect not support, one indirect call per draw will be recorded!\n");
+    }
+    if (!m_DrawIndirectFirstInstance)
+    {
+        WARNING("Device feature: draw indirect first instance not support, fall back to direct draws!\n");
+    }
+
+    p_Device->CreateBuffer(sizeof(VulkanVertex) * static_cast<VkDeviceSize>(m_MaxVertexCount),
+                           VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                           &m_VertexBuffer);
+    if (m_PositionStream)
+    {
+        p_Device->CreateBuffer(sizeof(opm::vec3) * static_cast<VkDeviceSize>(m_MaxVertexCount),
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                               &m_PositionBuffer);
+    }
+    p_Device->CreateBuffer(sizeof(IndexType) * static_cast<VkDeviceSize>(m_MaxIndexCount),
+                           VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                           &m_IndexBuffer);
+
+    m_DrawCounts.resize(m_MaxFramesInFlight, 0U);
+    m_Commands.resize(m_MaxFramesInFlight);
+    for (uint32_t i = 0; i < m_MaxFramesInFlight; ++i)
+    {
+        m_DrawParameterBuffers.push_back(std::move(VulkanBuffer(p_Allocator)));
+        m_IndirectBuffers.push_back(std::move(VulkanBuffer(p_Allocator)));
+    }
+    for (uint32_t i = 0; i < m_MaxFramesInFlight; ++i)
+    {
+        p_Device->CreateBuffer(sizeof(DrawParameter) * static_cast<VkDeviceSize>(m_MaxDrawCount),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                               &m_DrawParameterBuffers[i]);
+        m_DrawParameterBuffers[i].Map();
+        p_Device->CreateBuffer(sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(m_MaxDrawCount),
+                               VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                               &m_IndirectBuffers[i]);
+        m_IndirectBuffers[i].Map();
+        m_Commands[i].reserve(m_MaxDrawCount);
+    }
+}
+
+VulkanGeometryArena::~VulkanGeometryArena()
+{
+    for (size_t i = 0; i < m_IndirectBuffers.size(); ++i)
+    {
+        m_IndirectBuffers[i].Unmap();
+        m_IndirectBuffers[i].Destroy();
+    }
+    for (size_t i = 0; i < m_DrawParameterBuffers.size(); ++i)
+    {
+        m_DrawParameterBuffers[i].Unmap();
+        m_DrawParameterBuffers[i].Destroy();
+    }
+    m_IndexBuffer.Destroy();
+    m_PositionBuffer.Destroy();
+    m_VertexBuffer.Destroy();
+}
+
+uint32_t VulkanGeometryArena::AddMesh(VulkanModel *pModel)
+{
+    if (pModel == nullptr)
+    {
+        FATAL("Can not add an empty model to geometry arena!");
+    }
+
+    uint32_t vertexCount = static_cast<uint32_t>(pModel->GetVertexCount());
+    uint32_t indexCount = static_cast<uint32_t>(pModel->GetIndexCount());
+    std::vector<IndexType> sequentialIndices = {};
+    const IndexType *pIndices = pModel->GetIndexData();
+    if (indexCount == 0)
+    {
+        // Draw non-indexed geometry through the same indexed path
+        sequentialIndices.resize(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; ++i)
+        {
+            sequentialIndices[i] = static_cast<IndexType>(i);
+        }
+        indexCount = vertexCount;
+        pIndices = sequentialIndices.data();
+    }
+    if (vertexCount == 0)
+    {
+        FATAL("Can not add a model without vertices to geometry arena!");
+    }
+    if (m_VertexCount + vertexCount > m_MaxVertexCount)
+    {
+        FATAL("Geometry arena vertex buffer is full! Capacity: %u, requested: %u", m_MaxVertexCount, m_VertexCount + vertexCount);
+    }
+    if (m_IndexCount + indexCount > m_MaxIndexCount)
+    {
+        FATAL("Geometry arena index buffer is full! Capacity: %u, requested: %u", m_MaxIndexCount, m_IndexCount + indexCount);
+    }
+
+    VkDeviceSize vertexSize = sizeof(VulkanVertex) * static_cast<VkDeviceSize>(vertexCount);
+    VkDeviceSize indexSize = sizeof(IndexType) * static_cast<VkDeviceSize>(indexCount);
+    VkDeviceSize positionSize = m_PositionStream ? sizeof(opm::vec3) * static_cast<VkDeviceSize>(vertexCount) : 0;
+    VulkanUploadBatch batch{p_Device, p_Allocator};
+    VulkanStagingRing::Region staging = batch.Stage(nullptr, vertexSize + indexSize + positionSize);
+    memcpy(staging.Mapped, pModel->GetVertexData(), vertexSize);
+    // Positions go right after vertices to keep them 4 bytes aligned
+    if (m_PositionStream)
+    {
+        pModel->CopyPositionData(reinterpret_cast<opm::vec3 *>(static_cast<char *>(staging.Mapped) + vertexSize));
+    }
+    memcpy(static_cast<char *>(staging.Mapped) + vertexSize + positionSize, pIndices, indexSize);
+
+    // All streams of the mesh are copied in one submission
+    VkCommandBuffer cmdBuffer = batch.GetTransferCommandBuffer();
+    VkBufferCopy vertexCopy{};
+    vertexCopy.srcOffset = staging.Offset;
+    vertexCopy.dstOffset = sizeof(VulkanVertex) * static_cast<VkDeviceSize>(m_VertexCount);
+    vertexCopy.size = vertexSize;
+    vkCmdCopyBuffer(cmdBuffer, staging.Buffer, m_VertexBuffer.Buffer, 1, &vertexCopy);
+    batch.ReleaseBuffer(m_VertexBuffer.Buffer, vertexCopy.dstOffset, vertexSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+    VkBufferCopy indexCopy{};
+    indexCopy.srcOffset = staging.Offset + vertexSize + positionSize;
+    indexCopy.dstOffset = sizeof(IndexType) * static_cast<VkDeviceSize>(m_IndexCount);
+    indexCopy.size = indexSize;
+    vkCmdCopyBuffer(cmdBuffer, staging.Buffer, m_IndexBuffer.Buffer, 1, &indexCopy);
+    batch.ReleaseBuffer(m_IndexBuffer.Buffer, indexCopy.dstOffset, indexSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+    if (m_PositionStream)
+    {
+        VkBufferCopy positionCopy{};
+        positionCopy.srcOffset = staging.Offset + vertexSize;
+        positionCopy.dstOffset = sizeof(opm::vec3) * static_cast<VkDeviceSize>(m_VertexCount);
+        positionCopy.size = positionSize;
+        vkCmdCopyBuffer(cmdBuffer, staging.Buffer, m_PositionBuffer.Buffer, 1, &positionCopy);
+        batch.ReleaseBuffer(m_PositionBuffer.Buffer, positionCopy.dstOffset, positionSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+    }
+    batch.SubmitAsync();
+
+    MeshRange mesh{};
+    mesh.VertexOffset = static_cast<int32_t>(m_VertexCount);
+    mesh.VertexCount = vertexCount;
+    mesh.FirstIndex = m_IndexCount;
+    mesh.IndexCount = indexCount;
+    m_Meshes.push_back(mesh);
+    m_VertexCount += vertexCount;
+    m_IndexCount += indexCount;
+
+    pModel->ClearVertexData();
+    pModel->ClearIndexData();
+    pModel->m_MeshIndex = static_cast<int32_t>(m_Meshes.size() - 1);
+
+    return static_cast<uint32_t>(pModel->m_MeshIndex);
+}
+
+void VulkanGeometryArena::ResetDraws(uint32_t currentFrame)
+{
+    m_DrawCounts[currentFrame] = 0U;
+    m_Commands[currentFrame].clear();
+}
+
+uint32_t VulkanGeometryArena::AddDraw(uint32_t currentFrame, uint32_t meshIndex, const opm::mat4 &modelMat, uint32_t textureIndex)
+{
+    if (meshIndex >= m_Meshes.size())
+    {
+        FATAL("Invalid mesh index %u!", meshIndex);
+    }
+    uint32_t drawIndex = m_DrawCounts[currentFrame];
+    if (drawIndex >= m_MaxDrawCount)
+    {
+        FATAL("Geometry arena draw count exceeds the maximum %u!", m_MaxDrawCount);
+    }
+
+    DrawParameter parameter{};
+    parameter.ModelMat = modelMat;
+    parameter.TextureIndex = textureIndex;
+    parameter.MeshIndex = meshIndex;
+    memcpy(static_cast<DrawParameter *>(m_DrawParameterBuffers[currentFrame].Mapped) + drawIndex, &parameter, sizeof(DrawParameter));
+
+    const MeshRange &mesh = m_Meshes[meshIndex];
+    VkDrawIndexedIndirectCommand command{};
+    command.indexCount = mesh.IndexCount;
+    command.instanceCount = 1;
+    command.firstIndex = mesh.FirstIndex;
+    command.vertexOffset = mesh.VertexOffset;
+    command.firstInstance = drawIndex;
+    memcpy(static_cast<VkDrawIndexedIndirectCommand *>(m_IndirectBuffers[currentFrame].Mapped) + drawIndex, &command, sizeof(VkDrawIndexedIndirectCommand));
+    m_Commands[currentFrame].push_back(command);
+
+    ++m_DrawCounts[currentFrame];
+
+    return drawIndex;
+}
+
+void VulkanGeometryArena::Bind(VkCommandBuffer cmdBuffer)
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &m_VertexBuffer.Buffer, &offset);
+    vkCmdBindIndexBuffer(cmdBuffer, m_IndexBuffer.Buffer, 0, INDEX_TYPE_FLAG);
+}
+
+void VulkanGeometryArena::BindPositions(VkCommandBuffer cmdBuffer)
+{
+    if (!m_PositionStream)
+    {
+        FATAL("Geometry arena was created without a position stream!");
+    }
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &m_PositionBuffer.Buffer, &offset);
+    vkCmdBindIndexBuffer(cmdBuffer, m_IndexBuffer.Buffer, 0, INDEX_TYPE_FLAG);
+}
+
+void VulkanGeometryArena::DrawIndirect(VkCommandBuffer cmdBuffer, uint32_t currentFrame)
+{
+    DrawIndirect(cmdBuffer, currentFrame, 0, m_DrawCounts[currentFrame]);
+}
+
+void VulkanGeometryArena::DrawIndirect(VkCommandBuffer cmdBuffer, uint32_t currentFrame, uint32_t firstDraw, uint32_t drawCount)
+{
+    if (firstDraw + drawCount > m_DrawCounts[currentFrame])
+    {
+        FATAL("Draw range [%u, %u) exceeds the recorded draw count %u!", firstDraw, firstDraw + drawCount, m_DrawCounts[currentFrame]);
+    }
+    if (drawCount == 0)
+    {
+        return;
+    }
+
+    // firstInstance must be 0 in indirect commands without the feature, issue the same draws directly
+    if (!m_DrawIndirectFirstInstance)
+    {
+        for (uint32_t i = firstDraw; i < firstDraw + drawCount; ++i)
+        {
+            const VkDrawIndexedIndirectCommand &command = m_Commands[currentFrame][i];
+            vkCmdDrawIndexed(cmdBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+        }
+        return;
+    }
+
+    VkDeviceSize offset = sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(firstDraw);
+    if (m_MultiDrawIndirect)
+    {
+        vkCmdDrawIndexedIndirect(cmdBuffer, m_IndirectBuffers[currentFrame].Buffer, offset, drawCount, sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else
+    {
+        for (uint32_t i = 0; i < drawCount; ++i)
+        {
+            vkCmdDrawIndexedIndirect(cmdBuffer, m_IndirectBuffers[currentFrame].Buffer, offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+            offset += sizeof(VkDrawIndexedIndirectCommand);
+        }
+    }
+}
@@ -0,0 +1,139 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_GEOMETRY_ARENA_HEADER
+#define VULKAN_GEOMETRY_ARENA_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "VulkanDevice.h"
+#include "VulkanModel.h"
+#include "VulkanBuffer.h"
+
+#include <vector>
+
+/**
+ * @brief Global geometry storage. Every mesh is sub-allocated into one shared vertex buffer and one shared index buffer,
+ * per-draw parameters live in a storage buffer and draws are issued with vkCmdDrawIndexedIndirect.
+ * @note The draw index is passed as firstInstance, so shaders fetch their draw parameters with gl_InstanceIndex.
+ */
+class DVAPI_ATTR VulkanGeometryArena final
+{
+public:
+    // Per-draw parameters, std430 layout
+    struct DrawParameter
+    {
+        opm::mat4 ModelMat{1.0};
+        uint32_t TextureIndex = 0U;
+        uint32_t MeshIndex = 0U;
+        uint32_t Padding[2] = {0U, 0U};
+    };
+
+    // Mesh range inside the shared buffers
+    struct MeshRange
+    {
+        int32_t VertexOffset = 0;
+        uint32_t VertexCount = 0U;
+        uint32_t FirstIndex = 0U;
+        uint32_t IndexCount = 0U;
+    };
+
+private:
+    VulkanDevice *p_Device = nullptr;
+    const VkAllocationCallbacks *p_Allocator = nullptr;
+    uint32_t m_MaxFramesInFlight = 0U;
+    uint32_t m_MaxVertexCount = 0U;
+    uint32_t m_MaxIndexCount = 0U;
+    uint32_t m_MaxDrawCount = 0U;
+    // Allocated vertex count, the next mesh starts here
+    uint32_t m_VertexCount = 0U;
+    // Allocated index count, the next mesh starts here
+    uint32_t m_IndexCount = 0U;
+    std::vector<MeshRange> m_Meshes = {};
+    // Recorded draw count for each frame
+    std::vector<uint32_t> m_DrawCounts = {};
+    // Host copy of recorded commands for each frame, used when indirect first instance is not supported
+    std::vector<std::vector<VkDrawIndexedIndirectCommand>> m_Commands = {};
+    bool m_MultiDrawIndirect = false;
+    bool m_DrawIndirectFirstInstance = false;
+    bool m_PositionStream = false;
+
+public:
+    VulkanBuffer m_VertexBuffer{};
+    // Position-only stream sharing vertex offsets with m_VertexBuffer, created only if requested
+    VulkanBuffer m_PositionBuffer{};
+    VulkanBuffer m_IndexBuffer{};
+    // Per-frame draw parameters, persistently mapped
+    std::vector<VulkanBuffer> m_DrawParameterBuffers = {};
+    // Per-frame indirect commands, persistently mapped
+    std::vector<VulkanBuffer> m_IndirectBuffers = {};
+
+public:
+    /**
+     * @brief Create the shared buffers.
+     * @param maxVertexCount The capacity of the shared vertex buffer.
+     * @param maxIndexCount The capacity of the shared index buffer.
+     * @param maxDrawCount The maximum number of draws recorded in one frame.
+     * @param positionStream Whether to keep a position-only vertex stream for depth-only passes.
+     */
+    explicit VulkanGeometryArena(VulkanDevice *pDevice,
+                                 uint32_t maxFramesInFlight,
+                                 uint32_t maxVertexCount,
+                                 uint32_t maxIndexCount,
+                                 uint32_t maxDrawCount,
+                                 bool positionStream = false,
+                                 const VkAllocationCallbacks *pAllocator = nullptr);
+    ~VulkanGeometryArena();
+    VulkanGeometryArena(const VulkanGeometryArena &) = delete;
+    VulkanGeometryArena &operator=(const VulkanGeometryArena &) = delete;
+    VulkanGeometryArena(VulkanGeometryArena &&) = delete;
+    VulkanGeometryArena &operator=(VulkanGeometryArena &&) = delete;
+
+    /**
+     * @brief Copy the model geometry into the shared buffers and record the mesh index to the model.
+     * @note This clears the model's CPU vertex and index data. Models without index data get a sequential index list.
+     * @return The mesh index.
+     */
+    uint32_t AddMesh(VulkanModel *pModel);
+    // Clear recorded draws of the frame
+    void ResetDraws(uint32_t currentFrame);
+    /**
+     * @brief Record a draw of the mesh to the frame.
+     * @param modelMat The model matrix written to the storage buffer as is, transpose it if needed.
+     * @return The draw index, which is also the gl_InstanceIndex in shaders.
+     */
+    uint32_t AddDraw(uint32_t currentFrame, uint32_t meshIndex, const opm::mat4 &modelMat, uint32_t textureIndex = 0U);
+    // Bind the shared vertex and index buffer
+    void Bind(VkCommandBuffer cmdBuffer);
+    // Bind the shared position-only stream and index buffer, the recorded draws work unchanged
+    void BindPositions(VkCommandBuffer cmdBuffer);
+    // Draw all recorded draws of the frame
+    void DrawIndirect(VkCommandBuffer cmdBuffer, uint32_t currentFrame);
+    // Draw a range of recorded draws of the frame
+    void DrawIndirect(VkCommandBuffer cmdBuffer, uint32_t currentFrame, uint32_t firstDraw, uint32_t drawCount);
+
+    inline const MeshRange &GetMesh(uint32_t meshIndex) const { return m_Meshes[meshIndex]; }
+    inline uint32_t GetMeshCount() const { return static_cast<uint32_t>(m_Meshes.size()); }
+    inline uint32_t GetDrawCount(uint32_t currentFrame) const { return m_DrawCounts[currentFrame]; }
+    inline uint32_t GetMaxDrawCount() const { return m_MaxDrawCount; }
+};
+
+#endif
@@ -0,0 +1,357 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanHostAllocator.h"
+#include "VulkanLogger.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+VulkanHostAllocator VulkanHostAllocator::s_HostAllocator{};
+
+VulkanHostAllocator::ThreadCache::~ThreadCache()
+{
+    VulkanHostAllocator &allocator = VulkanHostAllocator::GetInstance();
+    for (uint32_t c = 0U; c < SIZE_CLASS_COUNT; ++c)
+    {
+        allocator.Release(c, *this, Counts[c]);
+    }
+}
+
+VulkanHostAllocator::VulkanHostAllocator()
+{
+    for (uint32_t s = 0U; s < HOST_ALLOCATION_SCOPE_COUNT; ++s)
+    {
+        VkAllocationCallbacks &callbacks = m_Scopes[s].Callbacks;
+        // The scope index is carried in the user data, the allocator is the singleton
+        callbacks.pUserData = reinterpret_cast<void *>(static_cast<uintptr_t>(s));
+        callbacks.pfnAllocation = AllocationCallback;
+        callbacks.pfnReallocation = ReallocationCallback;
+        callbacks.pfnFree = FreeCallback;
+        callbacks.pfnInternalAllocation = InternalAllocationCallback;
+        callbacks.pfnInternalFree = InternalFreeCallback;
+    }
+}
+
+VulkanHostAllocator::~VulkanHostAllocator()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (void *pChunk : m_Chunks)
+    {
+        std::free(pChunk);
+    }
+    m_Chunks.clear();
+}
+
+VulkanHostAllocator::ThreadCache &VulkanHostAllocator::GetThreadCache()
+{
+    static thread_local ThreadCache cache{};
+    return cache;
+}
+
+char *VulkanHostAllocator::PopBlock(uint32_t sizeClass)
+{
+    ThreadCache &cache = GetThreadCache();
+    if (cache.Lists[sizeClass] == nullptr)
+    {
+        Refill(sizeClass, cache);
+        if (cache.Lists[sizeClass] == nullptr)
+        {
+            return nullptr;
+        }
+    }
+
+    FreeBlock *pBlock = cache.Lists[sizeClass];
+    cache.Lists[sizeClass] = pBlock->pNext;
+    --cache.Counts[sizeClass];
+    return reinterpret_cast<char *>(pBlock);
+}
+
+void VulkanHostAllocator::PushBlock(uint32_t sizeClass, char *pBlock)
+{
+    ThreadCache &cache = GetThreadCache();
+    FreeBlock *pFree = reinterpret_cast<FreeBlock *>(pBlock);
+    pFree->pNext = cache.Lists[sizeClass];
+    cache.Lists[sizeClass] = pFree;
+    ++cache.Counts[sizeClass];
+
+    // Threads that only free, e.g. a driver worker releasing objects of another thread, hand blocks back in batches
+    if (cache.Counts[sizeClass] > MAX_CACHED_COUNT)
+    {
+        Release(sizeClass, cache, BATCH_SIZE);
+    }
+}
+
+void VulkanHostAllocator::Refill(uint32_t sizeClass, ThreadCache &cache)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_FreeLists[sizeClass] == nullptr)
+    {
+        char *pChunk = static_cast<char *>(std::malloc(CHUNK_SIZE));
+        if (pChunk == nullptr)
+        {
+            return;
+        }
+        m_Chunks.push_back(pChunk);
+
+        const size_t blockSize = static_cast<size_t>(1U) << (sizeClass + MIN_CLASS_ORDER);
+        for (size_t offset = 0U; offset + blockSize <= CHUNK_SIZE; offset += blockSize)
+        {
+            FreeBlock *pBlock = reinterpret_cast<FreeBlock *>(pChunk + offset);
+            pBlock->pNext = m_FreeLists[sizeClass];
+            m_FreeLists[sizeClass] = pBlock;
+        }
+    }
+
+    for (uint32_t i = 0U; i < BATCH_SIZE && m_FreeLists[sizeClass] != nullptr; ++i)
+    {
+        FreeBlock *pBlock = m_FreeLists[sizeClass];
+        m_FreeLists[sizeClass] = pBlock->pNext;
+        pBlock->pNext = cache.Lists[sizeClass];
+        cache.Lists[sizeClass] = pBlock;
+        ++cache.Counts[sizeClass];
+    }
+}
+
+void VulkanHostAllocator::Release(uint32_t sizeClass, ThreadCache &cache, uint32_t count)
+{
+    if (count == 0U)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (uint32_t i = 0U; i < count && cache.Lists[sizeClass] != nullptr; ++i)
+    {
+        FreeBlock *pBlock = cache.Lists[sizeClass];
+        cache.Lists[sizeClass] = pBlock->pNext;
+        --cache.Counts[sizeClass];
+        pBlock->pNext = m_FreeLists[sizeClass];
+        m_FreeLists[sizeClass] = pBlock;
+    }
+}
+
+void *VulkanHostAllocator::Allocate(uint32_t scope, size_t size, size_t alignment)
+{
+    if (size == 0U)
+    {
+        return nullptr;
+    }
+
+    const size_t limit = m_Limit.load(std::memory_order_relaxed);
+    if (limit != 0U && m_LiveSize.load(std::memory_order_relaxed) + size > limit)
+    {
+        m_FailedCount.fetch_add(1U, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    alignment = std::max(alignment, sizeof(Header));
+    const size_t blockSize = size + sizeof(Header);
+    char *pMemory = nullptr;
+    Header *pHeader = nullptr;
+    // Blocks of a class are aligned to 16 bytes, larger alignments go to malloc with padding
+    if (alignment == sizeof(Header) && blockSize <= (static_cast<size_t>(1U) << MAX_CLASS_ORDER))
+    {
+        uint32_t sizeClass = 0U;
+        while ((static_cast<size_t>(1U) << (sizeClass + MIN_CLASS_ORDER)) < blockSize)
+        {
+            ++sizeClass;
+        }
+
+        char *pBlock = PopBlock(sizeClass);
+        if (pBlock == nullptr)
+        {
+            return nullptr;
+        }
+        pHeader = reinterpret_cast<Header *>(pBlock);
+        pHeader->Offset = static_cast<uint32_t>(sizeof(Header));
+        pHeader->SizeClass = static_cast<uint16_t>(sizeClass);
+        pMemory = pBlock + sizeof(Header);
+    }
+    else
+    {
+        char *pRaw = static_cast<char *>(std::malloc(blockSize + alignment));
+        if (pRaw == nullptr)
+        {
+            return nullptr;
+        }
+        uintptr_t address = reinterpret_cast<uintptr_t>(pRaw) + sizeof(Header);
+        address = (address + alignment - 1U) & ~(static_cast<uintptr_t>(alignment) - 1U);
+        pMemory = reinterpret_cast<char *>(address);
+        pHeader = reinterpret_cast<Header *>(pMemory - sizeof(Header));
+        pHeader->Offset = static_cast<uint32_t>(pMemory - pRaw);
+        pHeader->SizeClass = LARGE_CLASS;
+    }
+    pHeader->Size = size;
+    pHeader->Scope = static_cast<uint16_t>(scope);
+
+    Scope &stats = m_Scopes[scope];
+    const size_t live = stats.LiveSize.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = stats.PeakSize.load(std::memory_order_relaxed);
+    while (live > peak && !stats.PeakSize.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+    stats.LiveCount.fetch_add(1U, std::memory_order_relaxed);
+    stats.AllocationCount.fetch_add(1U, std::memory_order_relaxed);
+    m_LiveSize.fetch_add(size, std::memory_order_relaxed);
+
+    return pMemory;
+}
+
+void *VulkanHostAllocator::Reallocate(uint32_t scope, void *pOriginal, size_t size, size_t alignment)
+{
+    if (pOriginal == nullptr)
+    {
+        return Allocate(scope, size, alignment);
+    }
+    if (size == 0U)
+    {
+        Free(pOriginal);
+        return nullptr;
+    }
+
+    Header *pHeader = reinterpret_cast<Header *>(static_cast<char *>(pOriginal) - sizeof(Header));
+    // Shrinking or growing inside the same size class keeps the block
+    if (pHeader->SizeClass != LARGE_CLASS &&
+        size + sizeof(Header) <= (static_cast<size_t>(1U) << (pHeader->SizeClass + MIN_CLASS_ORDER)) &&
+        reinterpret_cast<uintptr_t>(pOriginal) % std::max(alignment, static_cast<size_t>(1U)) == 0U)
+    {
+        Scope &stats = m_Scopes[pHeader->Scope];
+        if (size > pHeader->Size)
+        {
+            stats.LiveSize.fetch_add(size - pHeader->Size, std::memory_order_relaxed);
+            m_LiveSize.fetch_add(size - pHeader->Size, std::memory_order_relaxed);
+        }
+        else
+        {
+            stats.LiveSize.fetch_sub(pHeader->Size - size, std::memory_order_relaxed);
+            m_LiveSize.fetch_sub(pHeader->Size - size, std::memory_order_relaxed);
+        }
+        pHeader->Size = size;
+        return pOriginal;
+    }
+
+    // The original block stays valid if the new allocation fails
+    void *pMemory = Allocate(scope, size, alignment);
+    if (pMemory == nullptr)
+    {
+        return nullptr;
+    }
+    std::memcpy(pMemory, pOriginal, std::min(size, pHeader->Size));
+    Free(pOriginal);
+
+    return pMemory;
+}
+
+void VulkanHostAllocator::Free(void *pMemory)
+{
+    if (pMemory == nullptr)
+    {
+        return;
+    }
+
+    Header *pHeader = reinterpret_cast<Header *>(static_cast<char *>(pMemory) - sizeof(Header));
+    Scope &stats = m_Scopes[pHeader->Scope];
+    stats.LiveSize.fetch_sub(pHeader->Size, std::memory_order_relaxed);
+    stats.LiveCount.fetch_sub(1U, std::memory_order_relaxed);
+    m_LiveSize.fetch_sub(pHeader->Size, std::memory_order_relaxed);
+
+    if (pHeader->SizeClass == LARGE_CLASS)
+    {
+        std::free(static_cast<char *>(pMemory) - pHeader->Offset);
+    }
+    else
+    {
+        PushBlock(pHeader->SizeClass, reinterpret_cast<char *>(pHeader));
+    }
+}
+
+VKAPI_ATTR void *VKAPI_CALL VulkanHostAllocator::AllocationCallback(void *pUserData, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+    (void)allocationScope;
+    return GetInstance().Allocate(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(pUserData)), size, alignment);
+}
+
+VKAPI_ATTR void *VKAPI_CALL VulkanHostAllocator::ReallocationCallback(void *pUserData, void *pOriginal, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+    (void)allocationScope;
+    return GetInstance().Reallocate(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(pUserData)), pOriginal, size, alignment);
+}
+
+VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::FreeCallback(void *pUserData, void *pMemory)
+{
+    (void)pUserData;
+    GetInstance().Free(pMemory);
+}
+
+VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::InternalAllocationCallback(void *pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope)
+{
+    (void)allocationType;
+    (void)allocationScope;
+    GetInstance().m_Scopes[reinterpret_cast<uintptr_t>(pUserData)].InternalSize.fetch_add(size, std::memory_order_relaxed);
+}
+
+VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::InternalFreeCallback(void *pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope)
+{
+    (void)allocationType;
+    (void)allocationScope;
+    GetInstance().m_Scopes[reinterpret_cast<uintptr_t>(pUserData)].InternalSize.fetch_sub(size, std::memory_order_relaxed);
+}
+
+const VkAllocationCallbacks *VulkanHostAllocator::Rescope(const VkAllocationCallbacks *pCallbacks, HostAllocationScopeFlags scope)
+{
+    if (!IsHostAllocator(pCallbacks))
+    {
+        return pCallbacks;
+    }
+    return GetInstance().GetCallbacks(scope);
+}
+
+bool VulkanHostAllocator::IsHostAllocator(const VkAllocationCallbacks *pCallbacks)
+{
+    return pCallbacks != nullptr && pCallbacks->pfnAllocation == AllocationCallback;
+}
+
+const VkAllocationCallbacks *VulkanHostAllocator::GetCallbacks(HostAllocationScopeFlags scope)
+{
+    if (scope >= HOST_ALLOCATION_SCOPE_COUNT)
+    {
+        FATAL("Invalid host allocation scope %u!", scope);
+    }
+    return &m_Scopes[scope].Callbacks;
+}
+
+VulkanHostAllocator::ScopeStatistics VulkanHostAllocator::GetStatistics(HostAllocationScopeFlags scope) const
+{
+    ScopeStatistics statistics{};
+    if (scope >= HOST_ALLOCATION_SCOPE_COUNT)
+    {
+        return statistics;
+    }
+
+    const Scope &stats = m_Scopes[scope];
+    statistics.LiveSize = stats.LiveSize.load(std::memory_order_relaxed);
+    statistics.PeakSize = stats.PeakSize.load(std::memory_order_relaxed);
+    statistics.LiveCount = stats.LiveCount.load(std::memory_order_relaxed);
+    statistics.AllocationCount = stats.AllocationCount.load(std::memory_order_relaxed);
+    statistics.InternalSize = stats.InternalSize.load(std::memory_order_relaxed);
+    return statistics;
+}
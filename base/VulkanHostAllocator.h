@@ -0,0 +1,155 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_HOST_ALLOCATOR_HEADER
+#define VULKAN_HOST_ALLOCATOR_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "VulkanMedium.hpp"
+#include "vulkan/vulkan.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Host allocator behind VkAllocationCallbacks. Small blocks come from per-thread caches of size classes refilled
+ * from shared 64 KiB chunks, larger or over-aligned blocks go to malloc.
+ * @note Each scope has its own callbacks so driver host memory is accounted to instance, device, pipeline and swap chain work.
+ * @note All callbacks share one allocator, so objects may be destroyed with the callbacks of another scope.
+ */
+class DVAPI_ATTR VulkanHostAllocator final
+{
+public:
+    // Snapshot of one scope
+    struct ScopeStatistics
+    {
+        size_t LiveSize = 0U;
+        size_t PeakSize = 0U;
+        uint64_t LiveCount = 0U;
+        uint64_t AllocationCount = 0U;
+        // Driver internal allocations reported through pfnInternalAllocation, not made by this allocator
+        size_t InternalSize = 0U;
+    };
+
+private:
+    struct Scope
+    {
+        VkAllocationCallbacks Callbacks{};
+        std::atomic<size_t> LiveSize{0U};
+        std::atomic<size_t> PeakSize{0U};
+        std::atomic<uint64_t> LiveCount{0U};
+        std::atomic<uint64_t> AllocationCount{0U};
+        std::atomic<size_t> InternalSize{0U};
+    };
+
+    // Stored right in front of every returned pointer
+    struct Header
+    {
+        size_t Size;
+        // Distance from the malloc pointer for large blocks
+        uint32_t Offset;
+        uint16_t SizeClass;
+        uint16_t Scope;
+    };
+    static_assert(sizeof(Header) == 16U, "Header keeps returned pointers 16 bytes aligned!");
+
+    struct FreeBlock
+    {
+        FreeBlock *pNext;
+    };
+
+    // Size classes are 32 to 4096 bytes including the header
+    static constexpr uint32_t MIN_CLASS_ORDER = 5U;
+    static constexpr uint32_t MAX_CLASS_ORDER = 12U;
+    static constexpr uint32_t SIZE_CLASS_COUNT = MAX_CLASS_ORDER - MIN_CLASS_ORDER + 1U;
+    static constexpr uint16_t LARGE_CLASS = 0xFFFFU;
+    static constexpr size_t CHUNK_SIZE = 64U * 1024U;
+    // Blocks moved between a thread cache and the shared lists at once
+    static constexpr uint32_t BATCH_SIZE = 32U;
+    // A thread cache keeps at most this many free blocks per class
+    static constexpr uint32_t MAX_CACHED_COUNT = 4U * BATCH_SIZE;
+
+    struct ThreadCache
+    {
+        FreeBlock *Lists[SIZE_CLASS_COUNT] = {};
+        uint32_t Counts[SIZE_CLASS_COUNT] = {};
+        ~ThreadCache();
+    };
+
+    static VulkanHostAllocator s_HostAllocator;
+    Scope m_Scopes[HOST_ALLOCATION_SCOPE_COUNT];
+    // Guards the shared lists and the chunks
+    std::mutex m_Mutex;
+    FreeBlock *m_FreeLists[SIZE_CLASS_COUNT] = {};
+    std::vector<void *> m_Chunks = {};
+    std::atomic<size_t> m_LiveSize{0U};
+    std::atomic<size_t> m_Limit{0U};
+    std::atomic<uint64_t> m_FailedCount{0U};
+
+    VulkanHostAllocator();
+    ~VulkanHostAllocator();
+    VulkanHostAllocator(const VulkanHostAllocator &) = delete;
+    VulkanHostAllocator &operator=(const VulkanHostAllocator &) = delete;
+    VulkanHostAllocator(VulkanHostAllocator &&) = delete;
+    VulkanHostAllocator &operator=(VulkanHostAllocator &&) = delete;
+
+    static ThreadCache &GetThreadCache();
+    char *PopBlock(uint32_t sizeClass);
+    void PushBlock(uint32_t sizeClass, char *pBlock);
+    // Move up to count blocks of the class from the shared list to the list, carving a new chunk if it is empty
+    void Refill(uint32_t sizeClass, ThreadCache &cache);
+    // Move count blocks of the class from the list back to the shared list
+    void Release(uint32_t sizeClass, ThreadCache &cache, uint32_t count);
+
+    void *Allocate(uint32_t scope, size_t size, size_t alignment);
+    void *Reallocate(uint32_t scope, void *pOriginal, size_t size, size_t alignment);
+    void Free(void *pMemory);
+
+    static VKAPI_ATTR void *VKAPI_CALL AllocationCallback(void *pUserData, size_t size, size_t alignment, VkSystemAllocationScope allocationScope);
+    static VKAPI_ATTR void *VKAPI_CALL ReallocationCallback(void *pUserData, void *pOriginal, size_t size, size_t alignment, VkSystemAllocationScope allocationScope);
+    static VKAPI_ATTR void VKAPI_CALL FreeCallback(void *pUserData, void *pMemory);
+    static VKAPI_ATTR void VKAPI_CALL InternalAllocationCallback(void *pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope);
+    static VKAPI_ATTR void VKAPI_CALL InternalFreeCallback(void *pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope);
+
+public:
+    static inline VulkanHostAllocator &GetInstance() { return VulkanHostAllocator::s_HostAllocator; }
+    /**
+     * @brief Get the callbacks of the scope if pCallbacks belong to this allocator, otherwise pCallbacks itself.
+     * @note Classes receiving the renderer callbacks use this to account their objects to their own scope.
+     */
+    static const VkAllocationCallbacks *Rescope(const VkAllocationCallbacks *pCallbacks, HostAllocationScopeFlags scope);
+    // Whether the callbacks belong to this allocator
+    static bool IsHostAllocator(const VkAllocationCallbacks *pCallbacks);
+
+    // Callbacks whose allocations are accounted to the scope
+    const VkAllocationCallbacks *GetCallbacks(HostAllocationScopeFlags scope);
+    ScopeStatistics GetStatistics(HostAllocationScopeFlags scope) const;
+    // Bound the live host memory, allocations over it fail and the driver returns VK_ERROR_OUT_OF_HOST_MEMORY. 0 means no limit
+    inline void SetLimit(size_t limit) { m_Limit.store(limit); }
+    // Live bytes of all scopes
+    inline size_t GetLiveSize() const { return m_LiveSize.load(); }
+    // Allocations refused because of the limit
+    inline uint64_t GetFailedCount() const { return m_FailedCount.load(); }
+};
+
+#endif
@@ -477,6 +477,15 @@ namespace vkinfo
         return imageBarrier;
     }
 
+    static inline VkBufferMemoryBarrier BufferMemoryBarrier()
+    {
+        VkBufferMemoryBarrier bufferBarrier{};
+        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        return bufferBarrier;
+    }
+
     static inline VkSamplerCreateInfo SamplerInfo()
     {
         VkSamplerCreateInfo samplerInfo{};
@@ -0,0 +1,381 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanKTX2.h"
+#include "VulkanTools.h"
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+namespace
+{
+    const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+    // Identifier, header and index
+    constexpr size_t KTX2_HEADER_SIZE = 80U;
+    constexpr size_t KTX2_LEVEL_INDEX_SIZE = 24U;
+    // Level data is aligned to the least common multiple of the block size and 4, 16 covers every supported format
+    constexpr size_t KTX2_LEVEL_ALIGNMENT = 16U;
+    // Upper bound of array layers accepted from a file, above the maxImageArrayLayers of common devices
+    constexpr uint32_t KTX2_MAX_LAYER_COUNT = 2048U;
+
+    // Khronos data format descriptor values
+    constexpr uint32_t KHR_DF_MODEL_RGBSDA = 1U;
+    constexpr uint32_t KHR_DF_MODEL_BC1A = 128U;
+    constexpr uint32_t KHR_DF_MODEL_BC3 = 130U;
+    constexpr uint32_t KHR_DF_MODEL_BC4 = 131U;
+    constexpr uint32_t KHR_DF_MODEL_BC5 = 132U;
+    constexpr uint32_t KHR_DF_MODEL_BC7 = 134U;
+    constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1U;
+    constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1U;
+    constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2U;
+    constexpr uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10U;
+    constexpr uint32_t KHR_DF_SAMPLE_DATATYPE_SIGNED = 0x40U;
+
+    struct DFDSample
+    {
+        uint32_t BitOffset;
+        uint32_t BitLength;
+        uint32_t Channel;
+    };
+
+    template <typename T>
+    T ReadValue(const std::vector<uint8_t> &bytes, size_t offset)
+    {
+        T value{};
+        memcpy(&value, bytes.data() + offset, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void WriteValue(std::vector<uint8_t> &bytes, size_t offset, T value)
+    {
+        memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+
+    // a * b, false if the product does not fit in 64 bits
+    bool MultiplyChecked(uint64_t a, uint64_t b, uint64_t &product)
+    {
+        if (a != 0U && b > UINT64_MAX / a)
+        {
+            return false;
+        }
+        product = a * b;
+        return true;
+    }
+
+    bool IsSRGB(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+bool VulkanKTX2::IsKTX2File(const std::string &filePath)
+{
+    const std::string extension = ".ktx2";
+    if (filePath.size() < extension.size())
+    {
+        return false;
+    }
+    return std::equal(extension.rbegin(), extension.rend(), filePath.rbegin(),
+                      [](char a, char b) -> bool
+                      {
+                          return a == static_cast<char>(std::tolower(static_cast<unsigned char>(b)));
+                      });
+}
+
+uint32_t VulkanKTX2::GetBlockSize(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+        return 8U;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return 16U;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return 4U;
+    default:
+        return 0U;
+    }
+}
+
+bool VulkanKTX2::IsBlockCompressed(VkFormat format)
+{
+    return GetBlockSize(format) != 0U && format != VK_FORMAT_R8G8B8A8_UNORM && format != VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+VkDeviceSize VulkanKTX2::GetImageSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    if (IsBlockCompressed(format))
+    {
+        return static_cast<VkDeviceSize>((width + 3U) / 4U) * ((height + 3U) / 4U) * GetBlockSize(format);
+    }
+    return static_cast<VkDeviceSize>(width) * height * GetBlockSize(format);
+}
+
+void VulkanKTX2::Load(const std::string &filePath)
+{
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        FATAL("Failed to open KTX2 file %s!", filePath.c_str());
+    }
+    const size_t fileSize = static_cast<size_t>(file.tellg());
+    std::vector<uint8_t> bytes(fileSize);
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(fileSize));
+    file.close();
+
+    if (fileSize < KTX2_HEADER_SIZE || memcmp(bytes.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    {
+        FATAL("%s is not a KTX2 file!", filePath.c_str());
+    }
+
+    const VkFormat format = static_cast<VkFormat>(ReadValue<uint32_t>(bytes, 12));
+    const uint32_t width = ReadValue<uint32_t>(bytes, 20);
+    const uint32_t height = ReadValue<uint32_t>(bytes, 24);
+    const uint32_t depth = ReadValue<uint32_t>(bytes, 28);
+    const uint32_t layerCount = ReadValue<uint32_t>(bytes, 32);
+    const uint32_t faceCount = ReadValue<uint32_t>(bytes, 36);
+    const uint32_t levelCount = ReadValue<uint32_t>(bytes, 40);
+    const uint32_t supercompressionScheme = ReadValue<uint32_t>(bytes, 44);
+    if (supercompressionScheme != 0U)
+    {
+        FATAL("Supercompressed KTX2 file %s is not supported!", filePath.c_str());
+    }
+    if (GetBlockSize(format) == 0U)
+    {
+        FATAL("KTX2 file %s has unsupported format %u!", filePath.c_str(), static_cast<uint32_t>(format));
+    }
+    if (width == 0U || height == 0U || depth > 1U || (faceCount != 1U && faceCount != 6U))
+    {
+        FATAL("KTX2 file %s is not a 2D texture, texture array or cube map!", filePath.c_str());
+    }
+    if (layerCount > KTX2_MAX_LAYER_COUNT)
+    {
+        FATAL("KTX2 file %s has %u layers, at most %u are supported!", filePath.c_str(), layerCount, KTX2_MAX_LAYER_COUNT);
+    }
+    // A full mip chain has floor(log2(max(width, height))) + 1 levels, which also keeps the shifts below under 32
+    uint32_t maxLevelCount = 1U;
+    for (uint32_t extent = (std::max)(width, height) >> 1U; extent != 0U; extent >>= 1U)
+    {
+        ++maxLevelCount;
+    }
+    if (levelCount > maxLevelCount)
+    {
+        FATAL("KTX2 file %s has %u levels, a %ux%u image has at most %u!", filePath.c_str(), levelCount, width, height, maxLevelCount);
+    }
+
+    Format = format;
+    Width = width;
+    Height = height;
+    LayerCount = (std::max)(layerCount, 1U);
+    FaceCount = faceCount;
+    // Level count 0 asks the loader to generate mipmaps, the file still holds level 0
+    const uint32_t fileLevelCount = (std::max)(levelCount, 1U);
+    if (KTX2_HEADER_SIZE + static_cast<size_t>(fileLevelCount) * KTX2_LEVEL_INDEX_SIZE > fileSize)
+    {
+        FATAL("KTX2 file %s is truncated!", filePath.c_str());
+    }
+
+    // Level sizes come from the header, every level must fit in the file before anything is allocated for them
+    Levels.resize(fileLevelCount);
+    const bool compressed = IsBlockCompressed(format);
+    uint64_t dataSize = 0U;
+    for (uint32_t i = 0; i < fileLevelCount; ++i)
+    {
+        const uint64_t levelWidth = (std::max)(width >> i, 1U);
+        const uint64_t levelHeight = (std::max)(height >> i, 1U);
+        uint64_t size = 0U;
+        bool valid = MultiplyChecked(compressed ? (levelWidth + 3U) / 4U : levelWidth, compressed ? (levelHeight + 3U) / 4U : levelHeight, size) &&
+                     MultiplyChecked(size, GetBlockSize(format), size) &&
+                     MultiplyChecked(size, LayerCount, size) &&
+                     MultiplyChecked(size, FaceCount, size);
+        if (!valid || size > fileSize || dataSize > fileSize - size)
+        {
+            FATAL("KTX2 file %s is truncated or its level %u is too large!", filePath.c_str(), i);
+        }
+        Levels[i].Offset = dataSize;
+        Levels[i].Size = size;
+        dataSize += size;
+    }
+
+    // Level data is stored smallest first in the file, keep the largest first here so offsets follow the level index
+    Data.resize(static_cast<size_t>(dataSize));
+    for (uint32_t i = 0; i < fileLevelCount; ++i)
+    {
+        const size_t index = KTX2_HEADER_SIZE + static_cast<size_t>(i) * KTX2_LEVEL_INDEX_SIZE;
+        const uint64_t byteOffset = ReadValue<uint64_t>(bytes, index);
+        const uint64_t byteLength = ReadValue<uint64_t>(bytes, index + 8U);
+        if (byteLength < Levels[i].Size || Levels[i].Size > fileSize || byteOffset > fileSize - Levels[i].Size)
+        {
+            FATAL("KTX2 file %s has an invalid level %u!", filePath.c_str(), i);
+        }
+        memcpy(Data.data() + Levels[i].Offset, bytes.data() + byteOffset, static_cast<size_t>(Levels[i].Size));
+    }
+}
+
+void VulkanKTX2::Save(const std::string &filePath) const
+{
+    if (GetBlockSize(Format) == 0U || Levels.empty())
+    {
+        FATAL("Can not save an empty KTX2 image or unsupported format %u!", static_cast<uint32_t>(Format));
+    }
+
+    // Basic data format descriptor
+    uint32_t model = KHR_DF_MODEL_RGBSDA;
+    uint32_t bytesPlane = GetBlockSize(Format);
+    std::vector<DFDSample> samples = {};
+    switch (Format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        model = KHR_DF_MODEL_BC1A;
+        samples = {{0U, 64U, 0U}};
+        break;
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        model = KHR_DF_MODEL_BC1A;
+        // KHR_DF_CHANNEL_BC1A_ALPHAPRESENT
+        samples = {{0U, 64U, 1U}};
+        break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        model = KHR_DF_MODEL_BC3;
+        samples = {{0U, 64U, 15U | KHR_DF_SAMPLE_DATATYPE_LINEAR}, {64U, 64U, 0U}};
+        break;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+        model = KHR_DF_MODEL_BC4;
+        samples = {{0U, 64U, 0U}};
+        break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        model = KHR_DF_MODEL_BC5;
+        samples = {{0U, 64U, 0U}, {64U, 64U, 1U}};
+        break;
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+        model = KHR_DF_MODEL_BC5;
+        samples = {{0U, 64U, KHR_DF_SAMPLE_DATATYPE_SIGNED}, {64U, 64U, 1U | KHR_DF_SAMPLE_DATATYPE_SIGNED}};
+        break;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        model = KHR_DF_MODEL_BC7;
+        samples = {{0U, 128U, 0U}};
+        break;
+    default:
+        samples = {{0U, 8U, 0U}, {8U, 8U, 1U}, {16U, 8U, 2U}, {24U, 8U, 15U | (IsSRGB(Format) ? KHR_DF_SAMPLE_DATATYPE_LINEAR : 0U)}};
+        break;
+    }
+    const bool compressed = IsBlockCompressed(Format);
+    const uint32_t blockSize = 24U + 16U * static_cast<uint32_t>(samples.size());
+    std::vector<uint32_t> dfd = {};
+    dfd.push_back(4U + blockSize);
+    // Vendor Khronos, descriptor type basic
+    dfd.push_back(0U);
+    // Version 1.3
+    dfd.push_back(2U | (blockSize << 16U));
+    dfd.push_back(model | (KHR_DF_PRIMARIES_BT709 << 8U) | ((IsSRGB(Format) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16U));
+    // Texel block dimensions minus one
+    dfd.push_back(compressed ? (3U | (3U << 8U)) : 0U);
+    dfd.push_back(bytesPlane);
+    dfd.push_back(0U);
+    for (const DFDSample &sample : samples)
+    {
+        const bool isSigned = (sample.Channel & KHR_DF_SAMPLE_DATATYPE_SIGNED) != 0U;
+        dfd.push_back(sample.BitOffset | ((sample.BitLength - 1U) << 16U) | (sample.Channel << 24U));
+        dfd.push_back(0U);
+        if (compressed)
+        {
+            dfd.push_back(isSigned ? 0x80000000U : 0U);
+            dfd.push_back(isSigned ? 0x7FFFFFFFU : 0xFFFFFFFFU);
+        }
+        else
+        {
+            dfd.push_back(0U);
+            dfd.push_back(255U);
+        }
+    }
+
+    const uint32_t levelCount = static_cast<uint32_t>(Levels.size());
+    const size_t dfdOffset = KTX2_HEADER_SIZE + static_cast<size_t>(levelCount) * KTX2_LEVEL_INDEX_SIZE;
+    const size_t dfdSize = dfd.size() * sizeof(uint32_t);
+    // Levels are written smallest first
+    std::vector<size_t> levelOffsets(levelCount, 0U);
+    size_t fileSize = dfdOffset + dfdSize;
+    for (uint32_t i = levelCount; i-- > 0;)
+    {
+        fileSize = (fileSize + KTX2_LEVEL_ALIGNMENT - 1U) & ~(KTX2_LEVEL_ALIGNMENT - 1U);
+        levelOffsets[i] = fileSize;
+        fileSize += static_cast<size_t>(Levels[i].Size);
+    }
+
+    std::vector<uint8_t> bytes(fileSize, 0U);
+    memcpy(bytes.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    WriteValue<uint32_t>(bytes, 12, static_cast<uint32_t>(Format));
+    // Type size is 1 for block-compressed and 8-bit formats
+    WriteValue<uint32_t>(bytes, 16, 1U);
+    WriteValue<uint32_t>(bytes, 20, Width);
+    WriteValue<uint32_t>(bytes, 24, Height);
+    WriteValue<uint32_t>(bytes, 28, 0U);
+    WriteValue<uint32_t>(bytes, 32, LayerCount > 1U ? LayerCount : 0U);
+    WriteValue<uint32_t>(bytes, 36, FaceCount);
+    WriteValue<uint32_t>(bytes, 40, levelCount);
+    WriteValue<uint32_t>(bytes, 44, 0U);
+    WriteValue<uint32_t>(bytes, 48, static_cast<uint32_t>(dfdOffset));
+    WriteValue<uint32_t>(bytes, 52, static_cast<uint32_t>(dfdSize));
+    // No key/value data and no supercompression global data
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        const size_t index = KTX2_HEADER_SIZE + static_cast<size_t>(i) * KTX2_LEVEL_INDEX_SIZE;
+        WriteValue<uint64_t>(bytes, index, static_cast<uint64_t>(levelOffsets[i]));
+        WriteValue<uint64_t>(bytes, index + 8U, static_cast<uint64_t>(Levels[i].Size));
+        WriteValue<uint64_t>(bytes, index + 16U, static_cast<uint64_t>(Levels[i].Size));
+        memcpy(bytes.data() + levelOffsets[i], Data.data() + Levels[i].Offset, static_cast<size_t>(Levels[i].Size));
+    }
+    memcpy(bytes.data() + dfdOffset, dfd.data(), dfdSize);
+
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        FATAL("Failed to create KTX2 file %s!", filePath.c_str());
+    }
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    file.close();
+}
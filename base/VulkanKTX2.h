@@ -0,0 +1,79 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_KTX2_HEADER
+#define VULKAN_KTX2_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "vulkan/vulkan.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief KTX2 container without supercompression, holding block-compressed (BC1-BC7) or RGBA8 images with their mip chain.
+ * @note Level data keeps the KTX2 layout, layers first, then faces. Levels[0] is the largest level.
+ */
+class DVAPI_ATTR VulkanKTX2 final
+{
+public:
+    // Level range inside Data
+    struct Level
+    {
+        VkDeviceSize Offset = 0U;
+        VkDeviceSize Size = 0U;
+    };
+
+    VkFormat Format = VK_FORMAT_UNDEFINED;
+    uint32_t Width = 0U;
+    uint32_t Height = 0U;
+    uint32_t LayerCount = 1U;
+    // 6 for cube maps
+    uint32_t FaceCount = 1U;
+    std::vector<Level> Levels = {};
+    std::vector<uint8_t> Data = {};
+
+    VulkanKTX2() = default;
+    ~VulkanKTX2() = default;
+    VulkanKTX2(const VulkanKTX2 &) = delete;
+    VulkanKTX2 &operator=(const VulkanKTX2 &) = delete;
+    VulkanKTX2(VulkanKTX2 &&) = default;
+    VulkanKTX2 &operator=(VulkanKTX2 &&) = default;
+
+    // Load a KTX2 file, supercompressed files and unsupported formats are rejected
+    void Load(const std::string &filePath);
+    // Write the image with a basic data format descriptor, the level data must follow the KTX2 layout
+    void Save(const std::string &filePath) const;
+
+    inline uint32_t GetLevelCount() const { return static_cast<uint32_t>(Levels.size()); }
+
+    // Whether the file path has the .ktx2 extension
+    static bool IsKTX2File(const std::string &filePath);
+    // Bytes of a 4x4 block for BCn formats, bytes of a texel for RGBA8, 0 if unsupported
+    static uint32_t GetBlockSize(VkFormat format);
+    static bool IsBlockCompressed(VkFormat format);
+    // Bytes of one layer and face of the level extent
+    static VkDeviceSize GetImageSize(VkFormat format, uint32_t width, uint32_t height);
+};
+
+#endif
@@ -62,6 +62,44 @@ typedef enum CameraType
 
 typedef TypeFlags CameraTypeFlags;
 
+typedef enum StreamStateFlagBits
+{
+    STREAM_STATE_LOADING = 0U,
+    STREAM_STATE_READY = 1U,
+    STREAM_STATE_FAILED = 2U
+} StreamStateFlagBits;
+
+typedef TypeFlags StreamStateFlags;
+
+typedef enum HostAllocationScopeFlagBits
+{
+    HOST_ALLOCATION_SCOPE_INSTANCE = 0U,
+    HOST_ALLOCATION_SCOPE_DEVICE = 1U,
+    HOST_ALLOCATION_SCOPE_PIPELINE = 2U,
+    HOST_ALLOCATION_SCOPE_SWAPCHAIN = 3U,
+    HOST_ALLOCATION_SCOPE_COUNT = 4U
+} HostAllocationScopeFlagBits;
+
+typedef TypeFlags HostAllocationScopeFlags;
+
+// Immutable resources are created once and shared by all frames in flight, per-frame resources have one copy per frame slot
+typedef enum ResourceLifetimeFlagBits
+{
+    RESOURCE_LIFETIME_IMMUTABLE = 0U,
+    RESOURCE_LIFETIME_PER_FRAME = 1U
+} ResourceLifetimeFlagBits;
+
+typedef TypeFlags ResourceLifetimeFlags;
+
+// Color textures are sampled as sRGB, data textures such as normal, metallic, roughness and mask maps as UNORM
+typedef enum TextureUsageFlagBits
+{
+    TEXTURE_USAGE_COLOR = 0U,
+    TEXTURE_USAGE_DATA = 1U
+} TextureUsageFlagBits;
+
+typedef TypeFlags TextureUsageFlags;
+
 // Including Graphics, Present, Transfer and Compute queue index
 struct DVAPI_ATTR QueueFamilyIndices
 {
@@ -0,0 +1,311 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+
+#include "VulkanMemoryAllocator.h"
+#include "VulkanTools.h"
+#include "VulkanInitializer.hpp"
+
+#include <algorithm>
+
+// Smallest n such that (1 << n) >= value
+static uint32_t CeilLog2(VkDeviceSize value)
+{
+    uint32_t n = 0U;
+    while ((VkDeviceSize{1} << n) < value)
+    {
+        ++n;
+    }
+    return n;
+}
+
+// Largest n such that (1 << n) <= value
+static uint32_t FloorLog2(VkDeviceSize value)
+{
+    uint32_t n = 0U;
+    while ((value >> (n + 1)) != 0)
+    {
+        ++n;
+    }
+    return n;
+}
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(VkPhysicalDevice gpu,
+                                             VkDevice device,
+                                             VkDeviceSize bufferImageGranularity,
+                                             VkDeviceSize blockSize,
+                                             const VkAllocationCallbacks *pAllocator)
+{
+    if (gpu == VK_NULL_HANDLE || device == VK_NULL_HANDLE)
+    {
+        FATAL("Memory allocator must be created with a valid device!");
+    }
+
+    m_GPU = gpu;
+    m_Device = device;
+    p_Allocator = pAllocator;
+    m_BufferImageGranularity = std::max<VkDeviceSize>(bufferImageGranularity, 1U);
+    // Every range is aligned to its own size, so ranges never share a granularity page if it is not larger than the minimum range
+    m_SeparateLinearPools = m_BufferImageGranularity > (VkDeviceSize{1} << MIN_ORDER);
+    vkGetPhysicalDeviceMemoryProperties(m_GPU, &m_MemoryProperties);
+
+    uint32_t preferredOrder = FloorLog2(std::max<VkDeviceSize>(blockSize, VkDeviceSize{1} << MIN_ORDER));
+    m_Pools.resize(m_MemoryProperties.memoryTypeCount * 2);
+    for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; ++i)
+    {
+        const VkMemoryType &type = m_MemoryProperties.memoryTypes[i];
+        // Small heaps (e.g. resizable BAR windows) get blocks of at most 1/8 of the heap
+        VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[type.heapIndex].size;
+        uint32_t heapOrder = FloorLog2(std::max<VkDeviceSize>(heapSize / 8, VkDeviceSize{1} << MIN_ORDER));
+        for (uint32_t j = 0; j < 2; ++j)
+        {
+            Pool &pool = m_Pools[i * 2 + j];
+            pool.MemoryTypeIndex = i;
+            pool.MaxOrder = std::min(preferredOrder, heapOrder) - MIN_ORDER;
+            pool.HostVisible = (type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+        }
+    }
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+    if (m_AllocationCount != 0)
+    {
+        WARNING("%u device memory allocations are not freed before destroying the memory allocator!\n", m_AllocationCount);
+    }
+    for (auto &pool : m_Pools)
+    {
+        for (auto &block : pool.Blocks)
+        {
+            if (block.Memory != VK_NULL_HANDLE)
+            {
+                if (block.Mapped != nullptr)
+                {
+                    vkUnmapMemory(m_Device, block.Memory);
+                }
+                vkFreeMemory(m_Device, block.Memory, p_Allocator);
+            }
+        }
+    }
+}
+
+uint32_t VulkanMemoryAllocator::CreateBlock(Pool &pool)
+{
+    Block block{};
+    VkMemoryAllocateInfo allocInfo = vkinfo::MemoryAllocInfo(VkDeviceSize{1} << (MIN_ORDER + pool.MaxOrder), pool.MemoryTypeIndex);
+    CHECK_VK_RESULT(vkAllocateMemory(m_Device, &allocInfo, p_Allocator, &block.Memory));
+    if (pool.HostVisible)
+    {
+        CHECK_VK_RESULT(vkMapMemory(m_Device, block.Memory, 0, VK_WHOLE_SIZE, 0, &block.Mapped));
+    }
+    block.FreeLists.resize(pool.MaxOrder + 1);
+    block.FreeLists[pool.MaxOrder].insert(0);
+    ++m_DeviceMemoryCount;
+    m_HeapUsage[m_MemoryProperties.memoryTypes[pool.MemoryTypeIndex].heapIndex] += allocInfo.allocationSize;
+
+    // Reuse a released slot
+    for (uint32_t i = 0; i < pool.Blocks.size(); ++i)
+    {
+        if (pool.Blocks[i].Memory == VK_NULL_HANDLE)
+        {
+            pool.Blocks[i] = std::move(block);
+            return i;
+        }
+    }
+    pool.Blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(pool.Blocks.size() - 1);
+}
+
+bool VulkanMemoryAllocator::AllocateFromBlock(Pool &pool, uint32_t blockIndex, uint32_t order, VulkanMemoryAllocation *pAllocation)
+{
+    Block &block = pool.Blocks[blockIndex];
+    if (block.Memory == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    uint32_t found = order;
+    while (found <= pool.MaxOrder && block.FreeLists[found].empty())
+    {
+        ++found;
+    }
+    if (found > pool.MaxOrder)
+    {
+        return false;
+    }
+
+    VkDeviceSize offset = *block.FreeLists[found].begin();
+    block.FreeLists[found].erase(block.FreeLists[found].begin());
+    // Split down to the requested order, the upper halves become free buddies
+    while (found > order)
+    {
+        --found;
+        block.FreeLists[found].insert(offset + (VkDeviceSize{1} << (MIN_ORDER + found)));
+    }
+
+    ++block.AllocationCount;
+    pAllocation->Memory = block.Memory;
+    pAllocation->Offset = offset;
+    pAllocation->Size = VkDeviceSize{1} << (MIN_ORDER + order);
+    pAllocation->Mapped = block.Mapped != nullptr ? static_cast<char *>(block.Mapped) + offset : nullptr;
+    pAllocation->BlockIndex = blockIndex;
+    pAllocation->Order = order;
+    return true;
+}
+
+void VulkanMemoryAllocator::AllocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex, VkMemoryAllocateFlags allocateFlags, VulkanMemoryAllocation *pAllocation)
+{
+    VkMemoryAllocateInfo allocInfo = vkinfo::MemoryAllocInfo(size, memoryTypeIndex);
+    VkMemoryAllocateFlagsInfoKHR allocFlagsInfo{};
+    if (allocateFlags != 0)
+    {
+        allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR;
+        allocFlagsInfo.flags = allocateFlags;
+        allocInfo.pNext = &allocFlagsInfo;
+    }
+    CHECK_VK_RESULT(vkAllocateMemory(m_Device, &allocInfo, p_Allocator, &pAllocation->Memory));
+    pAllocation->Offset = 0;
+    pAllocation->Size = size;
+    pAllocation->Mapped = nullptr;
+    if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        CHECK_VK_RESULT(vkMapMemory(m_Device, pAllocation->Memory, 0, VK_WHOLE_SIZE, 0, &pAllocation->Mapped));
+    }
+    pAllocation->BlockIndex = UINT32_MAX;
+    pAllocation->Order = 0;
+    ++m_DeviceMemoryCount;
+    m_HeapUsage[m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex] += size;
+}
+
+void VulkanMemoryAllocator::Allocate(const VkMemoryRequirements &requirements,
+                                     VkMemoryPropertyFlags properties,
+                                     bool linear,
+                                     VulkanMemoryAllocation *pAllocation,
+                                     VkMemoryAllocateFlags allocateFlags)
+{
+    if (pAllocation == nullptr)
+    {
+        FATAL("The address of allocation must be valid!");
+    }
+
+    uint32_t memoryTypeIndex = FindMemoryTypeIndex(m_GPU, requirements.memoryTypeBits, properties);
+    uint32_t poolIndex = memoryTypeIndex * 2 + ((m_SeparateLinearPools && !linear) ? 1 : 0);
+    Pool &pool = m_Pools[poolIndex];
+    uint32_t order = CeilLog2(std::max(requirements.size, requirements.alignment));
+    order = order > MIN_ORDER ? order - MIN_ORDER : 0U;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    pAllocation->PoolIndex = poolIndex;
+    if (allocateFlags != 0 || order > pool.MaxOrder)
+    {
+        AllocateDedicated(requirements.size, memoryTypeIndex, allocateFlags, pAllocation);
+    }
+    else
+    {
+        bool allocated = false;
+        for (uint32_t i = 0; i < pool.Blocks.size() && !allocated; ++i)
+        {
+            allocated = AllocateFromBlock(pool, i, order, pAllocation);
+        }
+        if (!allocated)
+        {
+            AllocateFromBlock(pool, CreateBlock(pool), order, pAllocation);
+        }
+    }
+    ++m_AllocationCount;
+    m_AllocatedSize += pAllocation->Size;
+}
+
+void VulkanMemoryAllocator::Free(VulkanMemoryAllocation *pAllocation)
+{
+    if (pAllocation == nullptr || pAllocation->Memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    --m_AllocationCount;
+    m_AllocatedSize -= pAllocation->Size;
+    if (pAllocation->BlockIndex == UINT32_MAX)
+    {
+        if (pAllocation->Mapped != nullptr)
+        {
+            vkUnmapMemory(m_Device, pAllocation->Memory);
+        }
+        vkFreeMemory(m_Device, pAllocation->Memory, p_Allocator);
+        --m_DeviceMemoryCount;
+        m_HeapUsage[m_MemoryProperties.memoryTypes[m_Pools[pAllocation->PoolIndex].MemoryTypeIndex].heapIndex] -= pAllocation->Size;
+        *pAllocation = VulkanMemoryAllocation{};
+        return;
+    }
+
+    Pool &pool = m_Pools[pAllocation->PoolIndex];
+    Block &block = pool.Blocks[pAllocation->BlockIndex];
+    VkDeviceSize offset = pAllocation->Offset;
+    uint32_t order = pAllocation->Order;
+    // Merge with free buddies as far as possible
+    while (order < pool.MaxOrder)
+    {
+        VkDeviceSize buddy = offset ^ (VkDeviceSize{1} << (MIN_ORDER + order));
+        auto it = block.FreeLists[order].find(buddy);
+        if (it == block.FreeLists[order].end())
+        {
+            break;
+        }
+        block.FreeLists[order].erase(it);
+        offset = std::min(offset, buddy);
+        ++order;
+    }
+    block.FreeLists[order].insert(offset);
+    --block.AllocationCount;
+
+    // Release empty blocks but keep the last one of the pool to avoid allocation churn
+    if (block.AllocationCount == 0)
+    {
+        uint32_t liveBlockCount = 0;
+        for (const auto &b : pool.Blocks)
+        {
+            liveBlockCount += b.Memory != VK_NULL_HANDLE ? 1 : 0;
+        }
+        if (liveBlockCount > 1)
+        {
+            if (block.Mapped != nullptr)
+            {
+                vkUnmapMemory(m_Device, block.Memory);
+            }
+            vkFreeMemory(m_Device, block.Memory, p_Allocator);
+            block = Block{};
+            --m_DeviceMemoryCount;
+            m_HeapUsage[m_MemoryProperties.memoryTypes[pool.MemoryTypeIndex].heapIndex] -= VkDeviceSize{1} << (MIN_ORDER + pool.MaxOrder);
+        }
+    }
+    *pAllocation = VulkanMemoryAllocation{};
+}
+
+VkDeviceSize VulkanMemoryAllocator::GetHeapUsage(uint32_t heapIndex)
+{
+    if (heapIndex >= m_MemoryProperties.memoryHeapCount)
+    {
+        FATAL("Invalid memory heap index %u!", heapIndex);
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_HeapUsage[heapIndex];
+}
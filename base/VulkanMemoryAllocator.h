@@ -0,0 +1,139 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_MEMORY_ALLOCATOR_HEADER
+#define VULKAN_MEMORY_ALLOCATOR_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "vulkan/vulkan.h"
+
+#include <array>
+#include <vector>
+#include <unordered_set>
+#include <mutex>
+
+// A range of device memory handed out by VulkanMemoryAllocator
+struct DVAPI_ATTR VulkanMemoryAllocation
+{
+    VkDeviceMemory Memory = VK_NULL_HANDLE;
+    VkDeviceSize Offset = 0U;
+    // Reserved size, a power of two not smaller than the requested size
+    VkDeviceSize Size = 0U;
+    // Persistently mapped address of Offset, nullptr if the memory is not host visible
+    void *Mapped = nullptr;
+    uint32_t PoolIndex = UINT32_MAX;
+    // UINT32_MAX for dedicated allocations
+    uint32_t BlockIndex = UINT32_MAX;
+    uint32_t Order = 0U;
+};
+
+/**
+ * @brief Buddy sub-allocator. Each memory type owns pools of large VkDeviceMemory blocks, resources get power of two ranges inside them.
+ * @note Host visible blocks are mapped once at creation, so sub-allocated buffers never call vkMapMemory themselves.
+ * @note Linear and optimal resources are kept in separate pools if bufferImageGranularity is larger than the minimum range size.
+ */
+class DVAPI_ATTR VulkanMemoryAllocator final
+{
+private:
+    struct Block
+    {
+        VkDeviceMemory Memory = VK_NULL_HANDLE;
+        void *Mapped = nullptr;
+        uint32_t AllocationCount = 0U;
+        // Free range offsets of each order, order 0 is the minimum range size
+        std::vector<std::unordered_set<VkDeviceSize>> FreeLists = {};
+    };
+
+    struct Pool
+    {
+        uint32_t MemoryTypeIndex = 0U;
+        // Block size is 1 << (MIN_ORDER + MaxOrder)
+        uint32_t MaxOrder = 0U;
+        bool HostVisible = false;
+        // Released blocks keep their slot with a null memory handle so block indices stay valid
+        std::vector<Block> Blocks = {};
+    };
+
+    VkPhysicalDevice m_GPU = VK_NULL_HANDLE;
+    VkDevice m_Device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks *p_Allocator = nullptr;
+    VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+    VkDeviceSize m_BufferImageGranularity = 1U;
+    bool m_SeparateLinearPools = false;
+    // Indexed by memoryTypeIndex * 2 + (linear ? 0 : 1)
+    std::vector<Pool> m_Pools = {};
+    std::mutex m_Mutex;
+    // Statistics
+    uint32_t m_DeviceMemoryCount = 0U;
+    uint32_t m_AllocationCount = 0U;
+    VkDeviceSize m_AllocatedSize = 0U;
+    // Bytes of live VkDeviceMemory objects in each heap, the software fallback of VK_EXT_memory_budget
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_HeapUsage = {};
+
+    // Minimum range size is 256 bytes
+    static constexpr uint32_t MIN_ORDER = 8U;
+
+    bool AllocateFromBlock(Pool &pool, uint32_t blockIndex, uint32_t order, VulkanMemoryAllocation *pAllocation);
+    uint32_t CreateBlock(Pool &pool);
+    void AllocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex, VkMemoryAllocateFlags allocateFlags, VulkanMemoryAllocation *pAllocation);
+
+public:
+    /**
+     * @param blockSize The preferred size of each VkDeviceMemory block, rounded down to a power of two and shrunk for small heaps.
+     */
+    explicit VulkanMemoryAllocator(VkPhysicalDevice gpu,
+                                   VkDevice device,
+                                   VkDeviceSize bufferImageGranularity,
+                                   VkDeviceSize blockSize = 64ULL * 1024ULL * 1024ULL,
+                                   const VkAllocationCallbacks *pAllocator = nullptr);
+    ~VulkanMemoryAllocator();
+    VulkanMemoryAllocator(const VulkanMemoryAllocator &) = delete;
+    VulkanMemoryAllocator &operator=(const VulkanMemoryAllocator &) = delete;
+    VulkanMemoryAllocator(VulkanMemoryAllocator &&) = delete;
+    VulkanMemoryAllocator &operator=(VulkanMemoryAllocator &&) = delete;
+
+    /**
+     * @brief Sub-allocate a memory range satisfying the requirements.
+     * @param linear True for buffers and linear tiling images, false for optimal tiling images.
+     * @param allocateFlags Non-zero flags (e.g. device address) get a dedicated allocation.
+     * @note Requests larger than one block get a dedicated allocation.
+     */
+    void Allocate(const VkMemoryRequirements &requirements,
+                  VkMemoryPropertyFlags properties,
+                  bool linear,
+                  VulkanMemoryAllocation *pAllocation,
+                  VkMemoryAllocateFlags allocateFlags = 0U);
+    // Return the range to its block, merging it with free buddies
+    void Free(VulkanMemoryAllocation *pAllocation);
+
+    // Live VkDeviceMemory objects, blocks and dedicated allocations
+    inline uint32_t GetDeviceMemoryCount() const { return m_DeviceMemoryCount; }
+    // Live allocations handed out
+    inline uint32_t GetAllocationCount() const { return m_AllocationCount; }
+    // Reserved bytes of live allocations
+    inline VkDeviceSize GetAllocatedSize() const { return m_AllocatedSize; }
+    // Bytes of live VkDeviceMemory objects in the heap
+    VkDeviceSize GetHeapUsage(uint32_t heapIndex);
+    inline const VkPhysicalDeviceMemoryProperties &GetMemoryProperties() const { return m_MemoryProperties; }
+};
+
+#endif
@@ -0,0 +1,373 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanMipmapGenerator.h"
+#include "VulkanTools.h"
+#include "VulkanInitializer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <vector>
+
+// Storage views are UNORM, sRGB images are written through them with the mutable format flag
+static VkFormat GetStorageFormat(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    default:
+        return VK_FORMAT_UNDEFINED;
+    }
+}
+
+VulkanMipmapGenerator::VulkanMipmapGenerator(VulkanDevice *pDevice, const std::string &compFilePath, const VkAllocationCallbacks *pAllocator)
+{
+    if (pDevice == nullptr || pDevice->GetDevice() == VK_NULL_HANDLE)
+    {
+        FATAL("Mipmap generator must be created with a valid device!");
+    }
+    p_Device = pDevice;
+    p_Allocator = pAllocator;
+
+    // Uploads record mip generation on the graphics queue, which usually supports compute as well
+    const QueueFamilyIndices *pIndices = p_Device->GetDeviceQueueFamilyIndices();
+    if (!pIndices->GraphicsHasValue)
+    {
+        WARNING("No graphics queue for mipmap generation, fall back to blitting!\n");
+        return;
+    }
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(p_Device->GetGPU(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> familyProperties(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(p_Device->GetGPU(), &familyCount, familyProperties.data());
+    if (!(familyProperties[pIndices->Graphics].queueFlags & VK_QUEUE_COMPUTE_BIT))
+    {
+        WARNING("The graphics queue does not support compute, fall back to blitting!\n");
+        return;
+    }
+    VkFormatProperties formatProperties{};
+    vkGetPhysicalDeviceFormatProperties(p_Device->GetGPU(), VK_FORMAT_R8G8B8A8_UNORM, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
+    {
+        WARNING("R8G8B8A8 storage images are not supported, fall back to blitting!\n");
+        return;
+    }
+    // sRGB images need VK_IMAGE_CREATE_EXTENDED_USAGE_BIT for the storage usage their own format lacks
+    m_SRGBSupported = API_VERSION > VK_API_VERSION_1_0 && p_Device->m_GPUProperties.apiVersion > VK_API_VERSION_1_0;
+
+    size_t bufferSize = 0;
+    std::vector<char> buffer = {};
+    std::ifstream ifs{};
+    ifs.open(compFilePath, std::ios::ate | std::ios::binary);
+    if (!ifs.is_open())
+    {
+        FATAL("Faild to open file: %s", compFilePath.c_str());
+    }
+    bufferSize = static_cast<size_t>(ifs.tellg());
+    buffer.resize(bufferSize);
+    ifs.seekg(0);
+    ifs.read(buffer.data(), bufferSize);
+    ifs.close();
+    VkShaderModule compShader = VK_NULL_HANDLE;
+    VkShaderModuleCreateInfo compCI = vkinfo::ShaderModuleInfo(buffer.size(), buffer.data());
+    CHECK_VK_RESULT(vkCreateShaderModule(p_Device->GetDevice(), &compCI, p_Allocator, &compShader));
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {
+        vkinfo::SetLayoutBinding(0, MAX_PASS_LEVEL_COUNT, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),
+        vkinfo::SetLayoutBinding(1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)};
+    VkDescriptorSetLayoutCreateInfo setLayoutCI = vkinfo::SetLayoutInfo();
+    setLayoutCI.bindingCount = static_cast<uint32_t>(bindings.size());
+    setLayoutCI.pBindings = bindings.data();
+    CHECK_VK_RESULT(vkCreateDescriptorSetLayout(p_Device->GetDevice(), &setLayoutCI, p_Allocator, &m_SetLayout));
+
+    VkPushConstantRange pushConstant = vkinfo::PushConstant(0, sizeof(PushConstant), VK_SHADER_STAGE_COMPUTE_BIT);
+    VkPipelineLayoutCreateInfo pipelineLayoutCI = vkinfo::PipelineLayoutInfo(1, &pushConstant, 1, &m_SetLayout);
+    CHECK_VK_RESULT(vkCreatePipelineLayout(p_Device->GetDevice(), &pipelineLayoutCI, p_Allocator, &m_PipelineLayout));
+
+    VkPipelineShaderStageCreateInfo compShaderStage = vkinfo::ShaderStageInfo();
+    compShaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    compShaderStage.module = compShader;
+    compShaderStage.pName = "main";
+    VkComputePipelineCreateInfo computeCI = vkinfo::ComputePipelineInfo();
+    computeCI.stage = compShaderStage;
+    computeCI.layout = m_PipelineLayout;
+    CHECK_VK_RESULT(vkCreateComputePipelines(p_Device->GetDevice(), VK_NULL_HANDLE, 1, &computeCI, p_Allocator, &m_Pipeline));
+    vkDestroyShaderModule(p_Device->GetDevice(), compShader, p_Allocator);
+
+    // One counter per layer, cleared before every generation
+    m_CounterBuffer.Allocator = p_Allocator;
+    p_Device->CreateBuffer(static_cast<VkDeviceSize>(p_Device->m_GPUProperties.limits.maxImageArrayLayers) * sizeof(uint32_t),
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                           &m_CounterBuffer);
+    m_Supported = true;
+}
+
+VulkanMipmapGenerator::~VulkanMipmapGenerator()
+{
+    m_CounterBuffer.Destroy();
+    if (m_Pipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(p_Device->GetDevice(), m_Pipeline, p_Allocator);
+    }
+    if (m_PipelineLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyPipelineLayout(p_Device->GetDevice(), m_PipelineLayout, p_Allocator);
+    }
+    if (m_SetLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorSetLayout(p_Device->GetDevice(), m_SetLayout, p_Allocator);
+    }
+}
+
+bool VulkanMipmapGenerator::IsFormatSupported(VkFormat format) const
+{
+    if (!m_Supported || GetStorageFormat(format) == VK_FORMAT_UNDEFINED)
+    {
+        return false;
+    }
+    return format == GetStorageFormat(format) || m_SRGBSupported;
+}
+
+void VulkanMipmapGenerator::PrepareImageInfo(VkImageCreateInfo *pImageCI) const
+{
+    if (pImageCI == nullptr || !IsFormatSupported(pImageCI->format))
+    {
+        return;
+    }
+    pImageCI->usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    if (pImageCI->format != GetStorageFormat(pImageCI->format))
+    {
+        pImageCI->flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+    }
+}
+
+void VulkanMipmapGenerator::Generate(VulkanUploadBatch &batch, VulkanTexture *pTexture)
+{
+    if (pTexture == nullptr || pTexture->Image == VK_NULL_HANDLE)
+    {
+        FATAL("The texture to generate mipmaps for is not initialized!");
+    }
+    if (!IsFormatSupported(pTexture->Format))
+    {
+        FATAL("Compute mipmap generation does not support the texture format %d!", pTexture->Format);
+    }
+    if (pTexture->ArrayLayerCount > p_Device->m_GPUProperties.limits.maxImageArrayLayers)
+    {
+        FATAL("Texture layer count %u exceeds the device limit!", pTexture->ArrayLayerCount);
+    }
+
+    VkDevice device = p_Device->GetDevice();
+    const uint32_t levelCount = pTexture->MipMapLevelCount;
+    const uint32_t layerCount = pTexture->ArrayLayerCount;
+
+    // Level 0 is read by the shader in general layout
+    VkImageSubresourceRange subresource{};
+    subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresource.baseMipLevel = 0;
+    subresource.levelCount = 1;
+    subresource.baseArrayLayer = 0;
+    subresource.layerCount = layerCount;
+    batch.ReleaseImage(pTexture->Image,
+                       subresource,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_IMAGE_LAYOUT_GENERAL,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT);
+    if (levelCount < 2)
+    {
+        // Nothing to generate, still leave the texture ready for sampling
+        VkImageMemoryBarrier barrier = vkinfo::ImageMemoryBarrier();
+        barrier.image = pTexture->Image;
+        barrier.subresourceRange = subresource;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(batch.GetGraphicsCommandBuffer(),
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+        pTexture->Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        return;
+    }
+    VkCommandBuffer cmdBuffer = batch.GetGraphicsCommandBuffer();
+
+    // Plan the passes first, a pass covers 13 levels if its source fits in 64x64 work groups, otherwise 7 levels
+    struct Pass
+    {
+        uint32_t BaseLevel = 0U;
+        uint32_t LevelCount = 0U;
+        uint32_t GroupCountX = 0U;
+        uint32_t GroupCountY = 0U;
+    };
+    std::vector<Pass> passes = {};
+    for (uint32_t baseLevel = 0; baseLevel + 1 < levelCount;)
+    {
+        Pass pass{};
+        pass.BaseLevel = baseLevel;
+        pass.GroupCountX = ((std::max)(pTexture->Width >> baseLevel, 1U) + 63) / 64;
+        pass.GroupCountY = ((std::max)(pTexture->Height >> baseLevel, 1U) + 63) / 64;
+        uint32_t maxLevelCount = pass.GroupCountX <= 64 && pass.GroupCountY <= 64 ? MAX_PASS_LEVEL_COUNT : 7U;
+        pass.LevelCount = (std::min)(levelCount - baseLevel, maxLevelCount);
+        passes.push_back(pass);
+        baseLevel += pass.LevelCount - 1;
+    }
+
+    // Transient descriptors and views are destroyed once the batch is finished
+    std::array<VkDescriptorPoolSize, 2> poolSizes = {
+        vkinfo::PoolSize(static_cast<uint32_t>(passes.size()) * MAX_PASS_LEVEL_COUNT, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE),
+        vkinfo::PoolSize(static_cast<uint32_t>(passes.size()), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)};
+    VkDescriptorPoolCreateInfo poolCI = vkinfo::DescripotrPoolInfo(static_cast<uint32_t>(passes.size()));
+    poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCI.pPoolSizes = poolSizes.data();
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    CHECK_VK_RESULT(vkCreateDescriptorPool(device, &poolCI, p_Allocator, &pool));
+
+    std::vector<VkImageView> views(levelCount, VK_NULL_HANDLE);
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        VkImageViewCreateInfo viewCI = vkinfo::ImageViewInfo();
+        viewCI.image = pTexture->Image;
+        viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        viewCI.format = GetStorageFormat(pTexture->Format);
+        viewCI.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewCI.subresourceRange.baseMipLevel = i;
+        viewCI.subresourceRange.levelCount = 1;
+        viewCI.subresourceRange.baseArrayLayer = 0;
+        viewCI.subresourceRange.layerCount = layerCount;
+        CHECK_VK_RESULT(vkCreateImageView(device, &viewCI, p_Allocator, &views[i]));
+    }
+    const VkAllocationCallbacks *pAllocator = p_Allocator;
+    batch.DestroyWhenComplete(
+        [device, pool, views, pAllocator](void) -> void
+        {
+            for (size_t i = 0; i < views.size(); ++i)
+            {
+                vkDestroyImageView(device, views[i], pAllocator);
+            }
+            vkDestroyDescriptorPool(device, pool, pAllocator);
+        });
+
+    // Clear the counters after earlier generations are done with them, and move the levels to write into general layout
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmdBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         1, &memoryBarrier,
+                         0, nullptr,
+                         0, nullptr);
+    vkCmdFillBuffer(cmdBuffer, m_CounterBuffer.Buffer, 0, static_cast<VkDeviceSize>(layerCount) * sizeof(uint32_t), 0U);
+    memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    VkImageMemoryBarrier barrier = vkinfo::ImageMemoryBarrier();
+    barrier.image = pTexture->Image;
+    barrier.subresourceRange = subresource;
+    barrier.subresourceRange.baseMipLevel = 1;
+    barrier.subresourceRange.levelCount = levelCount - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcAccessMask = VK_ACCESS_NONE;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmdBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         1, &memoryBarrier,
+                         0, nullptr,
+                         1, &barrier);
+
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        const Pass &pass = passes[i];
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        VkDescriptorSetAllocateInfo allocInfo = vkinfo::DescriptorSetAllocateInfo(pool, &m_SetLayout, 1);
+        CHECK_VK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &set));
+
+        // Unused slots repeat the last level of the pass, the shader never touches them
+        std::array<VkDescriptorImageInfo, MAX_PASS_LEVEL_COUNT> imageInfos{};
+        for (uint32_t j = 0; j < MAX_PASS_LEVEL_COUNT; ++j)
+        {
+            imageInfos[j].imageView = views[pass.BaseLevel + (std::min)(j, pass.LevelCount - 1)];
+            imageInfos[j].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = m_CounterBuffer.Buffer;
+        bufferInfo.offset = 0;
+        bufferInfo.range = VK_WHOLE_SIZE;
+        std::array<VkWriteDescriptorSet, 2> writes = {
+            vkinfo::DescriptorWriteInfo(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, set, 0, 0, MAX_PASS_LEVEL_COUNT),
+            vkinfo::DescriptorWriteInfo(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, set, 1, 0, 1)};
+        writes[0].pImageInfo = imageInfos.data();
+        writes[1].pBufferInfo = &bufferInfo;
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+        if (i > 0)
+        {
+            // The next pass reads the last level written by the previous one
+            memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(cmdBuffer,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0,
+                                 1, &memoryBarrier,
+                                 0, nullptr,
+                                 0, nullptr);
+        }
+
+        PushConstant pushConstant{};
+        pushConstant.MipCount = pass.LevelCount;
+        pushConstant.SRGB = pTexture->Format != GetStorageFormat(pTexture->Format) ? 1U : 0U;
+        pushConstant.WorkGroupCount = pass.GroupCountX * pass.GroupCountY;
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &set, 0, nullptr);
+        vkCmdPushConstants(cmdBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstant), &pushConstant);
+        vkCmdDispatch(cmdBuffer, pass.GroupCountX, pass.GroupCountY, layerCount);
+        ++m_DispatchCount;
+    }
+
+    // All levels are sampled from now on
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmdBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &barrier);
+    pTexture->Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    ++m_GenerateCount;
+}
@@ -0,0 +1,95 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_MIPMAP_GENERATOR_HEADER
+#define VULKAN_MIPMAP_GENERATOR_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanTexture.h"
+#include "VulkanUploadBatch.h"
+
+#include <string>
+
+/**
+ * @brief Generates all mipmap levels of a texture with one compute dispatch, no linear blit support is needed.
+ * Each work group reduces a 64x64 tile to 6 levels through shared memory, the last work group of each layer
+ * reduces the 64x64 level left behind to the 1x1 level, so textures up to 4096x4096 take a single dispatch.
+ * @note Only R8G8B8A8 UNORM and sRGB textures are supported, sRGB textures are filtered in linear space.
+ * Create the textures with PrepareImageInfo() so that the levels can be written through storage views.
+ */
+class DVAPI_ATTR VulkanMipmapGenerator final
+{
+public:
+    // Level count one dispatch can write, including the source level
+    static constexpr uint32_t MAX_PASS_LEVEL_COUNT = 13U;
+
+private:
+    struct PushConstant
+    {
+        uint32_t MipCount = 0U;
+        uint32_t SRGB = 0U;
+        uint32_t WorkGroupCount = 0U;
+    };
+
+    VulkanDevice *p_Device = nullptr;
+    const VkAllocationCallbacks *p_Allocator = nullptr;
+    // The upload graphics queue family supports compute and at least one format is usable
+    bool m_Supported = false;
+    bool m_SRGBSupported = false;
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_Pipeline = VK_NULL_HANDLE;
+    // Work group counters of each layer, the shader resets them after use
+    VulkanBuffer m_CounterBuffer{};
+    uint32_t m_GenerateCount = 0U;
+    uint32_t m_DispatchCount = 0U;
+
+public:
+    explicit VulkanMipmapGenerator(VulkanDevice *pDevice,
+                                   const std::string &compFilePath = HOME_DIR "bin/VulkanMipmap/VulkanMipmap.comp.spv",
+                                   const VkAllocationCallbacks *pAllocator = nullptr);
+    ~VulkanMipmapGenerator();
+    VulkanMipmapGenerator(const VulkanMipmapGenerator &) = delete;
+    VulkanMipmapGenerator &operator=(const VulkanMipmapGenerator &) = delete;
+    VulkanMipmapGenerator(VulkanMipmapGenerator &&) = delete;
+    VulkanMipmapGenerator &operator=(VulkanMipmapGenerator &&) = delete;
+
+    // Whether textures of the format can be generated here
+    bool IsFormatSupported(VkFormat format) const;
+    // Add the usage and flags needed by Generate() to a texture image, do nothing if the format is not supported
+    void PrepareImageInfo(VkImageCreateInfo *pImageCI) const;
+    /**
+     * @brief Record mipmap generation to the graphics command buffer of the batch.
+     * @note Level 0 must be written on the transfer command buffer and be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+     * it is handed over here. All levels end up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+     */
+    void Generate(VulkanUploadBatch &batch, VulkanTexture *pTexture);
+
+    // Textures generated so far
+    inline uint32_t GetGenerateCount() const { return m_GenerateCount; }
+    // Dispatches recorded so far, one per texture up to 4096x4096
+    inline uint32_t GetDispatchCount() const { return m_DispatchCount; }
+};
+
+#endif
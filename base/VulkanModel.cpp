@@ -25,11 +25,18 @@
 #include "VulkanInitializer.hpp"
 
 #include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 std::unordered_set<uint32_t> VulkanModel::s_UniqueBinding = {};
 std::unordered_set<uint32_t> VulkanModel::s_UniqueLocation = {};
 std::vector<VkVertexInputBindingDescription> VulkanModel::s_BindingDescriptions = {};
 std::vector<VkVertexInputAttributeDescription> VulkanModel::s_AttributeDescriptions = {};
+std::vector<VkVertexInputBindingDescription> VulkanModel::s_InstanceBindingDescriptions = {};
+std::vector<VkVertexInputAttributeDescription> VulkanModel::s_InstanceAttributeDescriptions = {};
+std::vector<VkVertexInputBindingDescription> VulkanModel::s_PositionBindingDescriptions = {{0, sizeof(opm::vec3), VK_VERTEX_INPUT_RATE_VERTEX}};
+std::vector<VkVertexInputAttributeDescription> VulkanModel::s_PositionAttributeDescriptions = {{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0}};
 
 // hash combine
 template <typename T, typename... Rest>
@@ -55,7 +62,7 @@ namespace std
 }
 
 VulkanModel::VulkanModel(const std::string &modelPath, ModelTypeFlags modelType, uint32_t binding, VkVertexInputRate inputRate, VkDevice device, const VkAllocationCallbacks *pAllocator)
-    : p_Allocator{pAllocator}, m_VertexBuffer{pAllocator}, m_IndexBuffer{pAllocator}
+    : p_Allocator{pAllocator}, m_VertexBuffer{pAllocator}, m_PositionBuffer{pAllocator}, m_IndexBuffer{pAllocator}
 {
     if (device == VK_NULL_HANDLE)
     {
@@ -74,67 +81,16 @@ VulkanModel::VulkanModel(const std::string &modelPath, ModelTypeFlags modelType,
 
     case MODEL_TYPE_OBJ:
     {
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
-
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, modelPath.c_str()))
-        {
-            FATAL("Loading model failed!\n\twarning: %s\n\terror: %s", warn.c_str(), err.c_str());
-        }
-
-        m_Vertices.clear();
-        m_Indices.clear();
-
-        std::unordered_map<VulkanVertex, IndexType> uniqueVertices{};
-
-        for (const auto &shape : shapes)
+        std::string error;
+        if (!VulkanModel::ParseObj(modelPath, m_Vertices, m_Indices, error))
         {
-            for (const auto &index : shape.mesh.indices)
-            {
-                VulkanVertex vertex{};
-
-                if (index.vertex_index >= 0)
-                {
-                    vertex.Position = {
-                        attrib.vertices[3 * index.vertex_index + 0],
-                        attrib.vertices[3 * index.vertex_index + 1],
-                        attrib.vertices[3 * index.vertex_index + 2]};
-
-                    vertex.Color = {
-                        attrib.colors[3 * index.vertex_index + 0],
-                        attrib.colors[3 * index.vertex_index + 1],
-                        attrib.colors[3 * index.vertex_index + 2]};
-                }
-
-                if (index.normal_index >= 0)
-                {
-                    vertex.Normal = {
-                        attrib.normals[3 * index.normal_index + 0],
-                        attrib.normals[3 * index.normal_index + 1],
-                        attrib.normals[3 * index.normal_index + 2]};
-                }
-
-                if (index.texcoord_index >= 0)
-                {
-                    vertex.UV = {
-                        attrib.texcoords[2 * index.texcoord_index + 0],
-                        attrib.texcoords[2 * index.texcoord_index + 1]};
-                }
-
-                if (uniqueVertices.count(vertex) == 0)
-                {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(m_Vertices.size());
-                    m_Vertices.push_back(vertex);
-                }
-                m_Indices.push_back(uniqueVertices[vertex]);
-            }
+            FATAL("%s", error.c_str());
         }
         m_IndexCount = m_Indices.size();
         m_VertexCount = m_Vertices.size();
         m_HasIndexBuffer = m_IndexCount > 0;
         m_Type = MODEL_TYPE_OBJ;
+        ComputeBounds();
     }
     break;
 
@@ -162,7 +118,7 @@ VulkanModel::VulkanModel(const std::string &modelPath, ModelTypeFlags modelType,
 }
 
 VulkanModel::VulkanModel(const std::vector<VulkanVertex> vertex, uint32_t binding, VkVertexInputRate inputRate, VkDevice device, const VkAllocationCallbacks *pAllocator, const std::vector<IndexType> index)
-    : p_Allocator{pAllocator}, m_VertexBuffer{pAllocator}, m_IndexBuffer{pAllocator}
+    : p_Allocator{pAllocator}, m_VertexBuffer{pAllocator}, m_PositionBuffer{pAllocator}, m_IndexBuffer{pAllocator}
 {
     if (device == VK_NULL_HANDLE)
     {
@@ -177,6 +133,7 @@ VulkanModel::VulkanModel(const std::vector<VulkanVertex> vertex, uint32_t bindin
     m_IndexCount = index.size();
     m_HasIndexBuffer = m_IndexCount > 0;
     m_Type = MODEL_TYPE_NONE;
+    ComputeBounds();
 
     INFO("vertex count: %d, index count: %d\n", m_VertexCount, m_IndexCount);
 
@@ -193,6 +150,104 @@ VulkanModel::~VulkanModel()
     DestroyTextures();
 }
 
+bool VulkanModel::ParseObj(const std::string &modelPath, std::vector<VulkanVertex> &vertices, std::vector<IndexType> &indices, std::string &error)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, modelPath.c_str()))
+    {
+        error = "Loading model failed!\n\twarning: " + warn + "\n\terror: " + err;
+        return false;
+    }
+
+    vertices.clear();
+    indices.clear();
+
+    std::unordered_map<VulkanVertex, IndexType> uniqueVertices{};
+
+    for (const auto &shape : shapes)
+    {
+        for (const auto &index : shape.mesh.indices)
+        {
+            VulkanVertex vertex{};
+
+            if (index.vertex_index >= 0)
+            {
+                vertex.Position = {
+                    attrib.vertices[3 * index.vertex_index + 0],
+                    attrib.vertices[3 * index.vertex_index + 1],
+                    attrib.vertices[3 * index.vertex_index + 2]};
+
+                vertex.Color = {
+                    attrib.colors[3 * index.vertex_index + 0],
+                    attrib.colors[3 * index.vertex_index + 1],
+                    attrib.colors[3 * index.vertex_index + 2]};
+            }
+
+            if (index.normal_index >= 0)
+            {
+                vertex.Normal = {
+                    attrib.normals[3 * index.normal_index + 0],
+                    attrib.normals[3 * index.normal_index + 1],
+                    attrib.normals[3 * index.normal_index + 2]};
+            }
+
+            if (index.texcoord_index >= 0)
+            {
+                vertex.UV = {
+                    attrib.texcoords[2 * index.texcoord_index + 0],
+                    attrib.texcoords[2 * index.texcoord_index + 1]};
+            }
+
+            if (uniqueVertices.count(vertex) == 0)
+            {
+                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(vertex);
+            }
+            indices.push_back(uniqueVertices[vertex]);
+        }
+    }
+
+    return true;
+}
+
+void VulkanModel::ComputeBounds()
+{
+    if (m_Vertices.empty())
+    {
+        return;
+    }
+
+    m_BoundsMin = m_Vertices[0].Position;
+    m_BoundsMax = m_Vertices[0].Position;
+    for (const auto &vertex : m_Vertices)
+    {
+        m_BoundsMin.x = std::min(m_BoundsMin.x, vertex.Position.x);
+        m_BoundsMin.y = std::min(m_BoundsMin.y, vertex.Position.y);
+        m_BoundsMin.z = std::min(m_BoundsMin.z, vertex.Position.z);
+        m_BoundsMax.x = std::max(m_BoundsMax.x, vertex.Position.x);
+        m_BoundsMax.y = std::max(m_BoundsMax.y, vertex.Position.y);
+        m_BoundsMax.z = std::max(m_BoundsMax.z, vertex.Position.z);
+    }
+
+    // Tighter than half of the box diagonal
+    opm::T centerX = (m_BoundsMin.x + m_BoundsMax.x) * 0.5;
+    opm::T centerY = (m_BoundsMin.y + m_BoundsMax.y) * 0.5;
+    opm::T centerZ = (m_BoundsMin.z + m_BoundsMax.z) * 0.5;
+    opm::T radiusSquared = 0.0;
+    for (const auto &vertex : m_Vertices)
+    {
+        opm::T dx = vertex.Position.x - centerX;
+        opm::T dy = vertex.Position.y - centerY;
+        opm::T dz = vertex.Position.z - centerZ;
+        radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+    m_BoundsRadius = std::sqrt(radiusSquared);
+}
+
 void VulkanModel::AddVertexInputBinding(uint32_t binding, uint32_t stride, VkVertexInputRate inputRate)
 {
     if (VulkanModel::s_UniqueBinding.count(binding) == 0)
@@ -221,6 +276,33 @@ const std::vector<VkVertexInputAttributeDescription> &VulkanModel::GetAttributeD
     return VulkanModel::s_AttributeDescriptions;
 }
 
+const std::vector<VkVertexInputBindingDescription> &VulkanModel::GetPositionBindingDescription()
+{
+    return VulkanModel::s_PositionBindingDescriptions;
+}
+
+const std::vector<VkVertexInputAttributeDescription> &VulkanModel::GetPositionAttributeDescription()
+{
+    return VulkanModel::s_PositionAttributeDescriptions;
+}
+
+const std::vector<VkVertexInputBindingDescription> &VulkanModel::GetInstanceBindingDescription(uint32_t binding)
+{
+    VulkanModel::s_InstanceBindingDescriptions = VulkanModel::s_BindingDescriptions;
+    VulkanModel::s_InstanceBindingDescriptions.push_back({binding, sizeof(opm::mat4), VK_VERTEX_INPUT_RATE_INSTANCE});
+    return VulkanModel::s_InstanceBindingDescriptions;
+}
+
+const std::vector<VkVertexInputAttributeDescription> &VulkanModel::GetInstanceAttributeDescription(uint32_t binding)
+{
+    VulkanModel::s_InstanceAttributeDescriptions = VulkanModel::s_AttributeDescriptions;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        VulkanModel::s_InstanceAttributeDescriptions.push_back({INSTANCE_LOCATION + i, binding, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(i * sizeof(opm::mat4) / 4)});
+    }
+    return VulkanModel::s_InstanceAttributeDescriptions;
+}
+
 void VulkanModel::Transform(const opm::vec3 &scale, const opm::vec3 &rotation, const opm::vec3 &translation)
 {
     m_UniqueModelMat = opm::Transform(m_UniqueModelMat, scale, rotation, translation);
@@ -251,6 +333,20 @@ void VulkanModel::Bind(VkCommandBuffer cmdBuffer)
     }
 }
 
+void VulkanModel::BindPositions(VkCommandBuffer cmdBuffer)
+{
+    if (m_PositionBuffer.Buffer == VK_NULL_HANDLE)
+    {
+        FATAL("Model has no position stream, enable VulkanRenderer::Settings::PositionStream before loading it!");
+    }
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &m_PositionBuffer.Buffer, &offset);
+    if (m_HasIndexBuffer)
+    {
+        vkCmdBindIndexBuffer(cmdBuffer, m_IndexBuffer.Buffer, 0, INDEX_TYPE_FLAG);
+    }
+}
+
 void VulkanModel::Draw(VkCommandBuffer cmdBuffer)
 {
     if (m_HasIndexBuffer)
@@ -263,8 +359,99 @@ void VulkanModel::Draw(VkCommandBuffer cmdBuffer)
     }
 }
 
+void VulkanModel::CopyPositionData(opm::vec3 *pPositions) const
+{
+    for (size_t i = 0; i < m_Vertices.size(); ++i)
+    {
+        pPositions[i] = m_Vertices[i].Position;
+    }
+}
+
+void VulkanModel::ReserveInstances(uint32_t binding, uint32_t maxInstanceCount, uint32_t maxFramesInFlight)
+{
+    m_InstanceBinding = binding;
+    m_MaxInstanceCount = maxInstanceCount;
+    m_Instances.reserve(maxInstanceCount);
+    m_InstanceDirty.assign(maxFramesInFlight, true);
+}
+
+uint32_t VulkanModel::AddInstance(const opm::mat4 &modelMat)
+{
+    if (m_Instances.size() >= m_MaxInstanceCount)
+    {
+        FATAL("Instance count exceeds the maximum %u!", m_MaxInstanceCount);
+    }
+    m_Instances.push_back(modelMat.Transpose());
+    m_InstanceDirty.assign(m_InstanceDirty.size(), true);
+    return static_cast<uint32_t>(m_Instances.size() - 1);
+}
+
+void VulkanModel::SetInstance(uint32_t instanceIndex, const opm::mat4 &modelMat)
+{
+    if (instanceIndex >= m_Instances.size())
+    {
+        FATAL("Invalid instance index %u!", instanceIndex);
+    }
+    m_Instances[instanceIndex] = modelMat.Transpose();
+    m_InstanceDirty.assign(m_InstanceDirty.size(), true);
+}
+
+void VulkanModel::ClearInstances()
+{
+    m_Instances.clear();
+    m_InstanceDirty.assign(m_InstanceDirty.size(), true);
+}
+
+void VulkanModel::UpdateInstanceBuffer(uint32_t currentFrame)
+{
+    if (!m_InstanceDirty[currentFrame])
+    {
+        return;
+    }
+    if (!m_Instances.empty())
+    {
+        memcpy(m_InstanceBuffers[currentFrame].Mapped, m_Instances.data(), m_Instances.size() * sizeof(opm::mat4));
+    }
+    m_InstanceDirty[currentFrame] = false;
+}
+
+void VulkanModel::BindInstances(VkCommandBuffer cmdBuffer, uint32_t currentFrame)
+{
+    if (m_VertexBuffer.Buffer == VK_NULL_HANDLE)
+    {
+        FATAL("Instanced models must own their vertex buffer, load them before creating the geometry arena!");
+    }
+    Bind(cmdBuffer);
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmdBuffer, m_InstanceBinding, 1, &m_InstanceBuffers[currentFrame].Buffer, &offset);
+}
+
+void VulkanModel::DrawInstances(VkCommandBuffer cmdBuffer)
+{
+    uint32_t instanceCount = static_cast<uint32_t>(m_Instances.size());
+    if (instanceCount == 0)
+    {
+        return;
+    }
+    if (m_HasIndexBuffer)
+    {
+        vkCmdDrawIndexed(cmdBuffer, m_IndexCount, instanceCount, 0, 0, 0);
+    }
+    else
+    {
+        vkCmdDraw(cmdBuffer, m_VertexCount, instanceCount, 0, 0);
+    }
+}
+
 void VulkanModel::FreeBufferMemory()
 {
+    for (size_t i = 0; i < m_InstanceBuffers.size(); ++i)
+    {
+        if (m_InstanceBuffers[i].Device != VK_NULL_HANDLE)
+        {
+            m_InstanceBuffers[i].Destroy();
+        }
+    }
     for (size_t i = 0; i < m_TransformBuffers.size(); ++i)
     {
         if (m_TransformBuffers[i].Device != VK_NULL_HANDLE)
@@ -273,6 +460,7 @@ void VulkanModel::FreeBufferMemory()
         }
     }
     m_IndexBuffer.Destroy();
+    m_PositionBuffer.Destroy();
     m_VertexBuffer.Destroy();
 }
 
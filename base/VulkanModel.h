@@ -61,29 +61,60 @@ private:
     opm::vec3 m_Rotation{0.0};
     opm::vec3 m_Scale{1.0};
     opm::vec3 m_Translation{0.0};
+    // Local axis aligned bounding box and bounding sphere, computed at load time
+    opm::vec3 m_BoundsMin{0.0};
+    opm::vec3 m_BoundsMax{0.0};
+    opm::T m_BoundsRadius = 0.0;
+    // Instance transforms, stored transposed so they are copied to the instance buffers as is
+    std::vector<opm::mat4> m_Instances = {};
+    // Whether the instance buffer of each frame is out of date
+    std::vector<bool> m_InstanceDirty = {};
+    uint32_t m_InstanceBinding = 1U;
+    uint32_t m_MaxInstanceCount = 0U;
 
     static std::unordered_set<uint32_t> s_UniqueBinding;
     static std::unordered_set<uint32_t> s_UniqueLocation;
     static std::vector<VkVertexInputBindingDescription> s_BindingDescriptions;
     static std::vector<VkVertexInputAttributeDescription> s_AttributeDescriptions;
+    static std::vector<VkVertexInputBindingDescription> s_InstanceBindingDescriptions;
+    static std::vector<VkVertexInputBindingDescription> s_PositionBindingDescriptions;
+    static std::vector<VkVertexInputAttributeDescription> s_PositionAttributeDescriptions;
+    static std::vector<VkVertexInputAttributeDescription> s_InstanceAttributeDescriptions;
 
     static void AddVertexInputBinding(uint32_t binding, uint32_t stride, VkVertexInputRate inputRate);
     static void AddVertexInputAttribute(uint32_t location, uint32_t binding, VkFormat format, uint32_t offset);
+    // The sphere is centered at the box center, so both volumes share one center
+    void ComputeBounds();
 
 public:
     VkDevice m_Device = VK_NULL_HANDLE;
     const VkAllocationCallbacks *p_Allocator = nullptr;
     opm::mat4 m_UniqueModelMat{1.0};
     VulkanBuffer m_VertexBuffer{};
+    // Position-only vertex stream for depth-only passes, created only if VulkanRenderer::Settings::PositionStream is enabled
+    VulkanBuffer m_PositionBuffer{};
     VulkanBuffer m_IndexBuffer{};
+    // Mesh index in the geometry arena, -1 if the model owns its vertex and index buffer
+    int32_t m_MeshIndex = -1;
+    // Frustum culling result of the current frame
+    bool m_Visible = true;
 
     std::vector<VulkanBuffer> m_TransformBuffers = {};
+    // Per-frame instance buffers read with VK_VERTEX_INPUT_RATE_INSTANCE, persistently mapped
+    std::vector<VulkanBuffer> m_InstanceBuffers = {};
+    // One texture shared by all frames if immutable, otherwise one per frame slot, m_TextureSets always has one set per frame slot
     std::vector<VulkanTexture> m_ColorTextures = {};
+    ResourceLifetimeFlags m_TextureLifetime = RESOURCE_LIFETIME_IMMUTABLE;
+    // Texture owned by the renderer's texture cache, sampled instead of m_ColorTextures if set, never destroyed by the model
+    VulkanTexture *p_CachedColorTexture = nullptr;
     VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
     std::vector<VkDescriptorSetLayout> m_DescriptorSetLayouts = {};
     std::vector<VkDescriptorSet> m_TransformSets = {};
     std::vector<VkDescriptorSet> m_TextureSets = {};
 
+    // First vertex attribute location of the instance transform, each matrix column takes one location
+    static constexpr uint32_t INSTANCE_LOCATION = 4U;
+
 public:
     explicit VulkanModel(const std::string &modelPath,
                          ModelTypeFlags modelType,
@@ -115,9 +146,46 @@ public:
 
     void Bind(VkCommandBuffer cmdBuffer);
     void Draw(VkCommandBuffer cmdBuffer);
+    // Bind the position-only stream and the index buffer, draw with Draw or DrawInstances
+    void BindPositions(VkCommandBuffer cmdBuffer);
+
+    /**
+     * @brief Set the instance binding and capacity, called by VulkanRenderer::CreateInstanceBuffers.
+     * @param binding The vertex input binding of the instance buffers, must differ from the vertex binding.
+     */
+    void ReserveInstances(uint32_t binding, uint32_t maxInstanceCount, uint32_t maxFramesInFlight);
+    /**
+     * @brief Add an instance drawn by DrawInstances.
+     * @param modelMat The model matrix of the instance, it is transposed when stored.
+     * @return The instance index.
+     */
+    uint32_t AddInstance(const opm::mat4 &modelMat);
+    // Replace the model matrix of an instance
+    void SetInstance(uint32_t instanceIndex, const opm::mat4 &modelMat);
+    void ClearInstances();
+    // Copy the instance transforms to the instance buffer of the frame, only if they changed since the last copy to it
+    void UpdateInstanceBuffer(uint32_t currentFrame);
+    // Bind the vertex and index buffer together with the instance buffer of the frame
+    void BindInstances(VkCommandBuffer cmdBuffer, uint32_t currentFrame);
+    // Draw all instances with one draw call
+    void DrawInstances(VkCommandBuffer cmdBuffer);
 
     static const std::vector<VkVertexInputBindingDescription> &GetBindingDescription();
     static const std::vector<VkVertexInputAttributeDescription> &GetAttributeDescription();
+    // Position-only binding 0 with a 12 bytes stride, for depth prepass, shadow and picking pipelines
+    static const std::vector<VkVertexInputBindingDescription> &GetPositionBindingDescription();
+    // Position at location 0
+    static const std::vector<VkVertexInputAttributeDescription> &GetPositionAttributeDescription();
+    // Vertex bindings plus the instance binding, for instanced pipelines only
+    static const std::vector<VkVertexInputBindingDescription> &GetInstanceBindingDescription(uint32_t binding);
+    // Vertex attributes plus the instance transform columns at INSTANCE_LOCATION, for instanced pipelines only
+    static const std::vector<VkVertexInputAttributeDescription> &GetInstanceAttributeDescription(uint32_t binding);
+    /**
+     * @brief Parse an OBJ file into deduplicated vertices and indices.
+     * @note This does not touch any Vulkan or static state, so it is safe to call from worker threads.
+     * @return False with the error message if parsing failed.
+     */
+    static bool ParseObj(const std::string &modelPath, std::vector<VulkanVertex> &vertices, std::vector<IndexType> &indices, std::string &error);
 
     inline const size_t GetVertexCount() const { return m_VertexCount; }
     inline size_t GetVertexCount() { return m_VertexCount; }
@@ -125,6 +193,18 @@ public:
     inline size_t GetIndexCount() { return m_IndexCount; }
     inline const VulkanVertex *GetVertexData() const { return m_Vertices.data(); }
     inline const IndexType *GetIndexData() const { return m_Indices.data(); }
+    inline uint32_t GetInstanceCount() const { return static_cast<uint32_t>(m_Instances.size()); }
+    inline uint32_t GetMaxInstanceCount() const { return m_MaxInstanceCount; }
+    inline const opm::vec3 &GetBoundsMin() const { return m_BoundsMin; }
+    inline const opm::vec3 &GetBoundsMax() const { return m_BoundsMax; }
+    inline opm::T GetBoundsRadius() const { return m_BoundsRadius; }
+    // Gather vertex positions into a tightly packed array with GetVertexCount elements
+    void CopyPositionData(opm::vec3 *pPositions) const;
+    // The color texture sampled by the frame slot
+    inline VulkanTexture &GetColorTexture(uint32_t currentFrame)
+    {
+        return p_CachedColorTexture != nullptr ? *p_CachedColorTexture : m_ColorTextures[m_ColorTextures.size() == 1 ? 0 : currentFrame];
+    }
     inline void ClearVertexData() { m_Vertices.clear(); }
     inline void ClearIndexData() { m_Indices.clear(); }
     void FreeBufferMemory();
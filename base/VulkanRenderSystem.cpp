@@ -205,6 +205,13 @@ void VulkanRenderSystem::WriteDescriptorSets(VkDescriptorType descriptorType, Vk
     }
     break;
 
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+    {
+        write.pBufferInfo = reinterpret_cast<VkDescriptorBufferInfo *>(pInfo);
+        m_Writes.push_back(write);
+    }
+    break;
+
     case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
     {
         write.pImageInfo = reinterpret_cast<VkDescriptorImageInfo *>(pInfo);
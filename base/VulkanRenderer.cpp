@@ -25,6 +25,109 @@
 
 #include <algorithm>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Channel count of the 8 bit formats picked by GetTextureFormat
+static uint32_t GetTextureChannelCount(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+        return 1U;
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_SRGB:
+        return 2U;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return 4U;
+    default:
+        return 0U;
+    }
+}
+
+// Single and dual channel color images are grey and grey-alpha, so shaders sampling RGBA see the same color as with R8G8B8A8
+static VkComponentMapping GetTextureSwizzle(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_SRGB:
+        return {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE};
+    case VK_FORMAT_R8G8_SRGB:
+        return {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G};
+    default:
+        return {VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY};
+    }
+}
+
+/**
+ * @brief Write rows [firstRow, firstRow + rowCount) of the half extent image, each texel is the rounded average of a 2x2 source block.
+ * @note Odd extents drop the last source row or column, a single row or column is averaged with itself. channelCount must be 1, 2 or 4.
+ */
+static void DownscaleRows(const unsigned char *pSrc,
+                          uint32_t srcWidth,
+                          uint32_t srcHeight,
+                          unsigned char *pDst,
+                          uint32_t dstWidth,
+                          uint32_t channelCount,
+                          uint32_t firstRow,
+                          uint32_t rowCount)
+{
+    const size_t srcPitch = static_cast<size_t>(srcWidth) * channelCount;
+    const size_t dstPitch = static_cast<size_t>(dstWidth) * channelCount;
+    for (uint32_t y = firstRow; y < firstRow + rowCount; ++y)
+    {
+        const unsigned char *pRow0 = pSrc + static_cast<size_t>((std::min)(y * 2U, srcHeight - 1U)) * srcPitch;
+        const unsigned char *pRow1 = pSrc + static_cast<size_t>((std::min)(y * 2U + 1U, srcHeight - 1U)) * srcPitch;
+        unsigned char *pOut = pDst + static_cast<size_t>(y) * dstPitch;
+        size_t x = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+        // 16 source bytes of both rows give 8 destination bytes for every channel count
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        const __m128i one = _mm_set1_epi16(1);
+        for (; x + 8U <= dstPitch; x += 8U)
+        {
+            __m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pRow0 + x * 2U));
+            __m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pRow1 + x * 2U));
+            // Vertical sums of bytes 0-7 and 8-15 as 16 bit lanes
+            __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(row0, zero), _mm_unpacklo_epi8(row1, zero));
+            __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(row0, zero), _mm_unpackhi_epi8(row1, zero));
+            // Horizontal sums of neighbouring texels, which are channelCount lanes apart
+            __m128i sum;
+            if (channelCount == 4U)
+            {
+                sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+            }
+            else if (channelCount == 2U)
+            {
+                low = _mm_shuffle_epi32(low, _MM_SHUFFLE(3, 1, 2, 0));
+                high = _mm_shuffle_epi32(high, _MM_SHUFFLE(3, 1, 2, 0));
+                sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+            }
+            else
+            {
+                sum = _mm_packs_epi32(_mm_madd_epi16(low, one), _mm_madd_epi16(high, one));
+            }
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(pOut + x), _mm_packus_epi16(sum, zero));
+        }
+#endif
+
+        for (; x < dstPitch; ++x)
+        {
+            const size_t texel = x / channelCount;
+            const size_t channel = x % channelCount;
+            const size_t x0 = texel * 2U * channelCount + channel;
+            const size_t x1 = (std::min)(texel * 2U + 1U, static_cast<size_t>(srcWidth) - 1U) * channelCount + channel;
+            pOut[x] = static_cast<unsigned char>((pRow0[x0] + pRow0[x1] + pRow1[x0] + pRow1[x1] + 2U) >> 2U);
+        }
+    }
+}
+
 VulkanRenderer::VulkanRenderer(CameraTypeFlags camType, const VkAllocationCallbacks *pAllocator)
 {
     p_Allocator = pAllocator;
@@ -57,6 +160,38 @@ VulkanRenderer::VulkanRenderer(CameraTypeFlags camType, const VkAllocationCallba
 
 VulkanRenderer::~VulkanRenderer()
 {
+    if (p_Device != nullptr && p_Device->GetDevice() != VK_NULL_HANDLE)
+    {
+        vkDeviceWaitIdle(p_Device->GetDevice());
+    }
+    for (uint32_t i = 0; i < m_DeletionQueues.size(); ++i)
+    {
+        FlushDeletionQueue(i);
+    }
+    for (auto &cached : m_CachedTextures)
+    {
+        if (cached.pTexture != nullptr)
+        {
+            cached.pTexture->Destroy();
+            delete cached.pTexture;
+        }
+    }
+    // Join workers before releasing the decoded images they produced
+    if (p_ThreadPool != nullptr)
+    {
+        delete p_ThreadPool;
+    }
+    for (size_t i = 0; i < m_TextureStreams.size(); ++i)
+    {
+        if (m_TextureStreams[i].Future.valid())
+        {
+            m_TextureStreams[i].Image = m_TextureStreams[i].Future.get();
+        }
+        if (m_TextureStreams[i].Image.pPixels != nullptr)
+        {
+            stbi_image_free(m_TextureStreams[i].Image.pPixels);
+        }
+    }
     for (size_t i = 0; i < m_Settings.MaxFramesInFlight; ++i)
     {
         vkDestroyFence(p_Device->GetDevice(), m_GraphicsInFlightFences[i], p_Allocator);
@@ -71,6 +206,22 @@ VulkanRenderer::~VulkanRenderer()
     {
         delete p_SkyBox;
     }
+    if (p_GeometryArena != nullptr)
+    {
+        delete p_GeometryArena;
+    }
+    if (p_UniformRing != nullptr)
+    {
+        delete p_UniformRing;
+    }
+    if (p_BindlessTextures != nullptr)
+    {
+        delete p_BindlessTextures;
+    }
+    if (p_MipmapGenerator != nullptr)
+    {
+        delete p_MipmapGenerator;
+    }
     if (p_Camera != nullptr)
     {
         delete p_Camera;
@@ -220,7 +371,7 @@ void VulkanRenderer::InitVulkan(uint32_t maxFramesInFilght)
     // Instance
     try
     {
-        p_Instance = new VulkanInstance(m_Settings.EnableValidationLayer, p_Allocator);
+        p_Instance = new VulkanInstance(m_Settings.EnableValidationLayer, VulkanHostAllocator::Rescope(p_Allocator, HOST_ALLOCATION_SCOPE_INSTANCE));
         // p_Instance->m_EnabledEextensions.push_back("...");
         p_Instance->CreateInstance();
         p_Instance->SetUpDebugMessenger();
@@ -253,7 +404,7 @@ void VulkanRenderer::InitVulkan(uint32_t maxFramesInFilght)
     // SwapChain
     try
     {
-        p_SwapChain = new VulkanSwapChain(p_Instance->GetInstance(), p_Allocator);
+        p_SwapChain = new VulkanSwapChain(p_Instance->GetInstance(), VulkanHostAllocator::Rescope(p_Allocator, HOST_ALLOCATION_SCOPE_SWAPCHAIN));
         p_SwapChain->CreateSurface(p_Window);
     }
     catch (const std::exception &e)
@@ -269,7 +420,7 @@ void VulkanRenderer::InitVulkan(uint32_t maxFramesInFilght)
     // Render system
     try
     {
-        p_RenderSystem = new VulkanRenderSystem(p_Allocator);
+        p_RenderSystem = new VulkanRenderSystem(VulkanHostAllocator::Rescope(p_Allocator, HOST_ALLOCATION_SCOPE_PIPELINE));
     }
     catch (const std::exception &e)
     {
@@ -303,10 +454,41 @@ void VulkanRenderer::InitVulkan(uint32_t maxFramesInFilght)
         FATAL(e.what());
     }
 
+    // Thread pool
+    try
+    {
+        p_ThreadPool = new VulkanThreadPool(static_cast<uint32_t>(std::thread::hardware_concurrency()));
+    }
+    catch (const std::exception &e)
+    {
+        if (p_ThreadPool != nullptr)
+        {
+            delete p_ThreadPool;
+            p_ThreadPool = nullptr;
+        }
+        FATAL(e.what());
+    }
+
+    // Compute mipmap generator, textures it can't handle fall back to blitting
+    try
+    {
+        p_MipmapGenerator = new VulkanMipmapGenerator(p_Device, HOME_DIR "bin/VulkanMipmap/VulkanMipmap.comp.spv", p_Allocator);
+    }
+    catch (const std::exception &e)
+    {
+        if (p_MipmapGenerator != nullptr)
+        {
+            delete p_MipmapGenerator;
+            p_MipmapGenerator = nullptr;
+        }
+        FATAL(e.what());
+    }
+
     uint32_t *p_MaxFrames = const_cast<uint32_t *>(&m_Settings.MaxFramesInFlight);
     *p_MaxFrames = maxFramesInFilght;
     p_Camera->m_CameraUniformBuffers.resize(maxFramesInFilght);
     p_Camera->m_CameraSets.resize(maxFramesInFilght);
+    m_DeletionQueues.resize(maxFramesInFilght);
     if (p_Camera->m_Type == CAMERA_TYPE_FIRST_PERSON)
     {
         glfwSetInputMode(p_Window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -535,337 +717,1279 @@ void VulkanRenderer::WindowResize()
     m_Prepared = true;
 }
 
-VulkanModel *VulkanRenderer::LoadModel(const std::string &modelPath, ModelTypeFlags modelType, uint32_t binding, VkVertexInputRate inputRate)
+VulkanModel *VulkanRenderer::LoadModel(const std::string &modelPath,
+                                       ModelTypeFlags modelType,
+                                       uint32_t binding,
+                                       VkVertexInputRate inputRate,
+                                       ResourceLifetimeFlags textureLifetime)
 {
     VulkanModel *pModel = new VulkanModel(modelPath, modelType, binding, inputRate, p_Device->GetDevice(), p_Allocator);
     for (uint32_t i = 0; i < m_Settings.MaxFramesInFlight; ++i)
     {
         pModel->m_TransformBuffers.push_back(std::move(VulkanBuffer(p_Allocator)));
+    }
+    // Sampled textures are never written by a frame, so one copy serves every frame slot
+    pModel->m_TextureLifetime = textureLifetime;
+    for (uint32_t i = 0; i < (textureLifetime == RESOURCE_LIFETIME_PER_FRAME ? m_Settings.MaxFramesInFlight : 1U); ++i)
+    {
         pModel->m_ColorTextures.push_back(std::move(VulkanTexture(p_Allocator)));
     }
     pModel->m_TransformSets.resize(m_Settings.MaxFramesInFlight);
     pModel->m_TextureSets.resize(m_Settings.MaxFramesInFlight);
-    CreateVertexBuffer(pModel);
-    CreateIndexBuffer(pModel);
+    if (p_GeometryArena != nullptr)
+    {
+        p_GeometryArena->AddMesh(pModel);
+    }
+    else
+    {
+        CreateVertexBuffer(pModel);
+        CreateIndexBuffer(pModel);
+    }
     return pModel;
 }
 
-VulkanModel *VulkanRenderer::LoadModel(const std::vector<VulkanVertex> vertex, uint32_t binding, VkVertexInputRate inputRate, const std::vector<IndexType> index)
+VulkanModel *VulkanRenderer::LoadModel(const std::vector<VulkanVertex> vertex,
+                                       uint32_t binding,
+                                       VkVertexInputRate inputRate,
+                                       const std::vector<IndexType> index,
+                                       ResourceLifetimeFlags textureLifetime)
 {
     VulkanModel *pModel = new VulkanModel(vertex, binding, inputRate, p_Device->GetDevice(), p_Allocator, index);
     for (uint32_t i = 0; i < m_Settings.MaxFramesInFlight; ++i)
     {
         pModel->m_TransformBuffers.push_back(std::move(VulkanBuffer(p_Allocator)));
+    }
+    pModel->m_TextureLifetime = textureLifetime;
+    for (uint32_t i = 0; i < (textureLifetime == RESOURCE_LIFETIME_PER_FRAME ? m_Settings.MaxFramesInFlight : 1U); ++i)
+    {
         pModel->m_ColorTextures.push_back(std::move(VulkanTexture(p_Allocator)));
     }
     pModel->m_TransformSets.resize(m_Settings.MaxFramesInFlight);
     pModel->m_TextureSets.resize(m_Settings.MaxFramesInFlight);
-    CreateVertexBuffer(pModel);
-    CreateIndexBuffer(pModel);
+    if (p_GeometryArena != nullptr)
+    {
+        p_GeometryArena->AddMesh(pModel);
+    }
+    else
+    {
+        CreateVertexBuffer(pModel);
+        CreateIndexBuffer(pModel);
+    }
     return pModel;
 }
 
-void VulkanRenderer::CreateVertexBuffer(VulkanModel *pModel)
+uint32_t VulkanRenderer::LoadModelAsync(const std::string &modelPath,
+                                        ModelTypeFlags modelType,
+                                        uint32_t binding,
+                                        VkVertexInputRate inputRate,
+                                        VulkanModel *pPlaceholder)
 {
+    ModelStream stream{};
+    stream.Binding = binding;
+    stream.InputRate = inputRate;
+    stream.pPlaceholder = pPlaceholder;
+    if (modelType == MODEL_TYPE_OBJ)
+    {
+        stream.Future = p_ThreadPool->Enqueue(
+            [modelPath](void) -> ModelData
+            {
+                ModelData data{};
+                if (!VulkanModel::ParseObj(modelPath, data.Vertices, data.Indices, data.Error))
+                {
+                    data.Vertices.clear();
+                    data.Indices.clear();
+                }
+                return data;
+            });
+    }
+    else
+    {
+        WARNING("Asynchronous loading only supports OBJ models, model at %s will keep its placeholder!\n", modelPath.c_str());
+        stream.State = STREAM_STATE_FAILED;
+    }
+    m_ModelStreams.push_back(std::move(stream));
 
-    VkDeviceSize vertexSize = sizeof(VulkanVertex) * (pModel->GetVertexCount());
-    VulkanBuffer vertexStaging{p_Allocator};
-    p_Device->CreateBuffer(vertexSize,
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                           &vertexStaging,
-
-                           pModel->GetVertexData());
-    pModel->ClearVertexData();
-    p_Device->CreateBuffer(vertexSize,
-                           VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                           &(pModel->m_VertexBuffer),
-                           p_Allocator);
-    p_Device->CopyBuffer(&vertexStaging, &(pModel->m_VertexBuffer));
-    vertexStaging.Destroy();
+    return static_cast<uint32_t>(m_ModelStreams.size() - 1);
 }
 
-void VulkanRenderer::CreateIndexBuffer(VulkanModel *pModel)
+VulkanModel *VulkanRenderer::GetStreamedModel(uint32_t handle)
 {
-    VkDeviceSize indexSize = sizeof(IndexType) * (pModel->GetIndexCount());
-    VulkanBuffer indexStaging{p_Allocator};
-    p_Device->CreateBuffer(indexSize,
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                           &indexStaging,
+    if (handle >= m_ModelStreams.size())
+    {
+        FATAL("Invalid model stream handle %u!", handle);
+    }
 
-                           (pModel->GetIndexData()));
-    pModel->ClearIndexData();
-    p_Device->CreateBuffer(indexSize,
-                           VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                           &(pModel->m_IndexBuffer),
-                           p_Allocator);
-    p_Device->CopyBuffer(&indexStaging, &(pModel->m_IndexBuffer));
-    indexStaging.Destroy();
+    if (m_ModelStreams[handle].State == STREAM_STATE_READY)
+    {
+        return m_ModelStreams[handle].pModel;
+    }
+    return m_ModelStreams[handle].pPlaceholder;
 }
 
-void VulkanRenderer::CreateUniformBuffers(VkDeviceSize bufferSize, VulkanBuffer *pBuffers, size_t bufferCount)
+StreamStateFlags VulkanRenderer::GetModelStreamState(uint32_t handle)
 {
-    for (size_t i = 0; i < bufferCount; ++i)
+    if (handle >= m_ModelStreams.size())
     {
-        p_Device->CreateBuffer(bufferSize,
-                               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                               (pBuffers + i),
-                               p_Allocator);
-        (pBuffers + i)->Map();
+        FATAL("Invalid model stream handle %u!", handle);
     }
+
+    return m_ModelStreams[handle].State;
 }
 
-void VulkanRenderer::LoadSkyBoxTextures(VulkanTexture *pTextures,
-                                        size_t textureCount,
-                                        const std::array<const char *, 6> &filePathes,
-                                        bool generateMipmap,
-                                        bool flipVerticallyOnLoad)
+uint32_t VulkanRenderer::CreateTexturesAsync(const std::string &filePath,
+                                             VulkanTexture *pTexture,
+                                             size_t textureCount,
+                                             bool generateMipmap,
+                                             bool flipVerticallyOnLoad,
+                                             std::vector<VkDescriptorSet> *pSets,
+                                             uint32_t binding,
+                                             opm::srgb *pPlaceholderColor,
+                                             TextureUsageFlags usage)
 {
-    std::vector<stbi_uc> pixels(2048 * 2048 * 4 * 6);
-    VkDeviceSize size = 0;
-    VkDeviceSize offsets[7] = {0};
-    int width, height, channel;
-    stbi_set_flip_vertically_on_load(flipVerticallyOnLoad);
+    // Placeholder textures so that descriptors can be written and sampled at once
+    CreateTextures(pTexture, textureCount, pPlaceholderColor);
+
+    TextureStream stream{};
+    stream.GenerateMipmap = generateMipmap;
+    stream.pTextures = pTexture;
+    stream.TextureCount = textureCount;
+    stream.pSets = pSets;
+    stream.Binding = binding;
+    // A single texture serves every frame slot, each slot still has its own descriptor set
+    stream.Shared = textureCount == 1 && m_Settings.MaxFramesInFlight > 1;
+    stream.Replaced.resize(stream.Shared ? m_Settings.MaxFramesInFlight : textureCount, false);
+    stream.Future = p_ThreadPool->Enqueue(
+        [this, filePath, flipVerticallyOnLoad, usage](void) -> ImageData
+        {
+            ImageData image{};
+            if (VulkanKTX2::IsKTX2File(filePath))
+            {
+                try
+                {
+                    image.Compressed.Load(filePath);
+                }
+                catch (const std::exception &e)
+                {
+                    image.Error = e.what();
+                }
+                return image;
+            }
 
-    VkDeviceSize size_one = 0;
-    for (size_t i = 0; i < 6; ++i)
+            int width, height, channel;
+            if (stbi_info(filePath.c_str(), &width, &height, &channel))
+            {
+                image.Format = GetTextureFormat(static_cast<uint32_t>(channel), usage);
+            }
+            // The flip flag of stb_image is global, use the thread local one on workers
+            stbi_set_flip_vertically_on_load_thread(flipVerticallyOnLoad);
+            image.pPixels = stbi_load(filePath.c_str(), &width, &height, &channel, static_cast<int>(GetTextureChannelCount(image.Format)));
+            if (image.pPixels == nullptr)
+            {
+                image.Error = "Failed to load texture at " + filePath + ": " + stbi_failure_reason();
+            }
+            else
+            {
+                image.Width = static_cast<uint32_t>(width);
+                image.Height = static_cast<uint32_t>(height);
+                // Already on a worker, downscale here instead of waiting on the pool
+                DownscalePixels(image.pPixels, image.Width, image.Height, GetTextureChannelCount(image.Format), false);
+            }
+            return image;
+        });
+    m_TextureStreams.push_back(std::move(stream));
+
+    return static_cast<uint32_t>(m_TextureStreams.size() - 1);
+}
+
+StreamStateFlags VulkanRenderer::GetTextureStreamState(uint32_t handle)
+{
+    if (handle >= m_TextureStreams.size())
     {
-        stbi_uc *pixelData = stbi_load(filePathes[i], &width, &height, &channel, 4);
-        if (pixelData == nullptr)
-        {
-            FATAL("Failed to load image at %s!", filePathes[i]);
-        }
-        size_one = width * height * 4;
-        offsets[i + 1] = offsets[i] + size_one;
-        size += size_one;
-        if (size != (i + 1) * offsets[1])
+        FATAL("Invalid texture stream handle %u!", handle);
+    }
+
+    return m_TextureStreams[handle].State;
+}
+
+void VulkanRenderer::UpdateStreams()
+{
+    for (size_t i = 0; i < m_ModelStreams.size(); ++i)
+    {
+        ModelStream &stream = m_ModelStreams[i];
+        if (stream.State != STREAM_STATE_LOADING || stream.Future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
         {
-            FATAL("The images' extents are not the same!");
+            continue;
         }
-        if (size > pixels.capacity())
+
+        ModelData data = stream.Future.get();
+        if (data.Vertices.empty())
         {
-            pixels.reserve(size + size_one);
+            WARNING("%s\n", data.Error.c_str());
+            stream.State = STREAM_STATE_FAILED;
+            continue;
         }
-        memcpy(pixels.data() + offsets[i], pixelData, size_one);
-        stbi_image_free(pixelData);
+        stream.pModel = LoadModel(data.Vertices, stream.Binding, stream.InputRate, data.Indices);
+        stream.State = STREAM_STATE_READY;
     }
 
-    VulkanBuffer staging{p_Allocator};
-    p_Device->CreateBuffer(size,
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           pixels.data());
-
-    for (size_t i = 0; i < textureCount; ++i)
+    bool writeDescriptors = false;
+    for (size_t i = 0; i < m_TextureStreams.size(); ++i)
     {
-        // Create image and generate mipmaps
-        if (m_QueueFamilyIndices.TransferHasValue || m_QueueFamilyIndices.GraphicsHasValue)
+        TextureStream &stream = m_TextureStreams[i];
+        if (stream.State != STREAM_STATE_LOADING)
         {
-            VkImageCreateInfo imageCI = vkinfo::ImageInfo();
-            imageCI.imageType = VK_IMAGE_TYPE_2D;
-            imageCI.format = VK_FORMAT_R8G8B8A8_SRGB;
-            imageCI.extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1};
-            imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            if (generateMipmap)
+            continue;
+        }
+        if (!stream.Decoded)
+        {
+            if (stream.Future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
             {
-                imageCI.mipLevels = static_cast<uint32_t>(std::floor(std::log2((std::max)(width, height))) + 1);
+                continue;
             }
-            else
+            stream.Image = stream.Future.get();
+            if (stream.Image.pPixels == nullptr && stream.Image.Compressed.Data.empty())
             {
-                imageCI.mipLevels = 1;
+                WARNING("%s\n", stream.Image.Error.c_str());
+                stream.State = STREAM_STATE_FAILED;
+                continue;
             }
-            imageCI.arrayLayers = 6;
-            imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
-            imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-            imageCI.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-            if (m_UniqueQueueFamilyIndices.size() > 1)
+            stream.Decoded = true;
+        }
+
+        if (stream.Shared)
+        {
+            if (!stream.Swapped)
             {
-                imageCI.queueFamilyIndexCount = static_cast<uint32_t>(m_UniqueQueueFamilyIndices.size());
-                imageCI.pQueueFamilyIndices = m_UniqueQueueFamilyIndices.data();
-                imageCI.sharingMode = VK_SHARING_MODE_CONCURRENT;
+                // Frames in flight keep sampling the placeholder until it is destroyed with them
+                VulkanTexture texture(p_Allocator);
+                if (stream.Image.pPixels != nullptr)
+                {
+                    CreateTexturesFromPixels(stream.Image.pPixels, stream.Image.Width, stream.Image.Height, &texture, 1, stream.GenerateMipmap, stream.Image.Format);
+                }
+                else
+                {
+                    CreateTexturesFromKTX2(stream.Image.Compressed, &texture, 1);
+                }
+                DestroyDeferred(stream.pTextures);
+                *stream.pTextures = std::move(texture);
+                stream.Swapped = true;
+                if (p_BindlessTextures != nullptr)
+                {
+                    p_BindlessTextures->Refresh(stream.pTextures);
+                }
             }
-            else
+            // Only the descriptor set of the current frame slot is guaranteed to be idle
+            uint32_t slot = p_SwapChain->m_CurrentFrame;
+            if (stream.pSets == nullptr)
             {
-                imageCI.queueFamilyIndexCount = 0;
-                imageCI.pQueueFamilyIndices = nullptr;
-                imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+                stream.ReplacedCount = stream.Replaced.size();
             }
-            // This flag is required for cube map
-            imageCI.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
-            VkFormatProperties formatProperties;
-            vkGetPhysicalDeviceFormatProperties(p_Device->GetGPU(), imageCI.format, &formatProperties);
-            if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+            else if (!stream.Replaced[slot])
             {
-                FATAL("Texture image format does not support linear blitting!");
+                // Sets are looked up now, a set allocated later is written with the swapped texture by its owner
+                if (slot < stream.pSets->size() && (*stream.pSets)[slot] != VK_NULL_HANDLE)
+                {
+                    p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (*stream.pSets)[slot], stream.Binding, &stream.pTextures->DescriptorImageInfo);
+                    writeDescriptors = true;
+                }
+                stream.Replaced[slot] = true;
+                ++stream.ReplacedCount;
             }
-
-            (pTextures + i)->Device = p_Device->GetDevice();
-            (pTextures + i)->IsInitialized = true;
-            (pTextures + i)->Allocator = p_Allocator;
-            (pTextures + i)->Width = static_cast<uint32_t>(width);
-            (pTextures + i)->Height = static_cast<uint32_t>(height);
-            (pTextures + i)->Layout = VK_IMAGE_LAYOUT_UNDEFINED;
-            (pTextures + i)->MipMapLevelCount = imageCI.mipLevels;
-            (pTextures + i)->ArrayLayerCount = imageCI.arrayLayers;
-            p_SwapChain->CreateImageWithInfo(&imageCI, &(pTextures + i)->Image, &(pTextures + i)->Memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
-
-            VkCommandBuffer cmdBuffer = p_Device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-            // Initialize resource
-            VkImageSubresourceRange subresource{};
-            subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            subresource.baseArrayLayer = 0;
-            subresource.layerCount = (pTextures + i)->ArrayLayerCount;
-            subresource.baseMipLevel = 0;
-            subresource.levelCount = 1;
-            VkImageMemoryBarrier barrier = vkinfo::ImageMemoryBarrier();
-            barrier.image = (pTextures + i)->Image;
-
-            // Transfer mipmap level 0 image layout
-            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_NONE;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.subresourceRange = subresource;
-            vkCmdPipelineBarrier(cmdBuffer,
-                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 0,
-                                 0, nullptr,
-                                 0, nullptr,
-                                 1, &barrier);
-
-            // Copy buffer to image memory
-            std::vector<VkBufferImageCopy> copyRegins = {};
-            for (uint32_t j = 0; j < (pTextures + i)->ArrayLayerCount; ++j)
+            if (stream.ReplacedCount == stream.Replaced.size())
             {
-                VkBufferImageCopy copyRegin{};
-                copyRegin.imageExtent = {static_cast<uint32_t>((pTextures + i)->Width), static_cast<uint32_t>((pTextures + i)->Height), 1};
-                copyRegin.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                copyRegin.imageSubresource.baseArrayLayer = j;
-                copyRegin.imageSubresource.layerCount = 1;
-                copyRegin.imageSubresource.mipLevel = 0;
-                copyRegin.bufferOffset = offsets[j];
-                copyRegins.push_back(copyRegin);
+                stbi_image_free(stream.Image.pPixels);
+                stream.Image.pPixels = nullptr;
+                stream.Image.Compressed = VulkanKTX2{};
+                stream.State = STREAM_STATE_READY;
             }
-            vkCmdCopyBufferToImage(cmdBuffer,
-                                   staging.Buffer,
-                                   (pTextures + i)->Image,
-                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                   copyRegins.size(),
-                                   copyRegins.data());
+            continue;
+        }
 
-            // Transfer mipmap level 0 image layout
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.subresourceRange = subresource;
-            vkCmdPipelineBarrier(cmdBuffer,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 0,
-                                 0, nullptr,
-                                 0, nullptr,
-                                 1, &barrier);
+        std::vector<size_t> slots = {};
+        if (stream.TextureCount == m_Settings.MaxFramesInFlight)
+        {
+            // Only the current frame slot is guaranteed to be idle after its fence is signaled
+            if (!stream.Replaced[p_SwapChain->m_CurrentFrame])
+            {
+                slots.push_back(p_SwapChain->m_CurrentFrame);
+            }
+        }
+        else
+        {
+            // Textures are not per frame slot, wait for the other frames in flight, the current one has been waited
+            std::vector<VkFence> fences = {};
+            for (uint32_t j = 0; j < m_Settings.MaxFramesInFlight; ++j)
+            {
+                if (j != p_SwapChain->m_CurrentFrame)
+                {
+                    fences.push_back(m_GraphicsInFlightFences[j]);
+                }
+            }
+            if (!fences.empty())
+            {
+                CHECK_VK_RESULT(vkWaitForFences(p_Device->GetDevice(), static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, DEFAULT_FENCE_TIMEOUT));
+            }
+            for (size_t j = 0; j < stream.TextureCount; ++j)
+            {
+                slots.push_back(j);
+            }
+        }
 
-            if (m_QueueFamilyIndices.TransferHasValue)
+        // The placeholder may still be in an asynchronous upload
+        p_Device->CollectUploads(true);
+        for (size_t slot : slots)
+        {
+            (stream.pTextures + slot)->Destroy();
+            if (stream.Image.pPixels != nullptr)
             {
-                p_Device->FlushCommandBuffer(cmdBuffer, m_Queues.Transfer);
+                CreateTexturesFromPixels(stream.Image.pPixels, stream.Image.Width, stream.Image.Height, stream.pTextures + slot, 1, stream.GenerateMipmap, stream.Image.Format);
             }
             else
             {
-                p_Device->FlushCommandBuffer(cmdBuffer, m_Queues.Graphics);
+                CreateTexturesFromKTX2(stream.Image.Compressed, stream.pTextures + slot, 1);
             }
-
-            // Generate mipmap images
-            VkCommandBuffer blitCmd = p_Device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-            int32_t texWidth = static_cast<int32_t>((pTextures + i)->Width);
-            int32_t texHeight = static_cast<int32_t>((pTextures + i)->Height);
-            for (uint32_t j = 1; j < (pTextures + i)->MipMapLevelCount; ++j)
+            if (p_BindlessTextures != nullptr)
             {
-                subresource.baseMipLevel = j;
-                // Transfer "mipmap level image" layout to transfer dstination optimal from undefined
-                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-                barrier.srcAccessMask = VK_ACCESS_NONE;
-                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                barrier.subresourceRange = subresource;
-                vkCmdPipelineBarrier(blitCmd,
-                                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                     0,
-                                     0, nullptr,
-                                     0, nullptr,
-                                     1, &barrier);
-
-                // Blit image
-                VkImageBlit imageBlit{};
-                imageBlit.srcOffsets[0] = {0, 0, 0};
-                imageBlit.srcOffsets[1] = {texWidth, texHeight, 1};
-                imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                imageBlit.srcSubresource.baseArrayLayer = 0;
-                imageBlit.srcSubresource.layerCount = (pTextures + i)->ArrayLayerCount;
-                imageBlit.srcSubresource.mipLevel = j - 1;
-                imageBlit.dstOffsets[0] = {0, 0, 0};
-                imageBlit.dstOffsets[1] = {(texWidth > 1 ? (texWidth /= 2, texWidth) : 1), (texHeight > 1 ? (texHeight /= 2, texHeight) : 1), 1};
-                imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                imageBlit.dstSubresource.baseArrayLayer = 0;
-                imageBlit.dstSubresource.layerCount = (pTextures + i)->ArrayLayerCount;
-                imageBlit.dstSubresource.mipLevel = j;
-                vkCmdBlitImage(blitCmd,
-                               (pTextures + i)->Image,
-                               VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                               (pTextures + i)->Image,
-                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                               1,
-                               &imageBlit,
-                               VK_FILTER_LINEAR);
-
-                // Transfer "mipmap level image" layout to transfer dstination optimal from transfer source optimal
-                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-                barrier.subresourceRange = subresource;
-                vkCmdPipelineBarrier(blitCmd,
-                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                     0,
-                                     0, nullptr,
-                                     0, nullptr,
-                                     1, &barrier);
+                p_BindlessTextures->Refresh(stream.pTextures + slot);
+            }
+            if (stream.pSets != nullptr && slot < stream.pSets->size() && (*stream.pSets)[slot] != VK_NULL_HANDLE)
+            {
+                p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (*stream.pSets)[slot], stream.Binding, &(stream.pTextures + slot)->DescriptorImageInfo);
+                writeDescriptors = true;
             }
+            stream.Replaced[slot] = true;
+            ++stream.ReplacedCount;
+        }
 
-            // Lastly, change the whole image layout to shader read only optimal so that can be sampled from
+        if (stream.ReplacedCount == stream.TextureCount)
+        {
+            stbi_image_free(stream.Image.pPixels);
+            stream.Image.pPixels = nullptr;
+            stream.Image.Compressed = VulkanKTX2{};
+            stream.State = STREAM_STATE_READY;
+        }
+    }
+    if (writeDescriptors)
+    {
+        p_RenderSystem->UpdateDescriptorSets();
+    }
+}
+
+uint32_t VulkanRenderer::GetDeletionFrame() const
+{
+    // Inside a frame the current slot may record the resource, otherwise the last submitted slot is its latest user
+    if (m_BeginFrame)
+    {
+        return p_SwapChain->m_CurrentFrame;
+    }
+    return (p_SwapChain->m_CurrentFrame + m_Settings.MaxFramesInFlight - 1) % m_Settings.MaxFramesInFlight;
+}
+
+void VulkanRenderer::DestroyDeferred(VulkanBuffer *pBuffer)
+{
+    if (pBuffer == nullptr || !pBuffer->IsInitialized)
+    {
+        return;
+    }
+
+    uint32_t frame = GetDeletionFrame();
+    const VkAllocationCallbacks *pAllocator = pBuffer->Allocator;
+    m_DeletionQueues[frame].Buffers.push_back(std::move(*pBuffer));
+    *pBuffer = VulkanBuffer(pAllocator);
+}
+
+void VulkanRenderer::DestroyDeferred(VulkanTexture *pTexture)
+{
+    if (pTexture == nullptr || !pTexture->IsInitialized)
+    {
+        return;
+    }
+
+    uint32_t frame = GetDeletionFrame();
+    const VkAllocationCallbacks *pAllocator = pTexture->Allocator;
+    m_DeletionQueues[frame].Textures.push_back(std::move(*pTexture));
+    *pTexture = VulkanTexture(pAllocator);
+}
+
+void VulkanRenderer::DestroyDeferred(VulkanModel *pModel)
+{
+    if (pModel == nullptr)
+    {
+        return;
+    }
+
+    uint32_t frame = GetDeletionFrame();
+    m_DeletionQueues[frame].Models.push_back(pModel);
+}
+
+void VulkanRenderer::DestroyDeferred(std::function<void()> &&deleter)
+{
+    uint32_t frame = GetDeletionFrame();
+    m_DeletionQueues[frame].Deleters.push_back(std::move(deleter));
+}
+
+void VulkanRenderer::FlushDeletionQueue(uint32_t frame)
+{
+    DeletionQueue &queue = m_DeletionQueues[frame];
+    for (auto &deleter : queue.Deleters)
+    {
+        deleter();
+    }
+    for (auto pModel : queue.Models)
+    {
+        delete pModel;
+    }
+    for (auto &texture : queue.Textures)
+    {
+        texture.Destroy();
+    }
+    for (auto &buffer : queue.Buffers)
+    {
+        buffer.Unmap();
+        buffer.Destroy();
+    }
+    queue.Deleters.clear();
+    queue.Models.clear();
+    queue.Textures.clear();
+    queue.Buffers.clear();
+}
+
+uint32_t VulkanRenderer::TrackTextures(VulkanTexture *pTextures, size_t textureCount, std::vector<VkDescriptorSet> *pSets, uint32_t binding)
+{
+    if (pTextures == nullptr || textureCount == 0)
+    {
+        FATAL("Can not track empty textures!");
+    }
+
+    // Shared textures are downgraded once for all owners
+    for (size_t i = 0; i < m_ResidentTextures.size(); ++i)
+    {
+        ResidentTextures &tracked = m_ResidentTextures[i];
+        if (tracked.pTextures == pTextures && tracked.TextureCount == textureCount && tracked.Binding == binding)
+        {
+            if (pSets != nullptr)
+            {
+                tracked.SetLists.push_back(pSets);
+            }
+            tracked.LastUsedFrame = m_FrameIndex;
+            return static_cast<uint32_t>(i);
+        }
+    }
+
+    ResidentTextures resident{};
+    resident.pTextures = pTextures;
+    resident.TextureCount = textureCount;
+    if (pSets != nullptr)
+    {
+        resident.SetLists.push_back(pSets);
+    }
+    resident.Binding = binding;
+    resident.LastUsedFrame = m_FrameIndex;
+    m_ResidentTextures.push_back(resident);
+
+    return static_cast<uint32_t>(m_ResidentTextures.size() - 1);
+}
+
+void VulkanRenderer::MarkTexturesUsed(uint32_t handle)
+{
+    if (handle >= m_ResidentTextures.size())
+    {
+        FATAL("Invalid tracked texture handle %u!", handle);
+    }
+
+    m_ResidentTextures[handle].LastUsedFrame = m_FrameIndex;
+}
+
+uint32_t VulkanRenderer::AcquireTexture(const std::string &filePath, bool generateMipmap, bool flipVerticallyOnLoad, TextureUsageFlags usage)
+{
+    bool ktx2 = VulkanKTX2::IsKTX2File(filePath);
+    std::string key = filePath;
+    if (!ktx2)
+    {
+        key += generateMipmap ? "|mips" : "|nomips";
+        key += flipVerticallyOnLoad ? "|flip" : "";
+        key += usage == TEXTURE_USAGE_DATA ? "|data" : "|color";
+    }
+
+    auto it = m_TextureCacheHandles.find(key);
+    uint32_t handle = 0U;
+    if (it == m_TextureCacheHandles.end())
+    {
+        CachedTexture cached{};
+        cached.Key = key;
+        m_CachedTextures.push_back(cached);
+        handle = static_cast<uint32_t>(m_CachedTextures.size() - 1);
+        m_TextureCacheHandles.emplace(key, handle);
+    }
+    else
+    {
+        handle = it->second;
+    }
+
+    CachedTexture &cached = m_CachedTextures[handle];
+    if (cached.pTexture == nullptr)
+    {
+        cached.pTexture = new VulkanTexture(p_Allocator);
+        CreateTextures(filePath, cached.pTexture, 1, generateMipmap, flipVerticallyOnLoad, usage);
+    }
+    else
+    {
+        ++m_TextureCacheHitCount;
+    }
+    ++cached.RefCount;
+    cached.LastUsedFrame = m_FrameIndex;
+
+    return handle;
+}
+
+VulkanTexture *VulkanRenderer::GetCachedTexture(uint32_t handle)
+{
+    if (handle >= m_CachedTextures.size() || m_CachedTextures[handle].RefCount == 0)
+    {
+        FATAL("Invalid or released texture cache handle %u!", handle);
+    }
+
+    return m_CachedTextures[handle].pTexture;
+}
+
+void VulkanRenderer::ReleaseTexture(uint32_t handle)
+{
+    if (handle >= m_CachedTextures.size() || m_CachedTextures[handle].RefCount == 0)
+    {
+        FATAL("Invalid or released texture cache handle %u!", handle);
+    }
+
+    CachedTexture &cached = m_CachedTextures[handle];
+    --cached.RefCount;
+    cached.LastUsedFrame = m_FrameIndex;
+}
+
+uint32_t VulkanRenderer::EvictCachedTextures()
+{
+    uint32_t evictedCount = 0U;
+    for (auto &cached : m_CachedTextures)
+    {
+        if (cached.RefCount != 0 || cached.pTexture == nullptr)
+        {
+            continue;
+        }
+        // Released this frame at the latest, so the deletion queue covers the last frame sampling it
+        if (p_BindlessTextures != nullptr)
+        {
+            p_BindlessTextures->Remove(cached.pTexture);
+        }
+        for (auto &resident : m_ResidentTextures)
+        {
+            if (resident.pTextures == cached.pTexture)
+            {
+                resident.pTextures = nullptr;
+                resident.TextureCount = 0;
+                resident.SetLists.clear();
+            }
+        }
+        DestroyDeferred(cached.pTexture);
+        delete cached.pTexture;
+        cached.pTexture = nullptr;
+        ++evictedCount;
+    }
+    m_EvictedTextureCount += evictedCount;
+
+    return evictedCount;
+}
+
+void VulkanRenderer::UpdateMemoryBudget()
+{
+    // Freed memory takes a few frames to show up in the driver budget
+    constexpr uint64_t downgradeInterval = 30U;
+
+    p_Device->UpdateMemoryBudget();
+    float ratio = p_Device->GetDeviceLocalBudgetRatio();
+    if (ratio < m_Settings.MemoryBudgetThreshold || m_FrameIndex < m_LastDowngradeFrame + downgradeInterval)
+    {
+        return;
+    }
+
+    // Unreferenced cached textures cost nothing to reload compared with blurring textures in use
+    uint32_t evictedCount = EvictCachedTextures();
+    if (evictedCount != 0)
+    {
+        m_LastDowngradeFrame = m_FrameIndex;
+        WARNING("Device local memory at %.0f%% of budget, %u cached textures evicted!\n", ratio * 100.0f, evictedCount);
+        return;
+    }
+
+    // Least recently used textures that still have a level to drop
+    ResidentTextures *pVictim = nullptr;
+    for (auto &resident : m_ResidentTextures)
+    {
+        bool downgradable = resident.pTextures != nullptr;
+        for (size_t i = 0; i < resident.TextureCount && downgradable; ++i)
+        {
+            const VulkanTexture *pTexture = resident.pTextures + i;
+            downgradable = pTexture->Image != VK_NULL_HANDLE && pTexture->MipMapLevelCount > 1 && pTexture->ArrayLayerCount == 1 &&
+                           pTexture->Layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        }
+        if (downgradable && (pVictim == nullptr || resident.LastUsedFrame < pVictim->LastUsedFrame))
+        {
+            pVictim = &resident;
+        }
+    }
+    if (pVictim == nullptr)
+    {
+        return;
+    }
+
+    // Tracked textures may be sampled by any frame in flight, the current one has been waited
+    std::vector<VkFence> fences = {};
+    for (uint32_t i = 0; i < m_Settings.MaxFramesInFlight; ++i)
+    {
+        if (i != p_SwapChain->m_CurrentFrame)
+        {
+            fences.push_back(m_GraphicsInFlightFences[i]);
+        }
+    }
+    if (!fences.empty())
+    {
+        CHECK_VK_RESULT(vkWaitForFences(p_Device->GetDevice(), static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, DEFAULT_FENCE_TIMEOUT));
+    }
+    p_Device->CollectUploads(true);
+
+    std::vector<VulkanTexture> downgraded = {};
+    downgraded.reserve(pVictim->TextureCount);
+    VulkanUploadBatch batch{p_Device, p_Allocator};
+    for (size_t i = 0; i < pVictim->TextureCount; ++i)
+    {
+        downgraded.push_back(std::move(VulkanTexture(p_Allocator)));
+        DropTopMipLevel(batch.GetGraphicsCommandBuffer(), pVictim->pTextures + i, &downgraded[i]);
+    }
+    batch.SubmitAsync();
+
+    // The copies are read before the current frame on the graphics queue, so the sources go with the current frame
+    for (size_t i = 0; i < pVictim->TextureCount; ++i)
+    {
+        DestroyDeferred(pVictim->pTextures + i);
+        *(pVictim->pTextures + i) = std::move(downgraded[i]);
+        if (p_BindlessTextures != nullptr)
+        {
+            p_BindlessTextures->Refresh(pVictim->pTextures + i);
+        }
+    }
+    // A shared texture has one descriptor set per frame slot in each owner's list, all idle after the wait above
+    bool writeDescriptors = false;
+    size_t setCount = pVictim->TextureCount == 1 ? m_Settings.MaxFramesInFlight : pVictim->TextureCount;
+    for (std::vector<VkDescriptorSet> *pSets : pVictim->SetLists)
+    {
+        for (size_t i = 0; i < setCount && i < pSets->size(); ++i)
+        {
+            if ((*pSets)[i] == VK_NULL_HANDLE)
+            {
+                continue;
+            }
+            VulkanTexture *pTexture = pVictim->pTextures + (pVictim->TextureCount == 1 ? 0 : i);
+            p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (*pSets)[i], pVictim->Binding, &pTexture->DescriptorImageInfo);
+            writeDescriptors = true;
+        }
+    }
+    if (writeDescriptors)
+    {
+        p_RenderSystem->UpdateDescriptorSets();
+    }
+    m_LastDowngradeFrame = m_FrameIndex;
+    ++m_DroppedMipLevelCount;
+    WARNING("Device local memory at %.0f%% of budget, textures dropped to %ux%u!\n", ratio * 100.0f, pVictim->pTextures->Width, pVictim->pTextures->Height);
+}
+
+void VulkanRenderer::DropTopMipLevel(VkCommandBuffer cmdBuffer, VulkanTexture *pSrc, VulkanTexture *pDst)
+{
+    if (pSrc->MipMapLevelCount <= 1 || pSrc->ArrayLayerCount != 1)
+    {
+        FATAL("Only 2D textures with mipmaps can drop their top mip level!");
+    }
+
+    VkImageCreateInfo imageCI = vkinfo::ImageInfo();
+    imageCI.imageType = VK_IMAGE_TYPE_2D;
+    imageCI.format = pSrc->Format;
+    imageCI.extent = {(std::max)(pSrc->Width >> 1, 1U), (std::max)(pSrc->Height >> 1, 1U), 1};
+    imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageCI.mipLevels = pSrc->MipMapLevelCount - 1;
+    imageCI.arrayLayers = 1;
+    imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCI.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    pDst->Device = p_Device->GetDevice();
+    pDst->IsInitialized = true;
+    pDst->Allocator = p_Allocator;
+    pDst->Width = imageCI.extent.width;
+    pDst->Height = imageCI.extent.height;
+    pDst->Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    pDst->MipMapLevelCount = imageCI.mipLevels;
+    pDst->Format = imageCI.format;
+    pDst->ArrayLayerCount = 1;
+    pDst->Index = pSrc->Index;
+    p_Device->CreateImage(&imageCI, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pDst);
+
+    VkImageMemoryBarrier barriers[2] = {vkinfo::ImageMemoryBarrier(), vkinfo::ImageMemoryBarrier()};
+    barriers[0].image = pSrc->Image;
+    barriers[0].oldLayout = pSrc->Layout;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 1, pDst->MipMapLevelCount, 0, 1};
+    barriers[1].image = pDst->Image;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].srcAccessMask = VK_ACCESS_NONE;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pDst->MipMapLevelCount, 0, 1};
+    vkCmdPipelineBarrier(cmdBuffer,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         0, nullptr,
+                         0, nullptr,
+                         2, barriers);
+
+    // Level j of the new texture is level j + 1 of the source
+    std::vector<VkImageCopy> copyRegins(pDst->MipMapLevelCount);
+    for (uint32_t j = 0; j < pDst->MipMapLevelCount; ++j)
+    {
+        copyRegins[j].srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, j + 1, 0, 1};
+        copyRegins[j].dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, j, 0, 1};
+        copyRegins[j].extent = {(std::max)(pDst->Width >> j, 1U), (std::max)(pDst->Height >> j, 1U), 1};
+    }
+    vkCmdCopyImage(cmdBuffer,
+                   pSrc->Image,
+                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   pDst->Image,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   static_cast<uint32_t>(copyRegins.size()),
+                   copyRegins.data());
+
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmdBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &barriers[1]);
+    pDst->Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkImageViewCreateInfo viewInfo = vkinfo::ImageViewInfo();
+    viewInfo.image = pDst->Image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = pDst->Format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pDst->MipMapLevelCount, 0, 1};
+    viewInfo.components = pSrc->Swizzle;
+    CHECK_VK_RESULT(vkCreateImageView(p_Device->GetDevice(), &viewInfo, p_Allocator, &pDst->View));
+    pDst->Swizzle = pSrc->Swizzle;
+    pDst->Sampler = pSrc->Sampler;
+    pDst->SamplerCache = pSrc->SamplerCache;
+    pSrc->Sampler = VK_NULL_HANDLE;
+    pSrc->SamplerCache = nullptr;
+    pDst->SetDescriptorImage();
+}
+
+uint32_t VulkanRenderer::GetTextureResolutionLimit() const
+{
+    uint32_t limit = p_Device->m_GPUProperties.limits.maxImageDimension2D;
+    if (m_Settings.MaxTextureResolution != 0U)
+    {
+        limit = (std::min)(limit, m_Settings.MaxTextureResolution);
+    }
+    return limit;
+}
+
+void VulkanRenderer::DownscalePixels(unsigned char *&pPixels, uint32_t &width, uint32_t &height, uint32_t channelCount, bool parallel)
+{
+    const uint32_t limit = GetTextureResolutionLimit();
+    while (width > limit || height > limit)
+    {
+        const uint32_t dstWidth = (std::max)(width >> 1U, 1U);
+        const uint32_t dstHeight = (std::max)(height >> 1U, 1U);
+        unsigned char *pDst = static_cast<unsigned char *>(STBI_MALLOC(static_cast<size_t>(dstWidth) * dstHeight * channelCount));
+        if (pDst == nullptr)
+        {
+            FATAL("Failed to allocate %ux%u pixels for texture downscaling!", dstWidth, dstHeight);
+        }
+
+        // Bands of rows are independent, small images are not worth the hand-off
+        const uint32_t bandCount = parallel ? (std::min)((std::max)(std::thread::hardware_concurrency(), 1U), (dstHeight + 63U) / 64U) : 1U;
+        if (bandCount > 1U)
+        {
+            const uint32_t bandHeight = (dstHeight + bandCount - 1U) / bandCount;
+            std::vector<std::future<void>> futures = {};
+            futures.reserve(bandCount);
+            for (uint32_t row = 0; row < dstHeight; row += bandHeight)
+            {
+                const unsigned char *pSrc = pPixels;
+                const uint32_t srcWidth = width, srcHeight = height;
+                const uint32_t rowCount = (std::min)(bandHeight, dstHeight - row);
+                futures.push_back(p_ThreadPool->Enqueue(
+                    [pSrc, srcWidth, srcHeight, pDst, dstWidth, channelCount, row, rowCount](void) -> void
+                    {
+                        DownscaleRows(pSrc, srcWidth, srcHeight, pDst, dstWidth, channelCount, row, rowCount);
+                    }));
+            }
+            for (std::future<void> &future : futures)
+            {
+                future.get();
+            }
+        }
+        else
+        {
+            DownscaleRows(pPixels, width, height, pDst, dstWidth, channelCount, 0U, dstHeight);
+        }
+
+        stbi_image_free(pPixels);
+        pPixels = pDst;
+        width = dstWidth;
+        height = dstHeight;
+    }
+}
+
+void VulkanRenderer::GetImageLayerExtent(const char *const *pFilePathes, size_t layerCount, uint32_t &width, uint32_t &height)
+{
+    int w = 0, h = 0, channel = 0;
+    for (size_t i = 0; i < layerCount; ++i)
+    {
+        int layerWidth = 0, layerHeight = 0;
+        if (!stbi_info(pFilePathes[i], &layerWidth, &layerHeight, &channel))
+        {
+            FATAL("Failed to load image at %s: %s!", pFilePathes[i], stbi_failure_reason());
+        }
+        if (i == 0)
+        {
+            w = layerWidth;
+            h = layerHeight;
+        }
+        else if (layerWidth != w || layerHeight != h)
+        {
+            FATAL("The images' extents are not the same!");
+        }
+    }
+    width = static_cast<uint32_t>(w);
+    height = static_cast<uint32_t>(h);
+
+    // Halve like DownscalePixels so the staging size matches the downscaled layers
+    const uint32_t limit = GetTextureResolutionLimit();
+    while (width > limit || height > limit)
+    {
+        width = (std::max)(width >> 1U, 1U);
+        height = (std::max)(height >> 1U, 1U);
+    }
+}
+
+void VulkanRenderer::DecodeImageLayers(const char *const *pFilePathes,
+                                       size_t layerCount,
+                                       bool flipVerticallyOnLoad,
+                                       uint32_t width,
+                                       uint32_t height,
+                                       void *pDst)
+{
+    const int w = static_cast<int>(width), h = static_cast<int>(height);
+    const size_t layerSize = static_cast<size_t>(width) * height * 4U;
+    std::vector<std::future<std::string>> futures = {};
+    futures.reserve(layerCount);
+    for (size_t i = 0; i < layerCount; ++i)
+    {
+        unsigned char *pLayerDst = static_cast<unsigned char *>(pDst) + i * layerSize;
+        const char *filePath = pFilePathes[i];
+        futures.push_back(p_ThreadPool->Enqueue(
+            [this, filePath, pLayerDst, w, h, layerSize, flipVerticallyOnLoad](void) -> std::string
+            {
+                int layerWidth = 0, layerHeight = 0, layerChannel = 0;
+                // The flip flag of stb_image is global, use the thread local one on workers
+                stbi_set_flip_vertically_on_load_thread(flipVerticallyOnLoad);
+                stbi_uc *pLayer = stbi_load(filePath, &layerWidth, &layerHeight, &layerChannel, 4);
+                if (pLayer == nullptr)
+                {
+                    return std::string("Failed to load image at ") + filePath + ": " + stbi_failure_reason();
+                }
+                // Already on a pool worker, downscale the layer serially
+                uint32_t decodedWidth = static_cast<uint32_t>(layerWidth), decodedHeight = static_cast<uint32_t>(layerHeight);
+                DownscalePixels(pLayer, decodedWidth, decodedHeight, 4U, false);
+                // The header may lie, check the decoded extent before writing to the destination
+                if (decodedWidth != static_cast<uint32_t>(w) || decodedHeight != static_cast<uint32_t>(h))
+                {
+                    stbi_image_free(pLayer);
+                    return std::string("The decoded extent of ") + filePath + " does not match its header!";
+                }
+                memcpy(pLayerDst, pLayer, layerSize);
+                stbi_image_free(pLayer);
+                return std::string();
+            }));
+    }
+
+    // Wait for every layer before reporting, the jobs write into pDst
+    std::string error = {};
+    for (std::future<std::string> &future : futures)
+    {
+        std::string layerError = future.get();
+        if (error.empty())
+        {
+            error = std::move(layerError);
+        }
+    }
+    if (!error.empty())
+    {
+        FATAL("%s", error.c_str());
+    }
+}
+
+void VulkanRenderer::CreateGeometryArena(uint32_t maxVertexCount, uint32_t maxIndexCount, uint32_t maxDrawCount)
+{
+    if (p_GeometryArena != nullptr)
+    {
+        FATAL("Geometry arena has been created!");
+    }
+
+    try
+    {
+        p_GeometryArena = new VulkanGeometryArena(p_Device, m_Settings.MaxFramesInFlight, maxVertexCount, maxIndexCount, maxDrawCount, m_Settings.PositionStream, p_Allocator);
+    }
+    catch (const std::exception &e)
+    {
+        if (p_GeometryArena != nullptr)
+        {
+            delete p_GeometryArena;
+            p_GeometryArena = nullptr;
+        }
+        FATAL(e.what());
+    }
+}
+
+void VulkanRenderer::CreateBindlessTextures(uint32_t maxTextureCount)
+{
+    if (p_BindlessTextures != nullptr)
+    {
+        FATAL("Bindless textures have been created!");
+    }
+    if (!p_Device->DescriptorIndexingSupport())
+    {
+        WARNING("Device feature: descriptor indexing not support, bindless textures are disabled!\n");
+        return;
+    }
+
+    try
+    {
+        p_BindlessTextures = new VulkanBindlessTextures(p_Device, m_Settings.MaxFramesInFlight, maxTextureCount, p_Allocator);
+    }
+    catch (const std::exception &e)
+    {
+        if (p_BindlessTextures != nullptr)
+        {
+            delete p_BindlessTextures;
+            p_BindlessTextures = nullptr;
+        }
+        FATAL(e.what());
+    }
+}
+
+void VulkanRenderer::CreateUniformRing(VkDeviceSize frameSize, VkDeviceSize range)
+{
+    if (p_UniformRing != nullptr)
+    {
+        FATAL("Uniform ring has been created!");
+    }
+
+    try
+    {
+        p_UniformRing = new VulkanUniformRing(p_Device, m_Settings.MaxFramesInFlight, frameSize, range, p_Allocator);
+    }
+    catch (const std::exception &e)
+    {
+        if (p_UniformRing != nullptr)
+        {
+            delete p_UniformRing;
+            p_UniformRing = nullptr;
+        }
+        FATAL(e.what());
+    }
+}
+
+void VulkanRenderer::CreateVertexBuffer(VulkanModel *pModel)
+{
+    VkDeviceSize vertexSize = sizeof(VulkanVertex) * (pModel->GetVertexCount());
+    if (m_Settings.PositionStream)
+    {
+        std::vector<opm::vec3> positions(pModel->GetVertexCount());
+        pModel->CopyPositionData(positions.data());
+        VkDeviceSize positionSize = sizeof(opm::vec3) * positions.size();
+        p_Device->CreateBuffer(positionSize,
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                               &(pModel->m_PositionBuffer));
+        p_Device->UploadBuffer(positions.data(), positionSize, &(pModel->m_PositionBuffer));
+    }
+    p_Device->CreateBuffer(vertexSize,
+                           VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                           &(pModel->m_VertexBuffer));
+    p_Device->UploadBuffer(pModel->GetVertexData(), vertexSize, &(pModel->m_VertexBuffer));
+    pModel->ClearVertexData();
+}
+
+void VulkanRenderer::CreateIndexBuffer(VulkanModel *pModel)
+{
+    VkDeviceSize indexSize = sizeof(IndexType) * (pModel->GetIndexCount());
+    p_Device->CreateBuffer(indexSize,
+                           VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                           &(pModel->m_IndexBuffer));
+    p_Device->UploadBuffer(pModel->GetIndexData(), indexSize, &(pModel->m_IndexBuffer));
+    pModel->ClearIndexData();
+}
+
+void VulkanRenderer::CreateUniformBuffers(VkDeviceSize bufferSize, VulkanBuffer *pBuffers, size_t bufferCount)
+{
+    for (size_t i = 0; i < bufferCount; ++i)
+    {
+        p_Device->CreateBuffer(bufferSize,
+                               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                               (pBuffers + i));
+        (pBuffers + i)->Map();
+    }
+}
+
+void VulkanRenderer::CreateInstanceBuffers(VulkanModel *pModel, uint32_t binding, uint32_t maxInstanceCount)
+{
+    pModel->ReserveInstances(binding, maxInstanceCount, m_Settings.MaxFramesInFlight);
+    for (uint32_t i = 0; i < m_Settings.MaxFramesInFlight; ++i)
+    {
+        pModel->m_InstanceBuffers.push_back(std::move(VulkanBuffer(p_Allocator)));
+        p_Device->CreateBuffer(sizeof(opm::mat4) * maxInstanceCount,
+                               VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                               &pModel->m_InstanceBuffers[i]);
+        pModel->m_InstanceBuffers[i].Map();
+    }
+}
+
+void VulkanRenderer::GenerateMipmaps(VulkanUploadBatch &batch, VulkanTexture *pTexture)
+{
+    if (p_MipmapGenerator != nullptr && p_MipmapGenerator->IsFormatSupported(pTexture->Format) && pTexture->MipMapLevelCount > 1)
+    {
+        p_MipmapGenerator->Generate(batch, pTexture);
+        return;
+    }
+
+    // Fall back to blitting level by level on the graphics queue
+    if (pTexture->MipMapLevelCount > 1)
+    {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(p_Device->GetGPU(), pTexture->Format, &formatProperties);
+        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+        {
+            FATAL("Texture image format does not support linear blitting!");
+        }
+    }
+    VkImageSubresourceRange subresource{};
+    subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresource.baseArrayLayer = 0;
+    subresource.layerCount = pTexture->ArrayLayerCount;
+    subresource.baseMipLevel = 0;
+    subresource.levelCount = 1;
+    VkImageMemoryBarrier barrier = vkinfo::ImageMemoryBarrier();
+    barrier.image = pTexture->Image;
+
+    // Hand mipmap level 0 over to the graphics queue for blitting
+    batch.ReleaseImage(barrier.image,
+                       subresource,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_TRANSFER_READ_BIT);
+
+    // Generate mipmap images
+    VkCommandBuffer blitCmd = batch.GetGraphicsCommandBuffer();
+    int32_t texWidth = static_cast<int32_t>(pTexture->Width);
+    int32_t texHeight = static_cast<int32_t>(pTexture->Height);
+    for (uint32_t j = 1; j < pTexture->MipMapLevelCount; ++j)
+    {
+        subresource.baseMipLevel = j;
+        // Transfer "mipmap level image" layout to transfer dstination optimal from undefined
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_NONE;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.subresourceRange = subresource;
+        vkCmdPipelineBarrier(blitCmd,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+
+        // Blit image
+        VkImageBlit imageBlit{};
+        imageBlit.srcOffsets[0] = {0, 0, 0};
+        imageBlit.srcOffsets[1] = {texWidth, texHeight, 1};
+        imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        imageBlit.srcSubresource.baseArrayLayer = 0;
+        imageBlit.srcSubresource.layerCount = pTexture->ArrayLayerCount;
+        imageBlit.srcSubresource.mipLevel = j - 1;
+        imageBlit.dstOffsets[0] = {0, 0, 0};
+        imageBlit.dstOffsets[1] = {(texWidth > 1 ? (texWidth /= 2, texWidth) : 1), (texHeight > 1 ? (texHeight /= 2, texHeight) : 1), 1};
+        imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        imageBlit.dstSubresource.baseArrayLayer = 0;
+        imageBlit.dstSubresource.layerCount = pTexture->ArrayLayerCount;
+        imageBlit.dstSubresource.mipLevel = j;
+        vkCmdBlitImage(blitCmd,
+                       pTexture->Image,
+                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       pTexture->Image,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       1,
+                       &imageBlit,
+                       VK_FILTER_LINEAR);
+
+        // Transfer "mipmap level image" layout to transfer dstination optimal from transfer source optimal
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.subresourceRange = subresource;
+        vkCmdPipelineBarrier(blitCmd,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+    }
+
+    // Lastly, change the whole image layout to shader read only optimal so that can be sampled from
+    subresource.baseMipLevel = 0;
+    subresource.levelCount = pTexture->MipMapLevelCount;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.subresourceRange = subresource;
+    vkCmdPipelineBarrier(blitCmd,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &barrier);
+    pTexture->Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
+void VulkanRenderer::LoadSkyBoxTextures(VulkanTexture *pTextures,
+                                        size_t textureCount,
+                                        const std::array<const char *, 6> &filePathes,
+                                        bool generateMipmap,
+                                        bool flipVerticallyOnLoad)
+{
+    uint32_t width = 0U, height = 0U;
+    GetImageLayerExtent(filePathes.data(), filePathes.size(), width, height);
+    const VkDeviceSize layerSize = static_cast<VkDeviceSize>(width) * height * 4U;
+
+    VulkanUploadBatch batch{p_Device, p_Allocator};
+    // Layers are decoded straight into the mapped staging region
+    VulkanStagingRing::Region staging = batch.Stage(nullptr, layerSize * filePathes.size());
+    DecodeImageLayers(filePathes.data(), filePathes.size(), flipVerticallyOnLoad, width, height, staging.Mapped);
+
+    for (size_t i = 0; i < textureCount; ++i)
+    {
+        // Create image and generate mipmaps
+        if (m_QueueFamilyIndices.TransferHasValue || m_QueueFamilyIndices.GraphicsHasValue)
+        {
+            VkImageCreateInfo imageCI = vkinfo::ImageInfo();
+            imageCI.imageType = VK_IMAGE_TYPE_2D;
+            imageCI.format = VK_FORMAT_R8G8B8A8_SRGB;
+            imageCI.extent = {width, height, 1};
+            imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if (generateMipmap)
+            {
+                imageCI.mipLevels = static_cast<uint32_t>(std::floor(std::log2((std::max)(width, height))) + 1);
+            }
+            else
+            {
+                imageCI.mipLevels = 1;
+            }
+            imageCI.arrayLayers = 6;
+            imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageCI.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+            // Uploads transfer queue family ownership explicitly
+            imageCI.queueFamilyIndexCount = 0;
+            imageCI.pQueueFamilyIndices = nullptr;
+            imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            // This flag is required for cube map
+            imageCI.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+            // Compute mipmap generation writes the levels through storage views
+            if (imageCI.mipLevels > 1 && p_MipmapGenerator != nullptr)
+            {
+                p_MipmapGenerator->PrepareImageInfo(&imageCI);
+            }
+
+            (pTextures + i)->Device = p_Device->GetDevice();
+            (pTextures + i)->IsInitialized = true;
+            (pTextures + i)->Allocator = p_Allocator;
+            (pTextures + i)->Width = static_cast<uint32_t>(width);
+            (pTextures + i)->Height = static_cast<uint32_t>(height);
+            (pTextures + i)->Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            (pTextures + i)->MipMapLevelCount = imageCI.mipLevels;
+            (pTextures + i)->Format = imageCI.format;
+            (pTextures + i)->ArrayLayerCount = imageCI.arrayLayers;
+            p_Device->CreateImage(&imageCI, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (pTextures + i));
+
+            VkCommandBuffer cmdBuffer = batch.GetTransferCommandBuffer();
+            // Initialize resource
+            VkImageSubresourceRange subresource{};
+            subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            subresource.baseArrayLayer = 0;
+            subresource.layerCount = (pTextures + i)->ArrayLayerCount;
             subresource.baseMipLevel = 0;
-            subresource.levelCount = (pTextures + i)->MipMapLevelCount;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            subresource.levelCount = 1;
+            VkImageMemoryBarrier barrier = vkinfo::ImageMemoryBarrier();
+            barrier.image = (pTextures + i)->Image;
+
+            // Transfer mipmap level 0 image layout
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_NONE;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
             barrier.subresourceRange = subresource;
-            vkCmdPipelineBarrier(blitCmd,
+            vkCmdPipelineBarrier(cmdBuffer,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
                                  VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
                                  0,
                                  0, nullptr,
                                  0, nullptr,
                                  1, &barrier);
-            (pTextures + i)->Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-            if (m_QueueFamilyIndices.TransferHasValue)
-            {
-                p_Device->FlushCommandBuffer(blitCmd, m_Queues.Transfer);
-            }
-            else
-            {
-                p_Device->FlushCommandBuffer(blitCmd, m_Queues.Graphics);
-            }
+            // Copy buffer to image memory
+            std::vector<VkBufferImageCopy> copyRegins = {};
+            for (uint32_t j = 0; j < (pTextures + i)->ArrayLayerCount; ++j)
+            {
+                VkBufferImageCopy copyRegin{};
+                copyRegin.imageExtent = {static_cast<uint32_t>((pTextures + i)->Width), static_cast<uint32_t>((pTextures + i)->Height), 1};
+                copyRegin.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                copyRegin.imageSubresource.baseArrayLayer = j;
+                copyRegin.imageSubresource.layerCount = 1;
+                copyRegin.imageSubresource.mipLevel = 0;
+                copyRegin.bufferOffset = staging.Offset + j * layerSize;
+                copyRegins.push_back(copyRegin);
+            }
+            vkCmdCopyBufferToImage(cmdBuffer,
+                                   staging.Buffer,
+                                   (pTextures + i)->Image,
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   copyRegins.size(),
+                                   copyRegins.data());
+
+            GenerateMipmaps(batch, pTextures + i);
         }
         else
         {
@@ -883,14 +2007,14 @@ void VulkanRenderer::LoadSkyBoxTextures(VulkanTexture *pTextures,
         samplerInfo.compareEnable = VK_FALSE;
         samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = static_cast<float>((pTextures + i)->MipMapLevelCount);
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
         samplerInfo.anisotropyEnable = p_Device->m_GPUFeatures.samplerAnisotropy;
         if (p_Device->m_GPUFeatures.samplerAnisotropy != VK_TRUE)
         {
             WARNING("Device feature: sampler anisotrophy not support! Request at %s line: %d\n!", __FILE__, __LINE__);
         }
         samplerInfo.maxAnisotropy = 8.0f;
-        CHECK_VK_RESULT(vkCreateSampler(p_Device->GetDevice(), &samplerInfo, p_Allocator, &(pTextures + i)->Sampler));
+        p_Device->CreateSampler(&samplerInfo, pTextures + i);
 
         VkImageViewCreateInfo viewInfo = vkinfo::ImageViewInfo();
         viewInfo.image = (pTextures + i)->Image;
@@ -908,7 +2032,8 @@ void VulkanRenderer::LoadSkyBoxTextures(VulkanTexture *pTextures,
         CHECK_VK_RESULT(vkCreateImageView(p_Device->GetDevice(), &viewInfo, p_Allocator, &(pTextures + i)->View));
         (pTextures + i)->SetDescriptorImage();
     }
-    staging.Destroy();
+    // One submission for all textures, the graphics queue acquires them before later rendering
+    batch.SubmitAsync();
 }
 
 void VulkanRenderer::CreateSkyBox(const std::vector<VulkanVertex> vertex,
@@ -956,12 +2081,8 @@ void VulkanRenderer::CreateTextures(VulkanTexture *pTexture,
         }
     }
 
-    VulkanBuffer staging{p_Allocator};
-    p_Device->CreateBuffer(sizeof(opm::srgb),
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           pColor);
+    VulkanUploadBatch batch{p_Device, p_Allocator};
+    VulkanStagingRing::Region staging = batch.Stage(pColor, sizeof(opm::srgb));
 
     for (size_t i = 0; i < textureCount; ++i)
     {
@@ -978,18 +2099,10 @@ void VulkanRenderer::CreateTextures(VulkanTexture *pTexture,
             imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
             imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
             imageCI.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-            if (m_UniqueQueueFamilyIndices.size() > 1)
-            {
-                imageCI.queueFamilyIndexCount = static_cast<uint32_t>(m_UniqueQueueFamilyIndices.size());
-                imageCI.pQueueFamilyIndices = m_UniqueQueueFamilyIndices.data();
-                imageCI.sharingMode = VK_SHARING_MODE_CONCURRENT;
-            }
-            else
-            {
-                imageCI.queueFamilyIndexCount = 0;
-                imageCI.pQueueFamilyIndices = nullptr;
-                imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-            }
+            // Uploads transfer queue family ownership explicitly
+            imageCI.queueFamilyIndexCount = 0;
+            imageCI.pQueueFamilyIndices = nullptr;
+            imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
             VkFormatProperties formatProperties;
             vkGetPhysicalDeviceFormatProperties(p_Device->GetGPU(), imageCI.format, &formatProperties);
             if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
@@ -1004,10 +2117,11 @@ void VulkanRenderer::CreateTextures(VulkanTexture *pTexture,
             (pTexture + i)->Height = 1;
             (pTexture + i)->Layout = VK_IMAGE_LAYOUT_UNDEFINED;
             (pTexture + i)->MipMapLevelCount = imageCI.mipLevels;
+            (pTexture + i)->Format = imageCI.format;
             (pTexture + i)->ArrayLayerCount = 1;
-            p_SwapChain->CreateImageWithInfo(&imageCI, &(pTexture + i)->Image, &(pTexture + i)->Memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+            p_Device->CreateImage(&imageCI, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (pTexture + i));
 
-            VkCommandBuffer cmdBuffer = p_Device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+            VkCommandBuffer cmdBuffer = batch.GetTransferCommandBuffer();
             // Initialize resource
             VkImageSubresourceRange subresource{};
             subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -1039,6 +2153,7 @@ void VulkanRenderer::CreateTextures(VulkanTexture *pTexture,
             copyRegin.imageSubresource.baseArrayLayer = 0;
             copyRegin.imageSubresource.layerCount = (pTexture + i)->ArrayLayerCount;
             copyRegin.imageSubresource.mipLevel = 0;
+            copyRegin.bufferOffset = staging.Offset;
             vkCmdCopyBufferToImage(cmdBuffer,
                                    staging.Buffer,
                                    (pTexture + i)->Image,
@@ -1046,28 +2161,13 @@ void VulkanRenderer::CreateTextures(VulkanTexture *pTexture,
                                    1,
                                    &copyRegin);
 
-            // Transfer image layout
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            barrier.subresourceRange = subresource;
-            vkCmdPipelineBarrier(cmdBuffer,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                                 0,
-                                 0, nullptr,
-                                 0, nullptr,
-                                 1, &barrier);
-
-            if (m_QueueFamilyIndices.TransferHasValue)
-            {
-                p_Device->FlushCommandBuffer(cmdBuffer, m_Queues.Transfer);
-            }
-            else
-            {
-                p_Device->FlushCommandBuffer(cmdBuffer, m_Queues.Graphics);
-            }
+            // Hand the image over to the graphics queue for sampling
+            batch.ReleaseImage(barrier.image,
+                               subresource,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT);
 
             (pTexture + i)->Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         }
@@ -1086,14 +2186,14 @@ void VulkanRenderer::CreateTextures(VulkanTexture *pTexture,
         samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
         samplerInfo.compareEnable = VK_FALSE;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = static_cast<float>((pTexture + i)->MipMapLevelCount);
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
         samplerInfo.anisotropyEnable = p_Device->m_GPUFeatures.samplerAnisotropy;
         if (p_Device->m_GPUFeatures.samplerAnisotropy != VK_TRUE)
         {
             WARNING("Device feature: sampler anisotrophy not support! Request at %s line: %d\n!", __FILE__, __LINE__);
         }
         samplerInfo.maxAnisotropy = 8.0f;
-        CHECK_VK_RESULT(vkCreateSampler(p_Device->GetDevice(), &samplerInfo, p_Allocator, &(pTexture + i)->Sampler));
+        p_Device->CreateSampler(&samplerInfo, pTexture + i);
 
         VkImageViewCreateInfo viewInfo = vkinfo::ImageViewInfo();
         viewInfo.image = (pTexture + i)->Image;
@@ -1112,31 +2212,141 @@ void VulkanRenderer::CreateTextures(VulkanTexture *pTexture,
         (pTexture + i)->SetDescriptorImage();
     }
 
-    staging.Destroy();
+    // One submission for all textures, the graphics queue acquires them before later rendering
+    batch.SubmitAsync();
 }
 
 void VulkanRenderer::CreateTextures(const std::string &filePath,
                                     VulkanTexture *pTexture,
                                     size_t textureCount,
                                     bool generateMipmap,
-                                    bool flipVerticallyOnLoad)
+                                    bool flipVerticallyOnLoad,
+                                    TextureUsageFlags usage)
 {
+    if (VulkanKTX2::IsKTX2File(filePath))
+    {
+        VulkanKTX2 image{};
+        image.Load(filePath);
+        CreateTexturesFromKTX2(image, pTexture, textureCount);
+        return;
+    }
+
     int width, height, channel;
+    if (!stbi_info(filePath.c_str(), &width, &height, &channel))
+    {
+        FATAL("Failed to load texture at %s!", filePath.c_str());
+    }
+    VkFormat format = GetTextureFormat(static_cast<uint32_t>(channel), usage);
     stbi_set_flip_vertically_on_load(flipVerticallyOnLoad);
-    stbi_uc *pixels = stbi_load(filePath.c_str(), &width, &height, &channel, 4);
+    stbi_uc *pixels = stbi_load(filePath.c_str(), &width, &height, &channel, static_cast<int>(GetTextureChannelCount(format)));
     if (pixels == nullptr)
     {
         FATAL("Failed to load texture at %s!", filePath.c_str());
     }
-    VkDeviceSize pixelSize = width * height * 4;
-
-    VulkanBuffer staging{p_Allocator};
-    p_Device->CreateBuffer(pixelSize,
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           pixels);
+    uint32_t textureWidth = static_cast<uint32_t>(width), textureHeight = static_cast<uint32_t>(height);
+    DownscalePixels(pixels, textureWidth, textureHeight, GetTextureChannelCount(format), true);
+    CreateTexturesFromPixels(pixels, textureWidth, textureHeight, pTexture, textureCount, generateMipmap, format);
     stbi_image_free(pixels);
+}
+
+void VulkanRenderer::CreatePackedTextures(const std::string &redFilePath,
+                                          const std::string &greenFilePath,
+                                          VulkanTexture *pTexture,
+                                          size_t textureCount,
+                                          bool generateMipmap,
+                                          bool flipVerticallyOnLoad)
+{
+    int redWidth, redHeight, greenWidth, greenHeight, channel;
+    stbi_set_flip_vertically_on_load(flipVerticallyOnLoad);
+    stbi_uc *pRed = stbi_load(redFilePath.c_str(), &redWidth, &redHeight, &channel, 1);
+    if (pRed == nullptr)
+    {
+        FATAL("Failed to load texture at %s!", redFilePath.c_str());
+    }
+    stbi_uc *pGreen = stbi_load(greenFilePath.c_str(), &greenWidth, &greenHeight, &channel, 1);
+    if (pGreen == nullptr)
+    {
+        stbi_image_free(pRed);
+        FATAL("Failed to load texture at %s!", greenFilePath.c_str());
+    }
+    if (redWidth != greenWidth || redHeight != greenHeight)
+    {
+        stbi_image_free(pRed);
+        stbi_image_free(pGreen);
+        FATAL("Packed textures must have the same extent! %s is %dx%d, %s is %dx%d",
+              redFilePath.c_str(), redWidth, redHeight, greenFilePath.c_str(), greenWidth, greenHeight);
+    }
+
+    uint32_t width = static_cast<uint32_t>(redWidth), height = static_cast<uint32_t>(redHeight);
+    DownscalePixels(pRed, width, height, 1U, true);
+    width = static_cast<uint32_t>(greenWidth);
+    height = static_cast<uint32_t>(greenHeight);
+    DownscalePixels(pGreen, width, height, 1U, true);
+
+    // R8G8 UNORM is mandatory for sampling, filtering and blitting, so the pair never falls back to four channels
+    size_t pixelCount = static_cast<size_t>(width) * static_cast<size_t>(height);
+    std::vector<stbi_uc> packed(pixelCount * 2);
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        packed[i * 2] = pRed[i];
+        packed[i * 2 + 1] = pGreen[i];
+    }
+    stbi_image_free(pRed);
+    stbi_image_free(pGreen);
+    CreateTexturesFromPixels(packed.data(), width, height, pTexture, textureCount, generateMipmap, VK_FORMAT_R8G8_UNORM);
+}
+
+VkFormat VulkanRenderer::GetTextureFormat(uint32_t channelCount, TextureUsageFlags usage) const
+{
+    bool srgb = usage != TEXTURE_USAGE_DATA;
+    VkFormat format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    if (channelCount == 1)
+    {
+        format = srgb ? VK_FORMAT_R8_SRGB : VK_FORMAT_R8_UNORM;
+    }
+    else if (channelCount == 2)
+    {
+        format = srgb ? VK_FORMAT_R8G8_SRGB : VK_FORMAT_R8G8_UNORM;
+    }
+    else
+    {
+        // RGB8 is rarely supported with optimal tiling
+        return format;
+    }
+
+    // Mipmaps may be blitted with linear filtering
+    VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
+                                            VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    VkFormatProperties formatProperties{};
+    vkGetPhysicalDeviceFormatProperties(p_Device->GetGPU(), format, &formatProperties);
+    if ((formatProperties.optimalTilingFeatures & requiredFeatures) != requiredFeatures)
+    {
+        return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+    return format;
+}
+
+void VulkanRenderer::CreateTexturesFromPixels(const void *pixels,
+                                              uint32_t width,
+                                              uint32_t height,
+                                              VulkanTexture *pTexture,
+                                              size_t textureCount,
+                                              bool generateMipmap,
+                                              VkFormat format)
+{
+    if (pixels == nullptr || width == 0 || height == 0)
+    {
+        FATAL("Can not create textures from empty pixels!");
+    }
+    uint32_t channelCount = GetTextureChannelCount(format);
+    if (channelCount == 0)
+    {
+        FATAL("Textures from pixels must have an 8 bit R, RG or RGBA format!");
+    }
+    VkDeviceSize pixelSize = static_cast<VkDeviceSize>(width) * height * channelCount;
+
+    VulkanUploadBatch batch{p_Device, p_Allocator};
+    VulkanStagingRing::Region staging = batch.Stage(pixels, pixelSize);
 
     for (size_t i = 0; i < textureCount; ++i)
     {
@@ -1145,8 +2355,8 @@ void VulkanRenderer::CreateTextures(const std::string &filePath,
         {
             VkImageCreateInfo imageCI = vkinfo::ImageInfo();
             imageCI.imageType = VK_IMAGE_TYPE_2D;
-            imageCI.format = VK_FORMAT_R8G8B8A8_SRGB;
-            imageCI.extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1};
+            imageCI.format = format;
+            imageCI.extent = {width, height, 1};
             imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
             if (generateMipmap)
             {
@@ -1160,23 +2370,14 @@ void VulkanRenderer::CreateTextures(const std::string &filePath,
             imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
             imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
             imageCI.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-            if (m_UniqueQueueFamilyIndices.size() > 1)
-            {
-                imageCI.queueFamilyIndexCount = static_cast<uint32_t>(m_UniqueQueueFamilyIndices.size());
-                imageCI.pQueueFamilyIndices = m_UniqueQueueFamilyIndices.data();
-                imageCI.sharingMode = VK_SHARING_MODE_CONCURRENT;
-            }
-            else
-            {
-                imageCI.queueFamilyIndexCount = 0;
-                imageCI.pQueueFamilyIndices = nullptr;
-                imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-            }
-            VkFormatProperties formatProperties;
-            vkGetPhysicalDeviceFormatProperties(p_Device->GetGPU(), imageCI.format, &formatProperties);
-            if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+            // Uploads transfer queue family ownership explicitly
+            imageCI.queueFamilyIndexCount = 0;
+            imageCI.pQueueFamilyIndices = nullptr;
+            imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            // Compute mipmap generation writes the levels through storage views
+            if (imageCI.mipLevels > 1 && p_MipmapGenerator != nullptr)
             {
-                FATAL("Texture image format does not support linear blitting!");
+                p_MipmapGenerator->PrepareImageInfo(&imageCI);
             }
 
             (pTexture + i)->Device = p_Device->GetDevice();
@@ -1186,10 +2387,11 @@ void VulkanRenderer::CreateTextures(const std::string &filePath,
             (pTexture + i)->Height = static_cast<uint32_t>(height);
             (pTexture + i)->Layout = VK_IMAGE_LAYOUT_UNDEFINED;
             (pTexture + i)->MipMapLevelCount = imageCI.mipLevels;
+            (pTexture + i)->Format = imageCI.format;
             (pTexture + i)->ArrayLayerCount = imageCI.arrayLayers;
-            p_SwapChain->CreateImageWithInfo(&imageCI, &(pTexture + i)->Image, &(pTexture + i)->Memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+            p_Device->CreateImage(&imageCI, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (pTexture + i));
 
-            VkCommandBuffer cmdBuffer = p_Device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+            VkCommandBuffer cmdBuffer = batch.GetTransferCommandBuffer();
             // Initialize resource
             VkImageSubresourceRange subresource{};
             subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -1221,6 +2423,7 @@ void VulkanRenderer::CreateTextures(const std::string &filePath,
             copyRegin.imageSubresource.baseArrayLayer = 0;
             copyRegin.imageSubresource.layerCount = (pTexture + i)->ArrayLayerCount;
             copyRegin.imageSubresource.mipLevel = 0;
+            copyRegin.bufferOffset = staging.Offset;
             vkCmdCopyBufferToImage(cmdBuffer,
                                    staging.Buffer,
                                    (pTexture + i)->Image,
@@ -1228,142 +2431,203 @@ void VulkanRenderer::CreateTextures(const std::string &filePath,
                                    1,
                                    &copyRegin);
 
-            // Transfer mipmap level 0 image layout
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.subresourceRange = subresource;
-            vkCmdPipelineBarrier(cmdBuffer,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 0,
-                                 0, nullptr,
-                                 0, nullptr,
-                                 1, &barrier);
+            GenerateMipmaps(batch, pTexture + i);
+        }
+        else
+        {
+            FATAL("It seems neither the transfer queue nor the graphics queue are enabled when initializing device!");
+        }
 
-            if (m_QueueFamilyIndices.TransferHasValue)
-            {
-                p_Device->FlushCommandBuffer(cmdBuffer, m_Queues.Transfer);
-            }
-            else
-            {
-                p_Device->FlushCommandBuffer(cmdBuffer, m_Queues.Graphics);
-            }
+        // Create image sampler
+        VkSamplerCreateInfo samplerInfo = vkinfo::SamplerInfo();
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.compareEnable = VK_FALSE;
+        samplerInfo.minLod = 0.0f;
+        // The view limits the mip range, so textures of any mip count share one cached sampler
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        samplerInfo.anisotropyEnable = p_Device->m_GPUFeatures.samplerAnisotropy;
+        if (p_Device->m_GPUFeatures.samplerAnisotropy != VK_TRUE)
+        {
+            WARNING("Device feature: sampler anisotrophy not support! Request at %s line: %d\n!", __FILE__, __LINE__);
+        }
+        samplerInfo.maxAnisotropy = 8.0f;
+        p_Device->CreateSampler(&samplerInfo, pTexture + i);
+
+        VkImageViewCreateInfo viewInfo = vkinfo::ImageViewInfo();
+        viewInfo.image = (pTexture + i)->Image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = (pTexture + i)->Format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = (pTexture + i)->ArrayLayerCount;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = (pTexture + i)->MipMapLevelCount;
+        (pTexture + i)->Swizzle = GetTextureSwizzle((pTexture + i)->Format);
+        viewInfo.components = (pTexture + i)->Swizzle;
+        CHECK_VK_RESULT(vkCreateImageView(p_Device->GetDevice(), &viewInfo, p_Allocator, &(pTexture + i)->View));
+        (pTexture + i)->SetDescriptorImage();
+    }
+
+    // One submission for all textures, the graphics queue acquires them before later rendering
+    batch.SubmitAsync();
+}
 
-            // Generate mipmap images
-            VkCommandBuffer blitCmd = p_Device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-            int32_t texWidth = static_cast<int32_t>((pTexture + i)->Width);
-            int32_t texHeight = static_cast<int32_t>((pTexture + i)->Height);
-            for (uint32_t j = 1; j < (pTexture + i)->MipMapLevelCount; ++j)
+void VulkanRenderer::CreateTexturesFromKTX2(const VulkanKTX2 &image,
+                                            VulkanTexture *pTexture,
+                                            size_t textureCount)
+{
+    if (image.Data.empty() || image.Levels.empty())
+    {
+        FATAL("Can not create textures from an empty KTX2 image!");
+    }
+
+    // Levels above the resolution limit are never staged, the image starts at the first level that fits
+    const uint32_t limit = GetTextureResolutionLimit();
+    uint32_t baseLevel = 0U;
+    while (baseLevel + 1U < image.GetLevelCount() && ((image.Width >> baseLevel) > limit || (image.Height >> baseLevel) > limit))
+    {
+        ++baseLevel;
+    }
+    const uint32_t width = (std::max)(image.Width >> baseLevel, 1U);
+    const uint32_t height = (std::max)(image.Height >> baseLevel, 1U);
+    if (width > limit || height > limit)
+    {
+        WARNING("KTX2 image of %ux%u has no stored level within the texture resolution limit %u!\n", image.Width, image.Height, limit);
+    }
+
+    VulkanUploadBatch batch{p_Device, p_Allocator};
+    // Buffer offsets of compressed copies must be multiples of the block size, level sizes already are
+    const VkDeviceSize baseOffset = image.Levels[baseLevel].Offset;
+    VulkanStagingRing::Region staging = batch.Stage(image.Data.data() + baseOffset, image.Data.size() - static_cast<size_t>(baseOffset), 16U);
+
+    const bool cube = image.FaceCount == 6U;
+    for (size_t i = 0; i < textureCount; ++i)
+    {
+        if (m_QueueFamilyIndices.TransferHasValue || m_QueueFamilyIndices.GraphicsHasValue)
+        {
+            VkImageCreateInfo imageCI = vkinfo::ImageInfo();
+            imageCI.imageType = VK_IMAGE_TYPE_2D;
+            imageCI.format = image.Format;
+            imageCI.extent = {width, height, 1};
+            imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageCI.mipLevels = image.GetLevelCount() - baseLevel;
+            imageCI.arrayLayers = image.LayerCount * image.FaceCount;
+            imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageCI.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+            // Uploads transfer queue family ownership explicitly
+            imageCI.queueFamilyIndexCount = 0;
+            imageCI.pQueueFamilyIndices = nullptr;
+            imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageCI.flags = cube ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(p_Device->GetGPU(), imageCI.format, &formatProperties);
+            if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
             {
-                subresource.baseMipLevel = j;
-                // Transfer "mipmap level image" layout to transfer dstination optimal from undefined
-                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-                barrier.srcAccessMask = VK_ACCESS_NONE;
-                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                barrier.subresourceRange = subresource;
-                vkCmdPipelineBarrier(blitCmd,
-                                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                     0,
-                                     0, nullptr,
-                                     0, nullptr,
-                                     1, &barrier);
-
-                // Blit image
-                VkImageBlit imageBlit{};
-                imageBlit.srcOffsets[0] = {0, 0, 0};
-                imageBlit.srcOffsets[1] = {texWidth, texHeight, 1};
-                imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                imageBlit.srcSubresource.baseArrayLayer = 0;
-                imageBlit.srcSubresource.layerCount = (pTexture + i)->ArrayLayerCount;
-                imageBlit.srcSubresource.mipLevel = j - 1;
-                imageBlit.dstOffsets[0] = {0, 0, 0};
-                imageBlit.dstOffsets[1] = {(texWidth > 1 ? (texWidth /= 2, texWidth) : 1), (texHeight > 1 ? (texHeight /= 2, texHeight) : 1), 1};
-                imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                imageBlit.dstSubresource.baseArrayLayer = 0;
-                imageBlit.dstSubresource.layerCount = (pTexture + i)->ArrayLayerCount;
-                imageBlit.dstSubresource.mipLevel = j;
-                vkCmdBlitImage(blitCmd,
-                               (pTexture + i)->Image,
-                               VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                               (pTexture + i)->Image,
-                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                               1,
-                               &imageBlit,
-                               VK_FILTER_LINEAR);
-
-                // Transfer "mipmap level image" layout to transfer dstination optimal from transfer source optimal
-                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-                barrier.subresourceRange = subresource;
-                vkCmdPipelineBarrier(blitCmd,
-                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                     0,
-                                     0, nullptr,
-                                     0, nullptr,
-                                     1, &barrier);
+                FATAL("KTX2 texture format %u can not be sampled with linear filtering on this device!", static_cast<uint32_t>(imageCI.format));
             }
 
-            // Lastly, change the whole image layout to shader read only optimal so that can be sampled from
+            (pTexture + i)->Device = p_Device->GetDevice();
+            (pTexture + i)->IsInitialized = true;
+            (pTexture + i)->Allocator = p_Allocator;
+            (pTexture + i)->Width = width;
+            (pTexture + i)->Height = height;
+            (pTexture + i)->Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            (pTexture + i)->MipMapLevelCount = imageCI.mipLevels;
+            (pTexture + i)->Format = imageCI.format;
+            (pTexture + i)->ArrayLayerCount = imageCI.arrayLayers;
+            p_Device->CreateImage(&imageCI, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (pTexture + i));
+
+            VkCommandBuffer cmdBuffer = batch.GetTransferCommandBuffer();
+            VkImageSubresourceRange subresource{};
+            subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            subresource.baseArrayLayer = 0;
+            subresource.layerCount = (pTexture + i)->ArrayLayerCount;
             subresource.baseMipLevel = 0;
             subresource.levelCount = (pTexture + i)->MipMapLevelCount;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            VkImageMemoryBarrier barrier = vkinfo::ImageMemoryBarrier();
+            barrier.image = (pTexture + i)->Image;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_NONE;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
             barrier.subresourceRange = subresource;
-            vkCmdPipelineBarrier(blitCmd,
+            vkCmdPipelineBarrier(cmdBuffer,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
                                  VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
                                  0,
                                  0, nullptr,
                                  0, nullptr,
                                  1, &barrier);
-            (pTexture + i)->Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-            if (m_QueueFamilyIndices.TransferHasValue)
+            // Every kept level is copied as stored, layers and faces of a level are packed one after another
+            std::vector<VkBufferImageCopy> copyRegions = {};
+            for (uint32_t j = 0; j < (pTexture + i)->MipMapLevelCount; ++j)
             {
-                p_Device->FlushCommandBuffer(blitCmd, m_Queues.Transfer);
-            }
-            else
-            {
-                p_Device->FlushCommandBuffer(blitCmd, m_Queues.Graphics);
+                VkBufferImageCopy copyRegion{};
+                copyRegion.imageExtent = {(std::max)(width >> j, 1U), (std::max)(height >> j, 1U), 1};
+                copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                copyRegion.imageSubresource.baseArrayLayer = 0;
+                copyRegion.imageSubresource.layerCount = (pTexture + i)->ArrayLayerCount;
+                copyRegion.imageSubresource.mipLevel = j;
+                copyRegion.bufferOffset = staging.Offset + image.Levels[baseLevel + j].Offset - baseOffset;
+                copyRegions.push_back(copyRegion);
             }
+            vkCmdCopyBufferToImage(cmdBuffer,
+                                   staging.Buffer,
+                                   (pTexture + i)->Image,
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   static_cast<uint32_t>(copyRegions.size()),
+                                   copyRegions.data());
+
+            // No blits are needed, hand the whole image over ready for sampling
+            batch.ReleaseImage(barrier.image,
+                               subresource,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT);
+            (pTexture + i)->Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         }
         else
         {
             FATAL("It seems neither the transfer queue nor the graphics queue are enabled when initializing device!");
         }
 
-        // Create image sampler
         VkSamplerCreateInfo samplerInfo = vkinfo::SamplerInfo();
         samplerInfo.minFilter = VK_FILTER_LINEAR;
         samplerInfo.magFilter = VK_FILTER_LINEAR;
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeU = cube ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeV = cube ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeW = cube ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT;
         samplerInfo.compareEnable = VK_FALSE;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = static_cast<float>((pTexture + i)->MipMapLevelCount);
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
         samplerInfo.anisotropyEnable = p_Device->m_GPUFeatures.samplerAnisotropy;
         if (p_Device->m_GPUFeatures.samplerAnisotropy != VK_TRUE)
         {
             WARNING("Device feature: sampler anisotrophy not support! Request at %s line: %d\n!", __FILE__, __LINE__);
         }
         samplerInfo.maxAnisotropy = 8.0f;
-        CHECK_VK_RESULT(vkCreateSampler(p_Device->GetDevice(), &samplerInfo, p_Allocator, &(pTexture + i)->Sampler));
+        p_Device->CreateSampler(&samplerInfo, pTexture + i);
 
         VkImageViewCreateInfo viewInfo = vkinfo::ImageViewInfo();
         viewInfo.image = (pTexture + i)->Image;
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        viewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+        if (cube)
+        {
+            viewInfo.viewType = image.LayerCount > 1U ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE;
+        }
+        else
+        {
+            viewInfo.viewType = image.LayerCount > 1U ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+        }
+        viewInfo.format = (pTexture + i)->Format;
         viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         viewInfo.subresourceRange.baseArrayLayer = 0;
         viewInfo.subresourceRange.layerCount = (pTexture + i)->ArrayLayerCount;
@@ -1377,7 +2641,8 @@ void VulkanRenderer::CreateTextures(const std::string &filePath,
         (pTexture + i)->SetDescriptorImage();
     }
 
-    staging.Destroy();
+    // One submission for all textures, the graphics queue acquires them before later rendering
+    batch.SubmitAsync();
 }
 
 void VulkanRenderer::CreateTextureArray(const std::vector<const char *> &filePathes,
@@ -1386,41 +2651,14 @@ void VulkanRenderer::CreateTextureArray(const std::vector<const char *> &filePat
                                         bool generateMipmap,
                                         bool flipVerticallyOnLoad)
 {
-    std::vector<stbi_uc> pixels(2048 * 2048 * 4 * 6);
-    VkDeviceSize size = 0;
-    std::vector<VkDeviceSize> offsets(filePathes.size() + 1, 0);
-    int width, height, channel;
-    stbi_set_flip_vertically_on_load(flipVerticallyOnLoad);
-
-    VkDeviceSize size_one = 0;
-    for (size_t i = 0; i < filePathes.size(); ++i)
-    {
-        stbi_uc *pixelData = stbi_load(filePathes[i], &width, &height, &channel, 4);
-        if (pixelData == nullptr)
-        {
-            FATAL("Failed to load image at %s!", filePathes[i]);
-        }
-        size_one = width * height * 4;
-        offsets[i + 1] = offsets[i] + size_one;
-        size += size_one;
-        if (size != (i + 1) * offsets[1])
-        {
-            FATAL("The images' extents are not the same!");
-        }
-        if (size > pixels.capacity())
-        {
-            pixels.reserve(size + size_one);
-        }
-        memcpy(pixels.data() + offsets[i], pixelData, size_one);
-        stbi_image_free(pixelData);
-    }
+    uint32_t width = 0U, height = 0U;
+    GetImageLayerExtent(filePathes.data(), filePathes.size(), width, height);
+    const VkDeviceSize layerSize = static_cast<VkDeviceSize>(width) * height * 4U;
 
-    VulkanBuffer staging{p_Allocator};
-    p_Device->CreateBuffer(size,
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           pixels.data());
+    VulkanUploadBatch batch{p_Device, p_Allocator};
+    // Layers are decoded straight into the mapped staging region
+    VulkanStagingRing::Region staging = batch.Stage(nullptr, layerSize * filePathes.size());
+    DecodeImageLayers(filePathes.data(), filePathes.size(), flipVerticallyOnLoad, width, height, staging.Mapped);
 
     for (size_t i = 0; i < textureCount; ++i)
     {
@@ -1430,7 +2668,7 @@ void VulkanRenderer::CreateTextureArray(const std::vector<const char *> &filePat
             VkImageCreateInfo imageCI = vkinfo::ImageInfo();
             imageCI.imageType = VK_IMAGE_TYPE_2D;
             imageCI.format = VK_FORMAT_R8G8B8A8_SRGB;
-            imageCI.extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1};
+            imageCI.extent = {width, height, 1};
             imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
             if (generateMipmap)
             {
@@ -1444,23 +2682,14 @@ void VulkanRenderer::CreateTextureArray(const std::vector<const char *> &filePat
             imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
             imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
             imageCI.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-            if (m_UniqueQueueFamilyIndices.size() > 1)
-            {
-                imageCI.queueFamilyIndexCount = static_cast<uint32_t>(m_UniqueQueueFamilyIndices.size());
-                imageCI.pQueueFamilyIndices = m_UniqueQueueFamilyIndices.data();
-                imageCI.sharingMode = VK_SHARING_MODE_CONCURRENT;
-            }
-            else
+            // Uploads transfer queue family ownership explicitly
+            imageCI.queueFamilyIndexCount = 0;
+            imageCI.pQueueFamilyIndices = nullptr;
+            imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            // Compute mipmap generation writes the levels through storage views
+            if (imageCI.mipLevels > 1 && p_MipmapGenerator != nullptr)
             {
-                imageCI.queueFamilyIndexCount = 0;
-                imageCI.pQueueFamilyIndices = nullptr;
-                imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-            }
-            VkFormatProperties formatProperties;
-            vkGetPhysicalDeviceFormatProperties(p_Device->GetGPU(), imageCI.format, &formatProperties);
-            if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
-            {
-                FATAL("Texture image format does not support linear blitting!");
+                p_MipmapGenerator->PrepareImageInfo(&imageCI);
             }
 
             (pTextures + i)->Device = p_Device->GetDevice();
@@ -1470,10 +2699,11 @@ void VulkanRenderer::CreateTextureArray(const std::vector<const char *> &filePat
             (pTextures + i)->Height = static_cast<uint32_t>(height);
             (pTextures + i)->Layout = VK_IMAGE_LAYOUT_UNDEFINED;
             (pTextures + i)->MipMapLevelCount = imageCI.mipLevels;
+            (pTextures + i)->Format = imageCI.format;
             (pTextures + i)->ArrayLayerCount = imageCI.arrayLayers;
-            p_SwapChain->CreateImageWithInfo(&imageCI, &(pTextures + i)->Image, &(pTextures + i)->Memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+            p_Device->CreateImage(&imageCI, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (pTextures + i));
 
-            VkCommandBuffer cmdBuffer = p_Device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+            VkCommandBuffer cmdBuffer = batch.GetTransferCommandBuffer();
             // Initialize resource
             VkImageSubresourceRange subresource{};
             subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -1508,7 +2738,7 @@ void VulkanRenderer::CreateTextureArray(const std::vector<const char *> &filePat
                 copyRegin.imageSubresource.baseArrayLayer = j;
                 copyRegin.imageSubresource.layerCount = 1;
                 copyRegin.imageSubresource.mipLevel = 0;
-                copyRegin.bufferOffset = offsets[j];
+                copyRegin.bufferOffset = staging.Offset + j * layerSize;
                 copyRegins.push_back(copyRegin);
             }
             vkCmdCopyBufferToImage(cmdBuffer,
@@ -1518,113 +2748,7 @@ void VulkanRenderer::CreateTextureArray(const std::vector<const char *> &filePat
                                    copyRegins.size(),
                                    copyRegins.data());
 
-            // Transfer mipmap level 0 image layout
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.subresourceRange = subresource;
-            vkCmdPipelineBarrier(cmdBuffer,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 0,
-                                 0, nullptr,
-                                 0, nullptr,
-                                 1, &barrier);
-
-            if (m_QueueFamilyIndices.TransferHasValue)
-            {
-                p_Device->FlushCommandBuffer(cmdBuffer, m_Queues.Transfer);
-            }
-            else
-            {
-                p_Device->FlushCommandBuffer(cmdBuffer, m_Queues.Graphics);
-            }
-
-            // Generate mipmap images
-            VkCommandBuffer blitCmd = p_Device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-            int32_t texWidth = static_cast<int32_t>((pTextures + i)->Width);
-            int32_t texHeight = static_cast<int32_t>((pTextures + i)->Height);
-            for (uint32_t j = 1; j < (pTextures + i)->MipMapLevelCount; ++j)
-            {
-                subresource.baseMipLevel = j;
-                // Transfer "mipmap level image" layout to transfer dstination optimal from undefined
-                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-                barrier.srcAccessMask = VK_ACCESS_NONE;
-                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                barrier.subresourceRange = subresource;
-                vkCmdPipelineBarrier(blitCmd,
-                                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                     0,
-                                     0, nullptr,
-                                     0, nullptr,
-                                     1, &barrier);
-
-                // Blit image
-                VkImageBlit imageBlit{};
-                imageBlit.srcOffsets[0] = {0, 0, 0};
-                imageBlit.srcOffsets[1] = {texWidth, texHeight, 1};
-                imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                imageBlit.srcSubresource.baseArrayLayer = 0;
-                imageBlit.srcSubresource.layerCount = (pTextures + i)->ArrayLayerCount;
-                imageBlit.srcSubresource.mipLevel = j - 1;
-                imageBlit.dstOffsets[0] = {0, 0, 0};
-                imageBlit.dstOffsets[1] = {(texWidth > 1 ? (texWidth /= 2, texWidth) : 1), (texHeight > 1 ? (texHeight /= 2, texHeight) : 1), 1};
-                imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                imageBlit.dstSubresource.baseArrayLayer = 0;
-                imageBlit.dstSubresource.layerCount = (pTextures + i)->ArrayLayerCount;
-                imageBlit.dstSubresource.mipLevel = j;
-                vkCmdBlitImage(blitCmd,
-                               (pTextures + i)->Image,
-                               VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                               (pTextures + i)->Image,
-                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                               1,
-                               &imageBlit,
-                               VK_FILTER_LINEAR);
-
-                // Transfer "mipmap level image" layout to transfer dstination optimal from transfer source optimal
-                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-                barrier.subresourceRange = subresource;
-                vkCmdPipelineBarrier(blitCmd,
-                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                     0,
-                                     0, nullptr,
-                                     0, nullptr,
-                                     1, &barrier);
-            }
-
-            // Lastly, change the whole image layout to shader read only optimal so that can be sampled from
-            subresource.baseMipLevel = 0;
-            subresource.levelCount = (pTextures + i)->MipMapLevelCount;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            barrier.subresourceRange = subresource;
-            vkCmdPipelineBarrier(blitCmd,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                                 0,
-                                 0, nullptr,
-                                 0, nullptr,
-                                 1, &barrier);
-            (pTextures + i)->Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-            if (m_QueueFamilyIndices.TransferHasValue)
-            {
-                p_Device->FlushCommandBuffer(blitCmd, m_Queues.Transfer);
-            }
-            else
-            {
-                p_Device->FlushCommandBuffer(blitCmd, m_Queues.Graphics);
-            }
+            GenerateMipmaps(batch, pTextures + i);
         }
         else
         {
@@ -1642,14 +2766,14 @@ void VulkanRenderer::CreateTextureArray(const std::vector<const char *> &filePat
         samplerInfo.compareEnable = VK_FALSE;
         samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = static_cast<float>((pTextures + i)->MipMapLevelCount);
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
         samplerInfo.anisotropyEnable = p_Device->m_GPUFeatures.samplerAnisotropy;
         if (p_Device->m_GPUFeatures.samplerAnisotropy != VK_TRUE)
         {
             WARNING("Device feature: sampler anisotrophy not support! Request at %s line: %d\n!", __FILE__, __LINE__);
         }
         samplerInfo.maxAnisotropy = 8.0f;
-        CHECK_VK_RESULT(vkCreateSampler(p_Device->GetDevice(), &samplerInfo, p_Allocator, &(pTextures + i)->Sampler));
+        p_Device->CreateSampler(&samplerInfo, pTextures + i);
 
         VkImageViewCreateInfo viewInfo = vkinfo::ImageViewInfo();
         viewInfo.image = (pTextures + i)->Image;
@@ -1667,7 +2791,8 @@ void VulkanRenderer::CreateTextureArray(const std::vector<const char *> &filePat
         CHECK_VK_RESULT(vkCreateImageView(p_Device->GetDevice(), &viewInfo, p_Allocator, &(pTextures + i)->View));
         (pTextures + i)->SetDescriptorImage();
     }
-    staging.Destroy();
+    // One submission for all textures, the graphics queue acquires them before later rendering
+    batch.SubmitAsync();
 }
 
 void VulkanRenderer::UpdateUniformBuffers(VulkanBuffer *pBuffers, uint32_t bufferCount, const void *data)
@@ -1716,6 +2841,8 @@ VkResult VulkanRenderer::AcquireSwapChainImage()
 {
     CHECK_VK_RESULT(vkWaitForFences(p_Device->GetDevice(), 1, &m_GraphicsInFlightFences[p_SwapChain->m_CurrentFrame], VK_TRUE, DEFAULT_FENCE_TIMEOUT));
     CHECK_VK_RESULT(vkResetFences(p_Device->GetDevice(), 1, &m_GraphicsInFlightFences[p_SwapChain->m_CurrentFrame]));
+    // Release finished asynchronous uploads
+    p_Device->CollectUploads();
 
     VkResult result = vkAcquireNextImageKHR(p_Device->GetDevice(),
                                             p_SwapChain->GetSwapChain(),
@@ -1747,6 +2874,20 @@ VkCommandBuffer VulkanRenderer::BeginFrame()
     }
 
     m_BeginFrame = true;
+    ++m_FrameIndex;
+
+    // The current frame fence is signaled, resources of this frame slot can be replaced
+    FlushDeletionQueue(p_SwapChain->m_CurrentFrame);
+    UpdateStreams();
+    UpdateMemoryBudget();
+    if (p_BindlessTextures != nullptr)
+    {
+        p_BindlessTextures->Flush(p_SwapChain->m_CurrentFrame);
+    }
+    if (p_UniformRing != nullptr)
+    {
+        p_UniformRing->Reset(p_SwapChain->m_CurrentFrame);
+    }
 
     VkCommandBuffer cmdBuffer = m_DrawCmdBuffers[p_SwapChain->m_CurrentFrame];
     VkCommandBufferBeginInfo beginInfo = vkinfo::CommandBufferBeginInfo();
@@ -1833,6 +2974,25 @@ void VulkanRenderer::RenderUI()
         ImGui::Text("Driver information %s %s", p_Device->m_GPUDriverProperties.driverName, p_Device->m_GPUDriverProperties.driverInfo);
     }
     ImGui::Text("%u FPS", m_FPS);
+    ImGui::Text("Drawn %u, culled %u", m_Frustum.GetDrawnCount(), m_Frustum.GetCulledCount());
+    ImGui::Text("Device memory objects %u, allocations %u", p_Device->GetMemoryAllocator()->GetDeviceMemoryCount(), p_Device->GetMemoryAllocator()->GetAllocationCount());
+    ImGui::Text("Sync objects created %u, reused %u", p_Device->GetSyncObjectCreateCount(), p_Device->GetSyncObjectReuseCount());
+    ImGui::Text("Samplers %u, requested %u, created %u", p_Device->GetSamplerCache()->GetSamplerCount(), p_Device->GetSamplerCache()->GetAcquireCount(), p_Device->GetSamplerCache()->GetCreateCount());
+    ImGui::Text("Device local memory %.1f%% of budget, dropped mip levels %u", p_Device->GetDeviceLocalBudgetRatio() * 100.0f, m_DroppedMipLevelCount);
+    ImGui::Text("Texture cache entries %zu, hits %u, evicted %u", m_CachedTextures.size(), m_TextureCacheHitCount, m_EvictedTextureCount);
+    if (VulkanHostAllocator::IsHostAllocator(p_Allocator))
+    {
+        const VulkanHostAllocator &hostAllocator = VulkanHostAllocator::GetInstance();
+        const VulkanHostAllocator::ScopeStatistics instance = hostAllocator.GetStatistics(HOST_ALLOCATION_SCOPE_INSTANCE);
+        const VulkanHostAllocator::ScopeStatistics device = hostAllocator.GetStatistics(HOST_ALLOCATION_SCOPE_DEVICE);
+        const VulkanHostAllocator::ScopeStatistics pipeline = hostAllocator.GetStatistics(HOST_ALLOCATION_SCOPE_PIPELINE);
+        const VulkanHostAllocator::ScopeStatistics swapChain = hostAllocator.GetStatistics(HOST_ALLOCATION_SCOPE_SWAPCHAIN);
+        ImGui::Text("Host memory KiB live/peak: instance %zu/%zu, device %zu/%zu, pipeline %zu/%zu, swap chain %zu/%zu",
+                    instance.LiveSize >> 10U, instance.PeakSize >> 10U,
+                    device.LiveSize >> 10U, device.PeakSize >> 10U,
+                    pipeline.LiveSize >> 10U, pipeline.PeakSize >> 10U,
+                    swapChain.LiveSize >> 10U, swapChain.PeakSize >> 10U);
+    }
     if (m_FrameCount == 0 && m_FrameTimes.size() != 0)
     {
         if (m_FrameTimes.front() < m_MinFrameTime)
@@ -1891,6 +3051,12 @@ void VulkanRenderer::EndRenderPass(VkCommandBuffer cmdBuffer)
 
 void VulkanRenderer::CommitAllSubmits()
 {
+    // One flush covers every uniform block pushed this frame
+    if (p_UniformRing != nullptr)
+    {
+        p_UniformRing->Flush(p_SwapChain->m_CurrentFrame);
+    }
+
     VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     VkSubmitInfo submit = vkinfo::SubmitInfo();
     submit.commandBufferCount = 1;
@@ -57,15 +57,27 @@
 #include "VulkanTools.h"
 #include "VulkanInstance.h"
 #include "VulkanDevice.h"
+#include "VulkanUploadBatch.h"
 #include "VulkanSwapChain.h"
 #include "VulkanModel.h"
+#include "VulkanGeometryArena.h"
+#include "VulkanBindlessTextures.h"
+#include "VulkanUniformRing.h"
 #include "VulkanRenderSystem.h"
 #include "VulkanCamera.h"
+#include "VulkanFrustum.h"
 #include "VulkanUI.h"
+#include "VulkanThreadPool.h"
+#include "VulkanHostAllocator.h"
+#include "VulkanKTX2.h"
+#include "VulkanMipmapGenerator.h"
 
 #include <string>
 #include <array>
 #include <chrono>
+#include <future>
+#include <functional>
+#include <unordered_map>
 
 /**
  * @brief The Vulkan base class. This contains VulkanInstance, VulkanDevice and VulkanSwapChain class.
@@ -86,6 +98,12 @@ public:
         bool EnableUI = true;
         // Show Dear ImGui Demo Window
         bool ShowDemoWindow = false;
+        // Keep a position-only vertex stream of each model for depth-only passes, costs 12 more bytes per vertex
+        bool PositionStream = false;
+        // Device local usage to budget ratio above which the least recently used tracked textures drop their top mip level
+        float MemoryBudgetThreshold = 0.9f;
+        // Largest texture extent uploaded from files, bigger images are halved on the CPU and KTX2 files skip their top levels, 0 leaves only the device limit
+        uint32_t MaxTextureResolution = 0U;
         /**
          * @brief Frames-in-flight. This controls how many frames should be processed concurrently.
          * @warning This can only be used after initialization(after calling InitVulkan function).
@@ -171,6 +189,89 @@ public:
     // (Pure Virtual)Render interface
     virtual void Render() = 0;
 
+protected:
+    // Parsed geometry of an asynchronous model load
+    struct ModelData
+    {
+        std::vector<VulkanVertex> Vertices = {};
+        std::vector<IndexType> Indices = {};
+        std::string Error = {};
+    };
+
+    // Decoded pixels of an asynchronous texture load, freed with stbi_image_free
+    struct ImageData
+    {
+        unsigned char *pPixels = nullptr;
+        uint32_t Width = 0U;
+        uint32_t Height = 0U;
+        // The pixels have the channel count of Format
+        VkFormat Format = VK_FORMAT_R8G8B8A8_SRGB;
+        // Loaded instead of pPixels for .ktx2 files
+        VulkanKTX2 Compressed{};
+        std::string Error = {};
+    };
+
+    struct ModelStream
+    {
+        std::future<ModelData> Future{};
+        uint32_t Binding = 0U;
+        VkVertexInputRate InputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        VulkanModel *pPlaceholder = nullptr;
+        VulkanModel *pModel = nullptr;
+        StreamStateFlags State = STREAM_STATE_LOADING;
+    };
+
+    struct TextureStream
+    {
+        std::future<ImageData> Future{};
+        ImageData Image{};
+        bool Decoded = false;
+        bool GenerateMipmap = true;
+        VulkanTexture *pTextures = nullptr;
+        size_t TextureCount = 0;
+        // Owner of the descriptor sets, indexed when a texture is swapped in so sets allocated or reallocated after the call are seen
+        std::vector<VkDescriptorSet> *pSets = nullptr;
+        uint32_t Binding = 0U;
+        // One texture shared by all frame slots, swapped once while the descriptor sets are rewritten slot by slot
+        bool Shared = false;
+        bool Swapped = false;
+        // Frame slots whose texture has been replaced
+        std::vector<bool> Replaced = {};
+        size_t ReplacedCount = 0;
+        StreamStateFlags State = STREAM_STATE_LOADING;
+    };
+
+    // Resources released while a frame slot may still use them
+    struct DeletionQueue
+    {
+        std::vector<VulkanBuffer> Buffers = {};
+        std::vector<VulkanTexture> Textures = {};
+        std::vector<VulkanModel *> Models = {};
+        std::vector<std::function<void()>> Deleters = {};
+    };
+
+    // Textures tracked for memory budget downgrades
+    struct ResidentTextures
+    {
+        // nullptr once the textures are evicted from the texture cache
+        VulkanTexture *pTextures = nullptr;
+        size_t TextureCount = 0;
+        // Descriptor sets of every owner, looked up when the textures are downgraded
+        std::vector<std::vector<VkDescriptorSet> *> SetLists = {};
+        uint32_t Binding = 0U;
+        uint64_t LastUsedFrame = 0U;
+    };
+
+    // Texture shared by every owner of its cache key
+    struct CachedTexture
+    {
+        std::string Key = {};
+        // nullptr once evicted, recreated by the next AcquireTexture
+        VulkanTexture *pTexture = nullptr;
+        uint32_t RefCount = 0U;
+        uint64_t LastUsedFrame = 0U;
+    };
+
 protected:
     const VkAllocationCallbacks *p_Allocator = nullptr;
     VulkanInstance *p_Instance = nullptr;
@@ -178,8 +279,30 @@ protected:
     VulkanSwapChain *p_SwapChain = nullptr;
     VulkanRenderSystem *p_RenderSystem = nullptr;
     VulkanUI *p_UI = nullptr;
+    // Worker threads for asset parsing and decoding
+    VulkanThreadPool *p_ThreadPool = nullptr;
+    // Generates texture mipmaps with compute, nullptr falls back to blitting
+    VulkanMipmapGenerator *p_MipmapGenerator = nullptr;
     bool m_IsInitialized = false;
 
+    // Asynchronous loads, indexed by the handles returned from LoadModelAsync and CreateTexturesAsync
+    std::vector<ModelStream> m_ModelStreams = {};
+    std::vector<TextureStream> m_TextureStreams = {};
+    // One deletion queue per frame in flight, flushed when the slot fence is signaled again
+    std::vector<DeletionQueue> m_DeletionQueues = {};
+    // Indexed by the handles returned from TrackTextures
+    std::vector<ResidentTextures> m_ResidentTextures = {};
+    // Frame index of the last texture downgrade
+    uint64_t m_LastDowngradeFrame = 0U;
+    // Top mip levels dropped because of the memory budget
+    uint32_t m_DroppedMipLevelCount = 0U;
+    // Indexed by the handles returned from AcquireTexture
+    std::vector<CachedTexture> m_CachedTextures = {};
+    // Cache key to texture cache handle
+    std::unordered_map<std::string, uint32_t> m_TextureCacheHandles = {};
+    uint32_t m_TextureCacheHitCount = 0U;
+    uint32_t m_EvictedTextureCount = 0U;
+
     // Delta time/Frame time
     float m_DeltaTime = 0.01f;
     // Time stamp
@@ -194,6 +317,8 @@ protected:
     float m_FrameTime = 0.0f;
     // Frame count
     uint32_t m_FrameCount = 0;
+    // Frames begun since start, never reset
+    uint64_t m_FrameIndex = 0U;
     // FPS
     uint32_t m_FPS = 0;
 
@@ -231,22 +356,182 @@ protected:
     // Sky box
     VulkanModel *p_SkyBox = nullptr;
 
+    // Shared geometry buffers, models loaded after its creation are sub-allocated into it
+    VulkanGeometryArena *p_GeometryArena = nullptr;
+
+    // Per-frame dynamic uniform ring, reset when the frame begins and flushed when it is submitted
+    VulkanUniformRing *p_UniformRing = nullptr;
+
+    // Global texture table, nullptr if not created or descriptor indexing is not supported
+    VulkanBindlessTextures *p_BindlessTextures = nullptr;
+
+    // Camera frustum for CPU culling, update it after the camera matrices
+    VulkanFrustum m_Frustum{};
+
     /**
      * @brief (Virtual) Recreate swap chain resources
      */
     virtual void WindowResize();
     /**
      * @brief (Virtual) Load model from model file.
+     * @param textureLifetime Immutable models get one color texture shared by all frames, per-frame models get one per frame slot.
      * @warning Memory leek! The memory needs to be deleted manually! (delete pModel;)
      * @note This returns a pointer that memory is allocated from heap memory, needs to be deleted manually!
      */
-    virtual VulkanModel *LoadModel(const std::string &modelPath, ModelTypeFlags modelType, uint32_t binding, VkVertexInputRate inputRate);
+    virtual VulkanModel *LoadModel(const std::string &modelPath,
+                                   ModelTypeFlags modelType,
+                                   uint32_t binding,
+                                   VkVertexInputRate inputRate,
+                                   ResourceLifetimeFlags textureLifetime = RESOURCE_LIFETIME_IMMUTABLE);
     /**
      * @brief (Virtual) Load model from buffer.
+     * @param textureLifetime Immutable models get one color texture shared by all frames, per-frame models get one per frame slot.
      * @warning Memory leek! The memory needs to be deleted manually! (delete pModel;)
      * @note This returns a pointer that memory is allocated from heap memory, needs to be deleted manually!
      */
-    virtual VulkanModel *LoadModel(const std::vector<VulkanVertex> vertex, uint32_t binding, VkVertexInputRate inputRate, const std::vector<IndexType> index = {});
+    virtual VulkanModel *LoadModel(const std::vector<VulkanVertex> vertex,
+                                   uint32_t binding,
+                                   VkVertexInputRate inputRate,
+                                   const std::vector<IndexType> index = {},
+                                   ResourceLifetimeFlags textureLifetime = RESOURCE_LIFETIME_IMMUTABLE);
+    /**
+     * @brief (Virtual) Load model from model file asynchronously.
+     * The file is parsed on the thread pool, buffers are created in UpdateStreams at a frame boundary.
+     * @param pPlaceholder The model returned by GetStreamedModel until the model is ready, can be nullptr.
+     * @return The handle of the model stream.
+     * @warning Memory leek! The streamed model needs to be deleted manually once it is ready! (delete pModel;)
+     */
+    virtual uint32_t LoadModelAsync(const std::string &modelPath,
+                                    ModelTypeFlags modelType,
+                                    uint32_t binding,
+                                    VkVertexInputRate inputRate,
+                                    VulkanModel *pPlaceholder = nullptr);
+    // Get the streamed model, or its placeholder if the model is not ready
+    VulkanModel *GetStreamedModel(uint32_t handle);
+    // Get the state of the model stream
+    StreamStateFlags GetModelStreamState(uint32_t handle);
+    /**
+     * @brief (Virtual) Create texture objects asynchronously.
+     * Textures are created with a placeholder color at once, the image is decoded and downscaled to GetTextureResolutionLimit on the thread pool,
+     * and each texture is replaced by UpdateStreams once its frame slot is no longer in use by the GPU.
+     * @param pSets The descriptor sets to be rewritten when a texture is replaced, one per texture, or one per frame slot
+     * if textureCount is 1 and the texture is shared by all frames in flight. Can be nullptr. The vector is read when the texture is swapped in,
+     * so sets may be allocated after this call, sets still VK_NULL_HANDLE by then are skipped and must be written by their owner.
+     * @param binding The binding of the texture in pSets.
+     * @param pPlaceholderColor The placeholder color, white if nullptr.
+     * @param usage Color or data, picks sRGB or UNORM, the channel count comes from the file.
+     * @return The handle of the texture stream.
+     * @note Textures are replaced one frame slot at a time if textureCount equals MaxFramesInFlight. A shared texture is swapped at once
+     * and its descriptor sets are rewritten one frame slot at a time. Otherwise all textures are replaced together after waiting for in-flight frames.
+     */
+    virtual uint32_t CreateTexturesAsync(const std::string &filePath,
+                                         VulkanTexture *pTexture,
+                                         size_t textureCount,
+                                         bool generateMipmap,
+                                         bool flipVerticallyOnLoad,
+                                         std::vector<VkDescriptorSet> *pSets = nullptr,
+                                         uint32_t binding = 0,
+                                         opm::srgb *pPlaceholderColor = nullptr,
+                                         TextureUsageFlags usage = TEXTURE_USAGE_COLOR);
+    // Get the state of the texture stream
+    StreamStateFlags GetTextureStreamState(uint32_t handle);
+    // (Virtual) Swap finished asynchronous loads in, called by BeginFrame after the current frame fence is signaled
+    virtual void UpdateStreams();
+    /**
+     * @brief Destroy the buffer once the frames in flight are done with it.
+     * @note The buffer is moved into the deletion queue and an empty buffer is left in its place.
+     */
+    void DestroyDeferred(VulkanBuffer *pBuffer);
+    /**
+     * @brief Destroy the texture once the frames in flight are done with it.
+     * @note The texture is moved into the deletion queue and an empty texture is left in its place.
+     */
+    void DestroyDeferred(VulkanTexture *pTexture);
+    // Delete the model once the frames in flight are done with it
+    void DestroyDeferred(VulkanModel *pModel);
+    // Run the deleter once the frames in flight are done, e.g. for pipelines or raw handles
+    void DestroyDeferred(std::function<void()> &&deleter);
+    // (Virtual) Destroy the resources queued on the frame slot, called by BeginFrame after the slot fence is signaled
+    virtual void FlushDeletionQueue(uint32_t frame);
+    // The frame slot whose fence covers every submitted use of a resource released now
+    uint32_t GetDeletionFrame() const;
+    /**
+     * @brief Track textures for the memory budget policy.
+     * @param pSets The descriptor sets rewritten after a downgrade, one per texture, or one per frame slot if textureCount is 1
+     * and the texture is shared by all frames in flight. Can be nullptr. The vector is read at downgrade time, VK_NULL_HANDLE sets are skipped.
+     * @return The handle for MarkTexturesUsed.
+     * @note Only 2D textures with mipmaps are downgraded, cube maps and texture arrays are skipped.
+     * Tracking the same textures again, e.g. a cached texture shared by several models, adds pSets and returns the same handle.
+     */
+    uint32_t TrackTextures(VulkanTexture *pTextures, size_t textureCount, std::vector<VkDescriptorSet> *pSets = nullptr, uint32_t binding = 0);
+    // Mark tracked textures as used by the current frame
+    void MarkTexturesUsed(uint32_t handle);
+    /**
+     * @brief Get the texture of the file from the texture cache, the file is decoded and uploaded only if it is not cached.
+     * @return The handle for GetCachedTexture and ReleaseTexture, the same file with the same parameters gets the same handle.
+     * @note Every AcquireTexture needs a ReleaseTexture. .ktx2 files are keyed by path only, as generateMipmap and flipVerticallyOnLoad are ignored for them.
+     */
+    uint32_t AcquireTexture(const std::string &filePath, bool generateMipmap, bool flipVerticallyOnLoad, TextureUsageFlags usage = TEXTURE_USAGE_COLOR);
+    // The cached texture shared by all frames in flight, valid until the last reference is released
+    VulkanTexture *GetCachedTexture(uint32_t handle);
+    // Drop one reference, unreferenced textures stay cached until the memory budget is exceeded
+    void ReleaseTexture(uint32_t handle);
+    /**
+     * @brief Destroy the cached textures nobody references once the frames in flight are done with them.
+     * @return The evicted texture count.
+     */
+    uint32_t EvictCachedTextures();
+    // (Virtual) Query heap budgets, evict unreferenced cached textures or downgrade the least recently used textures if over budget, called by BeginFrame after the current frame fence is signaled
+    virtual void UpdateMemoryBudget();
+    /**
+     * @brief Record the copy of mip levels 1 to n of the source texture into a new texture one level smaller.
+     * @note The sampler moves to the new texture, the source texture must not be in use when the commands are executed.
+     */
+    void DropTopMipLevel(VkCommandBuffer cmdBuffer, VulkanTexture *pSrc, VulkanTexture *pDst);
+    // Read the extent of image layers from their headers, the extents must be the same, halved until it fits GetTextureResolutionLimit
+    void GetImageLayerExtent(const char *const *pFilePathes, size_t layerCount, uint32_t &width, uint32_t &height);
+    // The smaller of Settings::MaxTextureResolution and the device image extent limit
+    uint32_t GetTextureResolutionLimit() const;
+    /**
+     * @brief Halve 8 bit pixels with a 2x2 box filter until both sides fit GetTextureResolutionLimit.
+     * @param pPixels Allocated by stb_image, replaced by a new stb_image allocation if downscaled.
+     * @param parallel Split rows across the thread pool, pass false on pool workers to avoid waiting on the pool from inside it.
+     * @note The filter works on stored values, sRGB images are averaged in gamma space like a blit to a smaller level.
+     */
+    void DownscalePixels(unsigned char *&pPixels, uint32_t &width, uint32_t &height, uint32_t channelCount, bool parallel);
+    /**
+     * @brief Decode image layers of the same extent in parallel on the thread pool, each into its offset of pDst.
+     * @param pDst At least layerCount * width * height * 4 bytes, usually a mapped staging region.
+     * @param width The extent from GetImageLayerExtent, larger layers are downscaled to it.
+     * @note Layers are decoded to RGBA8, layer i starts at i * width * height * 4.
+     */
+    void DecodeImageLayers(const char *const *pFilePathes,
+                           size_t layerCount,
+                           bool flipVerticallyOnLoad,
+                           uint32_t width,
+                           uint32_t height,
+                           void *pDst);
+    /**
+     * @brief (Virtual) Create the shared geometry arena.
+     * @param maxVertexCount The vertex capacity of the shared vertex buffer.
+     * @param maxIndexCount The index capacity of the shared index buffer.
+     * @param maxDrawCount The maximum number of indirect draws in one frame.
+     * @note Models loaded after this call are copied into the arena instead of owning their vertex and index buffers.
+     */
+    virtual void CreateGeometryArena(uint32_t maxVertexCount, uint32_t maxIndexCount, uint32_t maxDrawCount);
+    /**
+     * @brief (Virtual) Create the per-frame dynamic uniform ring.
+     * @param frameSize The ring capacity of each frame.
+     * @param range The largest uniform block pushed to the ring.
+     */
+    virtual void CreateUniformRing(VkDeviceSize frameSize, VkDeviceSize range);
+    /**
+     * @brief (Virtual) Create the global bindless texture table.
+     * @param maxTextureCount The array size of the texture table.
+     * @note p_BindlessTextures stays nullptr if descriptor indexing is not supported, keep per-model texture sets as the fallback.
+     * Textures replaced by streams, memory budget downgrades or cache evictions are refreshed or removed automatically.
+     */
+    virtual void CreateBindlessTextures(uint32_t maxTextureCount);
     /**
      * @brief (Virtual) Create vertex buffers.
      * @param pModels The address of the model for buffer creation.
@@ -263,6 +548,19 @@ protected:
      * @note This will map and bind buffer memory, while do not copy data to memory.
      */
     virtual void CreateUniformBuffers(VkDeviceSize bufferSize, VulkanBuffer *pBuffers, size_t bufferCount);
+    /**
+     * @brief (Virtual) Create per-frame instance buffers of the model.
+     * @param binding The vertex input binding of the instance buffers.
+     * @param maxInstanceCount The maximum instance count.
+     * @note Instance transforms are read at VulkanModel::INSTANCE_LOCATION, use VulkanModel::GetInstanceBindingDescription and VulkanModel::GetInstanceAttributeDescription for the pipeline.
+     */
+    virtual void CreateInstanceBuffers(VulkanModel *pModel, uint32_t binding, uint32_t maxInstanceCount);
+    /**
+     * @brief (Virtual) Generate the mipmaps of a texture whose level 0 was just copied in the batch.
+     * @note Level 0 must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, all levels end up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+     * Compute generation is used if the format supports it, otherwise the levels are blitted one by one.
+     */
+    virtual void GenerateMipmaps(VulkanUploadBatch &batch, VulkanTexture *pTexture);
     /**
      * @brief (Virtual) Load sky box textures.
      * @param pTexture The address of the sky box texture object.
@@ -301,12 +599,54 @@ protected:
      * @brief (Virtual) Create texture object.
      * @param pTexture The address of the texture.
      * @param textureCount The texture count.
+     * @param usage Color or data, picks sRGB or UNORM. Grey and grey-alpha files get R8 and R8G8 images, see GetTextureFormat.
+     * @note .ktx2 files are uploaded as stored, generateMipmap, flipVerticallyOnLoad and usage are ignored for them.
+     * Images above GetTextureResolutionLimit are downscaled before upload.
      */
     virtual void CreateTextures(const std::string &filePath,
                                 VulkanTexture *pTexture,
                                 size_t textureCount,
                                 bool generateMipmap,
-                                bool flipVerticallyOnLoad);
+                                bool flipVerticallyOnLoad,
+                                TextureUsageFlags usage = TEXTURE_USAGE_COLOR);
+    /**
+     * @brief (Virtual) Create R8G8 UNORM texture objects from two single channel files of the same extent, e.g. metallic and roughness maps.
+     * @param redFilePath The file stored in the red channel.
+     * @param greenFilePath The file stored in the green channel.
+     */
+    virtual void CreatePackedTextures(const std::string &redFilePath,
+                                      const std::string &greenFilePath,
+                                      VulkanTexture *pTexture,
+                                      size_t textureCount,
+                                      bool generateMipmap,
+                                      bool flipVerticallyOnLoad);
+    /**
+     * @brief (Virtual) Create texture objects from 8 bit pixels.
+     * @param pixels The pixel data with the channel count of format.
+     * @param pTexture The address of the texture.
+     * @param textureCount The texture count.
+     * @param format An R8, R8G8 or R8G8B8A8 format. Single and dual channel sRGB textures are sampled as grey and grey-alpha.
+     */
+    virtual void CreateTexturesFromPixels(const void *pixels,
+                                          uint32_t width,
+                                          uint32_t height,
+                                          VulkanTexture *pTexture,
+                                          size_t textureCount,
+                                          bool generateMipmap,
+                                          VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
+    /**
+     * @brief The smallest 8 bit format holding the channels that can be sampled, filtered and blitted for mipmaps.
+     * @note Three channels are padded to four, formats without the required features fall back to R8G8B8A8.
+     */
+    VkFormat GetTextureFormat(uint32_t channelCount, TextureUsageFlags usage) const;
+    /**
+     * @brief (Virtual) Create texture objects from a KTX2 image, the mip chain comes from the file.
+     * @note Cube map files create cube compatible images with 6 layers per face set, the format must be sampleable on the device.
+     * Levels above GetTextureResolutionLimit are skipped as long as smaller levels are stored.
+     */
+    virtual void CreateTexturesFromKTX2(const VulkanKTX2 &image,
+                                        VulkanTexture *pTexture,
+                                        size_t textureCount);
     /**
      * @brief (Virtual) Create texture array with same extent.
      * @param pTexture The address of the texture.
@@ -0,0 +1,138 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanSamplerCache.h"
+#include "VulkanTools.h"
+
+#include <functional>
+
+VulkanSamplerCache::SamplerKey::SamplerKey(const VkSamplerCreateInfo &samplerCI)
+    : Flags(samplerCI.flags),
+      MagFilter(samplerCI.magFilter),
+      MinFilter(samplerCI.minFilter),
+      MipmapMode(samplerCI.mipmapMode),
+      AddressModeU(samplerCI.addressModeU),
+      AddressModeV(samplerCI.addressModeV),
+      AddressModeW(samplerCI.addressModeW),
+      MipLodBias(samplerCI.mipLodBias),
+      AnisotropyEnable(samplerCI.anisotropyEnable),
+      // Ignored by the driver if anisotropy is disabled, so it must not split the cache either
+      MaxAnisotropy(samplerCI.anisotropyEnable == VK_TRUE ? samplerCI.maxAnisotropy : 1.0f),
+      CompareEnable(samplerCI.compareEnable),
+      CompareOp(samplerCI.compareEnable == VK_TRUE ? samplerCI.compareOp : VK_COMPARE_OP_NEVER),
+      MinLod(samplerCI.minLod),
+      MaxLod(samplerCI.maxLod),
+      BorderColor(samplerCI.borderColor),
+      UnnormalizedCoordinates(samplerCI.unnormalizedCoordinates)
+{
+}
+
+bool VulkanSamplerCache::SamplerKey::operator==(const SamplerKey &other) const
+{
+    return Flags == other.Flags && MagFilter == other.MagFilter && MinFilter == other.MinFilter && MipmapMode == other.MipmapMode &&
+           AddressModeU == other.AddressModeU && AddressModeV == other.AddressModeV && AddressModeW == other.AddressModeW &&
+           MipLodBias == other.MipLodBias && AnisotropyEnable == other.AnisotropyEnable && MaxAnisotropy == other.MaxAnisotropy &&
+           CompareEnable == other.CompareEnable && CompareOp == other.CompareOp && MinLod == other.MinLod && MaxLod == other.MaxLod &&
+           BorderColor == other.BorderColor && UnnormalizedCoordinates == other.UnnormalizedCoordinates;
+}
+
+size_t VulkanSamplerCache::SamplerKeyHash::operator()(const SamplerKey &key) const
+{
+    size_t seed = 0;
+    auto combine = [&seed](size_t value) -> void
+    {
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+    combine(std::hash<uint32_t>{}(key.Flags));
+    combine(std::hash<uint32_t>{}((key.MagFilter << 16) | (key.MinFilter << 8) | key.MipmapMode));
+    combine(std::hash<uint32_t>{}((key.AddressModeU << 16) | (key.AddressModeV << 8) | key.AddressModeW));
+    combine(std::hash<float>{}(key.MipLodBias));
+    combine(std::hash<uint32_t>{}((key.AnisotropyEnable << 1) | key.CompareEnable));
+    combine(std::hash<float>{}(key.MaxAnisotropy));
+    combine(std::hash<uint32_t>{}(key.CompareOp));
+    combine(std::hash<float>{}(key.MinLod));
+    combine(std::hash<float>{}(key.MaxLod));
+    combine(std::hash<uint32_t>{}((key.BorderColor << 1) | key.UnnormalizedCoordinates));
+    return seed;
+}
+
+VulkanSamplerCache::VulkanSamplerCache(VkDevice device, const VkAllocationCallbacks *pAllocator)
+    : m_Device(device), p_Allocator(pAllocator)
+{
+    if (m_Device == VK_NULL_HANDLE)
+    {
+        FATAL("No valid device for sampler cache!");
+    }
+}
+
+VulkanSamplerCache::~VulkanSamplerCache()
+{
+    if (!m_Keys.empty())
+    {
+        WARNING("%zu cached samplers are still referenced when the sampler cache is destroyed!\n", m_Keys.size());
+    }
+    for (auto &sampler : m_Samplers)
+    {
+        vkDestroySampler(m_Device, sampler.second.Sampler, p_Allocator);
+    }
+}
+
+VkSampler VulkanSamplerCache::Acquire(const VkSamplerCreateInfo &samplerCI)
+{
+    if (samplerCI.pNext != nullptr)
+    {
+        FATAL("Sampler create infos with a pNext chain can not be cached!");
+    }
+
+    SamplerKey key{samplerCI};
+    std::lock_guard<std::mutex> lock{m_Mutex};
+    ++m_AcquireCount;
+    auto it = m_Samplers.find(key);
+    if (it == m_Samplers.end())
+    {
+        SamplerEntry entry{};
+        CHECK_VK_RESULT(vkCreateSampler(m_Device, &samplerCI, p_Allocator, &entry.Sampler));
+        it = m_Samplers.emplace(key, entry).first;
+        m_Keys.emplace(entry.Sampler, key);
+        ++m_CreateCount;
+    }
+    ++it->second.RefCount;
+
+    return it->second.Sampler;
+}
+
+void VulkanSamplerCache::Release(VkSampler sampler)
+{
+    std::lock_guard<std::mutex> lock{m_Mutex};
+    auto keyIt = m_Keys.find(sampler);
+    if (keyIt == m_Keys.end())
+    {
+        FATAL("Sampler %p is not owned by the sampler cache!", sampler);
+    }
+
+    auto it = m_Samplers.find(keyIt->second);
+    if (--it->second.RefCount == 0)
+    {
+        // Textures release their sampler in VulkanTexture::Destroy, after the GPU is done with them
+        vkDestroySampler(m_Device, sampler, p_Allocator);
+        m_Samplers.erase(it);
+        m_Keys.erase(keyIt);
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_SAMPLER_CACHE_HEADER
+#define VULKAN_SAMPLER_CACHE_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "vulkan/vulkan.h"
+
+#include <cstddef>
+#include <unordered_map>
+#include <mutex>
+
+/**
+ * @brief Reference counted samplers shared by every texture with the same sampler state.
+ * @note Only create infos without a pNext chain are cached, the sampler is destroyed when its last reference is released.
+ */
+class DVAPI_ATTR VulkanSamplerCache final
+{
+private:
+    // The VkSamplerCreateInfo members without sType and pNext
+    struct SamplerKey
+    {
+        VkSamplerCreateFlags Flags = 0U;
+        VkFilter MagFilter = VK_FILTER_NEAREST;
+        VkFilter MinFilter = VK_FILTER_NEAREST;
+        VkSamplerMipmapMode MipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        VkSamplerAddressMode AddressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        VkSamplerAddressMode AddressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        VkSamplerAddressMode AddressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        float MipLodBias = 0.0f;
+        VkBool32 AnisotropyEnable = VK_FALSE;
+        float MaxAnisotropy = 1.0f;
+        VkBool32 CompareEnable = VK_FALSE;
+        VkCompareOp CompareOp = VK_COMPARE_OP_NEVER;
+        float MinLod = 0.0f;
+        float MaxLod = 0.0f;
+        VkBorderColor BorderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+        VkBool32 UnnormalizedCoordinates = VK_FALSE;
+
+        explicit SamplerKey(const VkSamplerCreateInfo &samplerCI);
+        bool operator==(const SamplerKey &other) const;
+    };
+
+    struct SamplerKeyHash
+    {
+        size_t operator()(const SamplerKey &key) const;
+    };
+
+    struct SamplerEntry
+    {
+        VkSampler Sampler = VK_NULL_HANDLE;
+        uint32_t RefCount = 0U;
+    };
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks *p_Allocator = nullptr;
+    std::unordered_map<SamplerKey, SamplerEntry, SamplerKeyHash> m_Samplers = {};
+    // Sampler to its key, for Release
+    std::unordered_map<VkSampler, SamplerKey> m_Keys = {};
+    std::mutex m_Mutex;
+    // Statistics
+    uint32_t m_AcquireCount = 0U;
+    uint32_t m_CreateCount = 0U;
+
+public:
+    explicit VulkanSamplerCache(VkDevice device, const VkAllocationCallbacks *pAllocator = nullptr);
+    ~VulkanSamplerCache();
+    VulkanSamplerCache(const VulkanSamplerCache &) = delete;
+    VulkanSamplerCache &operator=(const VulkanSamplerCache &) = delete;
+    VulkanSamplerCache(VulkanSamplerCache &&) = delete;
+    VulkanSamplerCache &operator=(VulkanSamplerCache &&) = delete;
+
+    // Get the sampler of the state, created on the first request, samplerCI.pNext must be nullptr
+    VkSampler Acquire(const VkSamplerCreateInfo &samplerCI);
+    // Drop one reference of a sampler returned by Acquire
+    void Release(VkSampler sampler);
+
+    // Live samplers
+    inline uint32_t GetSamplerCount() const { return static_cast<uint32_t>(m_Keys.size()); }
+    // Samplers requested since creation
+    inline uint32_t GetAcquireCount() const { return m_AcquireCount; }
+    // Samplers created since creation, the other requests were served from the cache
+    inline uint32_t GetCreateCount() const { return m_CreateCount; }
+};
+
+#endif
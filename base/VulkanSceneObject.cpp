@@ -199,21 +199,14 @@ VulkanScene &VulkanScene::AddPointLight(const opm::vec4 &positionAndRadius,
 
 void VulkanScene::BuildPointLightBuffer()
 {
-    VulkanBuffer staging{};
-    p_Device->CreateBuffer(PointLights.size() * sizeof(PointLight),
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           PointLights.data());
     for (size_t i = 0; i < PointLightsBuffer.size(); ++i)
     {
         p_Device->CreateBuffer(PointLights.size() * sizeof(PointLight),
                                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                &PointLightsBuffer[i]);
-        p_Device->CopyBuffer(&staging, &PointLightsBuffer[i]);
     }
-    staging.Destroy();
+    p_Device->UploadBuffer(PointLights.data(), PointLights.size() * sizeof(PointLight), PointLightsBuffer.data(), PointLightsBuffer.size());
 }
 
 VulkanScene &VulkanScene::AddDirectLight(const opm::vec3 &dir,
@@ -234,21 +227,14 @@ VulkanScene &VulkanScene::AddDirectLight(const opm::vec3 &dir,
 
 void VulkanScene::BuildDirectLightBuffer()
 {
-    VulkanBuffer staging{};
-    p_Device->CreateBuffer(DirectLights.size() * sizeof(DirectLight),
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           DirectLights.data());
     for (size_t i = 0; i < DirectLightsBuffer.size(); ++i)
     {
         p_Device->CreateBuffer(DirectLights.size() * sizeof(DirectLight),
                                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                &DirectLightsBuffer[i]);
-        p_Device->CopyBuffer(&staging, &DirectLightsBuffer[i]);
     }
-    staging.Destroy();
+    p_Device->UploadBuffer(DirectLights.data(), DirectLights.size() * sizeof(DirectLight), DirectLightsBuffer.data(), DirectLightsBuffer.size());
 }
 
 VulkanScene &VulkanScene::AddSphere(const opm::vec4 &centerAndRadius,
@@ -269,21 +255,14 @@ VulkanScene &VulkanScene::AddSphere(const opm::vec4 &centerAndRadius,
 
 void VulkanScene::BuildSphereBuffer()
 {
-    VulkanBuffer staging{};
-    p_Device->CreateBuffer(Spheres.size() * sizeof(Sphere),
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           Spheres.data());
     for (size_t i = 0; i < SpheresBuffer.size(); ++i)
     {
         p_Device->CreateBuffer(Spheres.size() * sizeof(Sphere),
                                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                &SpheresBuffer[i]);
-        p_Device->CopyBuffer(&staging, &SpheresBuffer[i]);
     }
-    staging.Destroy();
+    p_Device->UploadBuffer(Spheres.data(), Spheres.size() * sizeof(Sphere), SpheresBuffer.data(), SpheresBuffer.size());
 }
 
 VulkanScene &VulkanScene::AddPlane(const opm::vec3 &normal,
@@ -304,21 +283,14 @@ VulkanScene &VulkanScene::AddPlane(const opm::vec3 &normal,
 
 void VulkanScene::BuildPlaneBuffer()
 {
-    VulkanBuffer staging{};
-    p_Device->CreateBuffer(Planes.size() * sizeof(Plane),
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           Planes.data());
     for (size_t i = 0; i < PlanesBuffer.size(); ++i)
     {
         p_Device->CreateBuffer(Planes.size() * sizeof(Plane),
                                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                &PlanesBuffer[i]);
-        p_Device->CopyBuffer(&staging, &PlanesBuffer[i]);
     }
-    staging.Destroy();
+    p_Device->UploadBuffer(Planes.data(), Planes.size() * sizeof(Plane), PlanesBuffer.data(), PlanesBuffer.size());
 }
 
 VulkanScene &VulkanScene::AddBox(const opm::vec3 &position,
@@ -339,21 +311,14 @@ VulkanScene &VulkanScene::AddBox(const opm::vec3 &position,
 
 void VulkanScene::BuildBoxBuffer()
 {
-    VulkanBuffer staging{};
-    p_Device->CreateBuffer(Boxes.size() * sizeof(Box),
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           Boxes.data());
     for (size_t i = 0; i < BoxesBuffer.size(); ++i)
     {
         p_Device->CreateBuffer(Boxes.size() * sizeof(Box),
                                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                &BoxesBuffer[i]);
-        p_Device->CopyBuffer(&staging, &BoxesBuffer[i]);
     }
-    staging.Destroy();
+    p_Device->UploadBuffer(Boxes.data(), Boxes.size() * sizeof(Box), BoxesBuffer.data(), BoxesBuffer.size());
 }
 
 VulkanScene &VulkanScene::AddTorus(const opm::vec3 &position,
@@ -374,21 +339,14 @@ VulkanScene &VulkanScene::AddTorus(const opm::vec3 &position,
 
 void VulkanScene::BuildTorusBuffer()
 {
-    VulkanBuffer staging{};
-    p_Device->CreateBuffer(Toruses.size() * sizeof(Torus),
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           Toruses.data());
     for (size_t i = 0; i < TorusesBuffer.size(); ++i)
     {
         p_Device->CreateBuffer(Toruses.size() * sizeof(Torus),
                                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                &TorusesBuffer[i]);
-        p_Device->CopyBuffer(&staging, &TorusesBuffer[i]);
     }
-    staging.Destroy();
+    p_Device->UploadBuffer(Toruses.data(), Toruses.size() * sizeof(Torus), TorusesBuffer.data(), TorusesBuffer.size());
 }
 
 VulkanScene &VulkanScene::AddRing(const opm::vec3 &position,
@@ -409,21 +367,14 @@ VulkanScene &VulkanScene::AddRing(const opm::vec3 &position,
 
 void VulkanScene::BuildRingBuffer()
 {
-    VulkanBuffer staging{};
-    p_Device->CreateBuffer(Rings.size() * sizeof(Ring),
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           Rings.data());
     for (size_t i = 0; i < RingsBuffer.size(); ++i)
     {
         p_Device->CreateBuffer(Rings.size() * sizeof(Ring),
                                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                &RingsBuffer[i]);
-        p_Device->CopyBuffer(&staging, &RingsBuffer[i]);
     }
-    staging.Destroy();
+    p_Device->UploadBuffer(Rings.data(), Rings.size() * sizeof(Ring), RingsBuffer.data(), RingsBuffer.size());
 }
 
 VulkanScene &VulkanScene::AddSurface(Surface &s, const opm::quat &rotate)
@@ -438,21 +389,14 @@ VulkanScene &VulkanScene::AddSurface(Surface &s, const opm::quat &rotate)
 
 void VulkanScene::BuildSurfaceBuffer()
 {
-    VulkanBuffer staging{};
-    p_Device->CreateBuffer(Surfaces.size() * sizeof(Surface),
-                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &staging,
-                           Surfaces.data());
     for (size_t i = 0; i < SurfacesBuffer.size(); ++i)
     {
         p_Device->CreateBuffer(Surfaces.size() * sizeof(Surface),
                                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                &SurfacesBuffer[i]);
-        p_Device->CopyBuffer(&staging, &SurfacesBuffer[i]);
     }
-    staging.Destroy();
+    p_Device->UploadBuffer(Surfaces.data(), Surfaces.size() * sizeof(Surface), SurfacesBuffer.data(), SurfacesBuffer.size());
 }
 
 Material VulkanScene::CreateMaterial(const opm::vec3 &color,
@@ -204,31 +204,31 @@ public:
 
     std::vector<Sphere> Spheres;
     std::vector<VulkanBuffer> SpheresBuffer;  // Frames in flight
-    std::vector<VulkanTexture> SphereColors;  // Frames in flight
-    std::vector<VulkanTexture> SphereNormals; // Frames in flight
+    std::vector<VulkanTexture> SphereColors;  // Shared by all frames in flight
+    std::vector<VulkanTexture> SphereNormals; // Shared by all frames in flight
 
     std::vector<Plane> Planes;
     std::vector<VulkanBuffer> PlanesBuffer; // Frames in flight
 
     std::vector<Box> Boxes;
     std::vector<VulkanBuffer> BoxesBuffer;   // Frames in flight
-    std::vector<VulkanTexture> BoxesColors;  // Frames in flight
-    std::vector<VulkanTexture> BoxesNormals; // Frames in flight
+    std::vector<VulkanTexture> BoxesColors;  // Shared by all frames in flight
+    std::vector<VulkanTexture> BoxesNormals; // Shared by all frames in flight
 
     std::vector<Torus> Toruses;
     std::vector<VulkanBuffer> TorusesBuffer; // Frames in flight
-    std::vector<VulkanTexture> TorusColors;  // Frames in flight
-    std::vector<VulkanTexture> TorusNormals; // Frames in flight
+    std::vector<VulkanTexture> TorusColors;  // Shared by all frames in flight
+    std::vector<VulkanTexture> TorusNormals; // Shared by all frames in flight
 
     std::vector<Ring> Rings;
     std::vector<VulkanBuffer> RingsBuffer;  // Frames in flight
-    std::vector<VulkanTexture> RingColors;  // Frames in flight
-    std::vector<VulkanTexture> RingNormals; // Frames in flight
+    std::vector<VulkanTexture> RingColors;  // Shared by all frames in flight
+    std::vector<VulkanTexture> RingNormals; // Shared by all frames in flight
 
     std::vector<Surface> Surfaces;
     std::vector<VulkanBuffer> SurfacesBuffer;  // Frames in flight
-    std::vector<VulkanTexture> SurfaceColors;  // Frames in flight
-    std::vector<VulkanTexture> SurfaceNormals; // Frames in flight
+    std::vector<VulkanTexture> SurfaceColors;  // Shared by all frames in flight
+    std::vector<VulkanTexture> SurfaceNormals; // Shared by all frames in flight
 
 public:
     VulkanScene();
@@ -240,6 +240,7 @@ public:
 
     void Connect(VulkanDevice *pDevice);
     void ResizeAllBuffers(size_t size);
+    // Textures are sampled only, so size is the texture count rather than the frames in flight
     void ResizeAllTextures(size_t size);
     void DestroyAllBuffers();
     void DestroyAllTextures();
@@ -0,0 +1,164 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanStagingRing.h"
+#include "VulkanDevice.h"
+#include "VulkanTools.h"
+
+#include <algorithm>
+
+VulkanStagingRing::VulkanStagingRing(VulkanDevice *pDevice, VkDeviceSize capacity, VkDeviceSize minAlignment, const VkAllocationCallbacks *pAllocator)
+    : m_Buffer{pAllocator}
+{
+    if (pDevice == nullptr || pDevice->GetDevice() == VK_NULL_HANDLE)
+    {
+        FATAL("Staging ring must be created with a valid device!");
+    }
+    if (capacity == 0)
+    {
+        FATAL("Staging ring capacity must not be 0!");
+    }
+
+    p_Device = pDevice;
+    p_Allocator = pAllocator;
+    m_MinAlignment = std::max<VkDeviceSize>(minAlignment, 16U);
+    CreateRingBuffer(capacity);
+}
+
+VulkanStagingRing::~VulkanStagingRing()
+{
+    while (!m_Submissions.empty())
+    {
+        WaitOldest();
+    }
+    m_Buffer.Unmap();
+    m_Buffer.Destroy();
+}
+
+void VulkanStagingRing::CreateRingBuffer(VkDeviceSize capacity)
+{
+    p_Device->CreateBuffer(capacity,
+                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           &m_Buffer);
+    m_Buffer.Map();
+    m_Capacity = capacity;
+    m_Head = 0U;
+    m_Tail = 0U;
+    m_SubmittedHead = 0U;
+}
+
+void VulkanStagingRing::WaitOldest()
+{
+    Submission &submission = m_Submissions.front();
+    CHECK_VK_RESULT(vkWaitForFences(p_Device->GetDevice(), 1, &submission.Fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
+    m_Tail = submission.End;
+    p_Device->ReleaseFence(submission.Fence);
+    m_Submissions.pop_front();
+}
+
+void VulkanStagingRing::Reclaim()
+{
+    while (!m_Submissions.empty() && vkGetFenceStatus(p_Device->GetDevice(), m_Submissions.front().Fence) == VK_SUCCESS)
+    {
+        m_Tail = m_Submissions.front().End;
+        p_Device->ReleaseFence(m_Submissions.front().Fence);
+        m_Submissions.pop_front();
+    }
+    // Restart from the ring start when idle to keep large regions contiguous
+    if (m_Submissions.empty() && m_Head == m_SubmittedHead)
+    {
+        m_Head = m_Tail = m_SubmittedHead = 0U;
+    }
+}
+
+VulkanStagingRing::Region VulkanStagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    if (size == 0)
+    {
+        FATAL("Can not allocate an empty staging region!");
+    }
+    alignment = std::max(alignment, m_MinAlignment);
+
+    Reclaim();
+    if (size > m_Capacity)
+    {
+        if (m_Head != m_SubmittedHead)
+        {
+            FATAL("Staging ring can not grow to %llu bytes with unsubmitted regions!", static_cast<unsigned long long>(size));
+        }
+        while (!m_Submissions.empty())
+        {
+            WaitOldest();
+        }
+        VkDeviceSize capacity = m_Capacity;
+        while (capacity < size)
+        {
+            capacity *= 2;
+        }
+        INFO("Staging ring grows from %llu to %llu bytes.\n", static_cast<unsigned long long>(m_Capacity), static_cast<unsigned long long>(capacity));
+        m_Buffer.Unmap();
+        m_Buffer.Destroy();
+        CreateRingBuffer(capacity);
+    }
+
+    for (;;)
+    {
+        VkDeviceSize position = m_Head % m_Capacity;
+        VkDeviceSize padding = (alignment - position % alignment) % alignment;
+        // Regions never wrap, skip the ring end if the region does not fit before it
+        if (position + padding + size > m_Capacity)
+        {
+            padding = m_Capacity - position;
+        }
+        if (m_Head + padding + size - m_Tail <= m_Capacity)
+        {
+            m_Head += padding;
+            break;
+        }
+        if (m_Submissions.empty())
+        {
+            FATAL("Staging ring is full of unsubmitted regions!");
+        }
+        WaitOldest();
+    }
+
+    Region region{};
+    region.Buffer = m_Buffer.Buffer;
+    region.Offset = m_Head % m_Capacity;
+    region.Size = size;
+    region.Mapped = static_cast<char *>(m_Buffer.Mapped) + region.Offset;
+    m_Head += size;
+    return region;
+}
+
+void VulkanStagingRing::Submit(VkQueue queue)
+{
+    if (m_Head == m_SubmittedHead)
+    {
+        return;
+    }
+
+    VkFence fence = p_Device->AcquireFence();
+    // An empty submission signals the fence once all prior work on the queue is done
+    CHECK_VK_RESULT(vkQueueSubmit(queue, 0, nullptr, fence));
+    m_Submissions.push_back({fence, m_Head});
+    m_SubmittedHead = m_Head;
+}
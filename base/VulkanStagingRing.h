@@ -0,0 +1,108 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_STAGING_RING_HEADER
+#define VULKAN_STAGING_RING_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "VulkanBuffer.h"
+
+#include <deque>
+
+class VulkanDevice;
+
+/**
+ * @brief Persistently mapped staging ring shared by all uploads.
+ * Regions are handed out in FIFO order and recycled once the fence of the submission that read them is signaled.
+ * Fences come from the device fence pool.
+ * @note Not thread safe, uploads are recorded on the main thread.
+ */
+class DVAPI_ATTR VulkanStagingRing final
+{
+public:
+    // A staging range, copy from Buffer at Offset
+    struct Region
+    {
+        VkBuffer Buffer = VK_NULL_HANDLE;
+        VkDeviceSize Offset = 0U;
+        VkDeviceSize Size = 0U;
+        void *Mapped = nullptr;
+    };
+
+private:
+    // Regions ending at End are free once Fence is signaled
+    struct Submission
+    {
+        VkFence Fence = VK_NULL_HANDLE;
+        VkDeviceSize End = 0U;
+    };
+
+    VulkanDevice *p_Device = nullptr;
+    const VkAllocationCallbacks *p_Allocator = nullptr;
+    VkDeviceSize m_Capacity = 0U;
+    VkDeviceSize m_MinAlignment = 16U;
+    // Monotonic byte counters, the ring position is counter % capacity
+    VkDeviceSize m_Head = 0U;
+    VkDeviceSize m_Tail = 0U;
+    // End of the regions already attached to a fence
+    VkDeviceSize m_SubmittedHead = 0U;
+    std::deque<Submission> m_Submissions = {};
+
+    void CreateRingBuffer(VkDeviceSize capacity);
+    // Block until the oldest submission is done and recycle its regions
+    void WaitOldest();
+
+public:
+    VulkanBuffer m_Buffer{};
+
+public:
+    /**
+     * @param capacity The initial ring size, it grows to fit larger uploads.
+     * @param minAlignment Offset alignment of every region, e.g. optimalBufferCopyOffsetAlignment.
+     */
+    explicit VulkanStagingRing(VulkanDevice *pDevice, VkDeviceSize capacity, VkDeviceSize minAlignment, const VkAllocationCallbacks *pAllocator = nullptr);
+    ~VulkanStagingRing();
+    VulkanStagingRing(const VulkanStagingRing &) = delete;
+    VulkanStagingRing &operator=(const VulkanStagingRing &) = delete;
+    VulkanStagingRing(VulkanStagingRing &&) = delete;
+    VulkanStagingRing &operator=(VulkanStagingRing &&) = delete;
+
+    /**
+     * @brief Reserve a region, waiting for in-flight uploads if the ring is full.
+     * @note The ring is recreated with a larger size if the request does not fit at all, which requires no unsubmitted regions.
+     */
+    Region Allocate(VkDeviceSize size, VkDeviceSize alignment = 0U);
+    /**
+     * @brief Attach the regions allocated since the last call to a fence signaled on the queue.
+     * @note Call it after the submissions reading those regions, they are recycled once all prior work on the queue is done.
+     */
+    void Submit(VkQueue queue);
+    // Recycle regions of finished submissions without blocking
+    void Reclaim();
+
+    inline VkDeviceSize GetCapacity() const { return m_Capacity; }
+    inline VkDeviceSize GetUsedSize() const { return m_Head - m_Tail; }
+    // Bytes allocated since the last Submit
+    inline VkDeviceSize GetPendingSize() const { return m_Head - m_SubmittedHead; }
+};
+
+#endif
@@ -430,18 +430,10 @@ void VulkanSwapChain::CreateDepthStencilImageBuffer()
     imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
     imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageCI.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    if (m_UniqueQueueFamilyIndexCount > 1)
-    {
-        imageCI.queueFamilyIndexCount = m_UniqueQueueFamilyIndexCount;
-        imageCI.pQueueFamilyIndices = p_UniqueQueueFamilyIndices;
-        imageCI.sharingMode = VK_SHARING_MODE_CONCURRENT;
-    }
-    else
-    {
-        imageCI.queueFamilyIndexCount = 0;
-        imageCI.pQueueFamilyIndices = nullptr;
-        imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    }
+    // Only the graphics queue touches the depth attachment
+    imageCI.queueFamilyIndexCount = 0;
+    imageCI.pQueueFamilyIndices = nullptr;
+    imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
     VkImageViewCreateInfo viewCI = vkinfo::ImageViewInfo();
     viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
@@ -39,20 +39,33 @@ void VulkanTexture::Destroy()
         FATAL("No valid device for texture operation!");
     }
 
-    if (Sampler != VK_NULL_HANDLE)
+    if (SamplerCache != nullptr && Sampler != VK_NULL_HANDLE)
+    {
+        SamplerCache->Release(Sampler);
+    }
+    else if (Sampler != VK_NULL_HANDLE)
     {
         vkDestroySampler(Device, Sampler, Allocator);
     }
+    Sampler = VK_NULL_HANDLE;
+    SamplerCache = nullptr;
     if (View != VK_NULL_HANDLE)
     {
         vkDestroyImageView(Device, View, Allocator);
-    }
-    if (Memory != VK_NULL_HANDLE)
-    {
-        vkFreeMemory(Device, Memory, Allocator);
+        View = VK_NULL_HANDLE;
     }
     if (Image != VK_NULL_HANDLE)
     {
         vkDestroyImage(Device, Image, Allocator);
+        Image = VK_NULL_HANDLE;
+    }
+    if (MemoryAllocator != nullptr)
+    {
+        MemoryAllocator->Free(&Allocation);
+    }
+    else if (Memory != VK_NULL_HANDLE)
+    {
+        vkFreeMemory(Device, Memory, Allocator);
     }
+    Memory = VK_NULL_HANDLE;
 }
@@ -25,6 +25,8 @@
 
 #include "VulkanCore.h"
 #include "vulkan/vulkan.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanSamplerCache.h"
 
 class DVAPI_ATTR VulkanTexture final
 {
@@ -37,11 +39,19 @@ public:
     uint32_t Height = 0U;
     uint32_t MipMapLevelCount = 1U;
     uint32_t ArrayLayerCount = 1U;
+    VkFormat Format = VK_FORMAT_UNDEFINED;
     VkImage Image = VK_NULL_HANDLE;
     VkDeviceMemory Memory = VK_NULL_HANDLE;
+    // The allocator the memory range comes from, nullptr if Memory is owned by the texture
+    VulkanMemoryAllocator *MemoryAllocator = nullptr;
+    VulkanMemoryAllocation Allocation{};
     VkImageView View = VK_NULL_HANDLE;
+    // Component mapping of View, e.g. single channel color textures are read as grey
+    VkComponentMapping Swizzle{};
     VkDescriptorImageInfo DescriptorImageInfo{};
     VkSampler Sampler = VK_NULL_HANDLE;
+    // The cache the sampler comes from, nullptr if Sampler is owned by the texture
+    VulkanSamplerCache *SamplerCache = nullptr;
     uint32_t Index = 0U;
 
     VulkanTexture(const VkAllocationCallbacks *pAllocator = nullptr)
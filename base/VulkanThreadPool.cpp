@@ -26,6 +26,10 @@ VulkanThreadPool::VulkanThreadPool(uint32_t maxThreadCount)
     {
         maxThreadCount = HARD_WARE_THREAD_RATE * static_cast<uint32_t>(std::thread::hardware_concurrency());
     }
+    if (maxThreadCount == 0)
+    {
+        maxThreadCount = 1;
+    }
     for (uint32_t i = 0; i < maxThreadCount; ++i)
     {
         // Every thread is in while loop to check condition that if there is at least one job.
@@ -34,21 +38,25 @@ VulkanThreadPool::VulkanThreadPool(uint32_t maxThreadCount)
             {
                 while (true)
                 {
-                    std::unique_lock<std::mutex> lock(this->m_Mutex);
-                    // If false, then wait/block.
-                    this->m_Condition.wait(lock,
-                                           [this](void) -> bool
-                                           {
-                                               return !this->m_Jobs.empty() || this->m_Stop;
-                                           });
-
-                    if (this->m_Stop && this->m_Jobs.empty())
+                    std::function<void(void)> job;
                     {
-                        return;
-                    }
+                        std::unique_lock<std::mutex> lock(this->m_Mutex);
+                        // If false, then wait/block.
+                        this->m_Condition.wait(lock,
+                                               [this](void) -> bool
+                                               {
+                                                   return !this->m_Jobs.empty() || this->m_Stop;
+                                               });
+
+                        if (this->m_Stop && this->m_Jobs.empty())
+                        {
+                            return;
+                        }
 
-                    std::function<void(void)> job(std::move(this->m_Jobs.front()));
-                    this->m_Jobs.pop();
+                        job = std::move(this->m_Jobs.front());
+                        this->m_Jobs.pop();
+                    }
+                    // Run the job without holding the lock so that other workers can take jobs
                     job();
                 }
             });
@@ -166,7 +166,7 @@ void VulkanUI::PrepareDescriptors()
     samplerCI.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
     samplerCI.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
     samplerCI.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-    CHECK_VK_RESULT(vkCreateSampler(p_Device->GetDevice(), &samplerCI, p_Allocator, &m_FontTexture.Sampler));
+    p_Device->CreateSampler(&samplerCI, &m_FontTexture);
 
     m_FontTexture.Device = p_Device->GetDevice();
     m_FontTexture.IsInitialized = true;
@@ -175,6 +175,7 @@ void VulkanUI::PrepareDescriptors()
     m_FontTexture.Height = 1;
     m_FontTexture.Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     m_FontTexture.MipMapLevelCount = imageCI.mipLevels;
+    m_FontTexture.Format = imageCI.format;
     m_FontTexture.ArrayLayerCount = 1;
     m_FontTexture.SetDescriptorImage();
 
@@ -0,0 +1,112 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanUniformRing.h"
+#include "VulkanTools.h"
+
+#include <cstring>
+
+VulkanUniformRing::VulkanUniformRing(VulkanDevice *pDevice,
+                                     uint32_t maxFramesInFlight,
+                                     VkDeviceSize frameSize,
+                                     VkDeviceSize range,
+                                     const VkAllocationCallbacks *pAllocator)
+{
+    if (pDevice == nullptr || pDevice->GetDevice() == VK_NULL_HANDLE)
+    {
+        FATAL("Uniform ring must be created with a valid device!");
+    }
+    if (maxFramesInFlight == 0 || frameSize == 0 || range == 0)
+    {
+        FATAL("Uniform ring capacity must not be 0!");
+    }
+    if (range > pDevice->m_GPUProperties.limits.maxUniformBufferRange)
+    {
+        FATAL("Uniform ring range %llu exceeds the device limit %u!", static_cast<unsigned long long>(range), pDevice->m_GPUProperties.limits.maxUniformBufferRange);
+    }
+
+    p_Device = pDevice;
+    p_Allocator = pAllocator;
+    m_Alignment = pDevice->m_GPUProperties.limits.minUniformBufferOffsetAlignment;
+    m_Range = range;
+    // Keep room for a full range behind the last aligned offset
+    m_FrameSize = (frameSize + m_Alignment - 1) / m_Alignment * m_Alignment;
+    if (m_FrameSize < m_Range)
+    {
+        m_FrameSize = (m_Range + m_Alignment - 1) / m_Alignment * m_Alignment;
+    }
+
+    m_Heads.resize(maxFramesInFlight, 0U);
+    m_Sets.resize(maxFramesInFlight);
+    for (uint32_t i = 0; i < maxFramesInFlight; ++i)
+    {
+        m_Buffers.push_back(std::move(VulkanBuffer(p_Allocator)));
+    }
+    for (uint32_t i = 0; i < maxFramesInFlight; ++i)
+    {
+        p_Device->CreateBuffer(m_FrameSize,
+                               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                               &m_Buffers[i]);
+        m_Buffers[i].Map();
+        // Dynamic offsets are added to this base offset
+        m_Buffers[i].SetDescriptorBuffer(m_Range, 0U);
+    }
+}
+
+VulkanUniformRing::~VulkanUniformRing()
+{
+    for (size_t i = 0; i < m_Buffers.size(); ++i)
+    {
+        m_Buffers[i].Unmap();
+        m_Buffers[i].Destroy();
+    }
+}
+
+void VulkanUniformRing::Reset(uint32_t currentFrame)
+{
+    m_Heads[currentFrame] = 0U;
+}
+
+uint32_t VulkanUniformRing::Push(uint32_t currentFrame, const void *data, VkDeviceSize size)
+{
+    if (size == 0 || size > m_Range)
+    {
+        FATAL("Uniform block size %llu must be in (0, %llu]!", static_cast<unsigned long long>(size), static_cast<unsigned long long>(m_Range));
+    }
+
+    VkDeviceSize offset = m_Heads[currentFrame];
+    if (offset + m_Range > m_FrameSize)
+    {
+        FATAL("Uniform ring of frame %u is full! Capacity: %llu", currentFrame, static_cast<unsigned long long>(m_FrameSize));
+    }
+    memcpy(static_cast<char *>(m_Buffers[currentFrame].Mapped) + offset, data, static_cast<size_t>(size));
+    m_Heads[currentFrame] = (offset + size + m_Alignment - 1) / m_Alignment * m_Alignment;
+
+    return static_cast<uint32_t>(offset);
+}
+
+void VulkanUniformRing::Flush(uint32_t currentFrame)
+{
+    if (m_Heads[currentFrame] != 0)
+    {
+        m_Buffers[currentFrame].Flush();
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_UNIFORM_RING_HEADER
+#define VULKAN_UNIFORM_RING_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+
+#include <vector>
+
+/**
+ * @brief Per-frame uniform ring. Each frame owns one persistently mapped uniform buffer, objects write their data linearly
+ * and bind the shared dynamic uniform buffer set with the returned offset.
+ * @note The ring of a frame is reset once the frame fence is signaled, and flushed once before the frame is submitted.
+ */
+class DVAPI_ATTR VulkanUniformRing final
+{
+private:
+    VulkanDevice *p_Device = nullptr;
+    const VkAllocationCallbacks *p_Allocator = nullptr;
+    // Dynamic offsets must be a multiple of minUniformBufferOffsetAlignment
+    VkDeviceSize m_Alignment = 0U;
+    VkDeviceSize m_FrameSize = 0U;
+    // Descriptor range seen by shaders, every pushed block must fit in it
+    VkDeviceSize m_Range = 0U;
+    // Written size of each frame, the next block starts here
+    std::vector<VkDeviceSize> m_Heads = {};
+
+public:
+    // Per-frame uniform buffers, persistently mapped
+    std::vector<VulkanBuffer> m_Buffers = {};
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_Sets = {};
+
+public:
+    /**
+     * @brief Create the per-frame uniform buffers.
+     * @param frameSize The capacity of each frame ring.
+     * @param range The largest uniform block pushed to the ring, used as the descriptor range.
+     */
+    explicit VulkanUniformRing(VulkanDevice *pDevice,
+                               uint32_t maxFramesInFlight,
+                               VkDeviceSize frameSize,
+                               VkDeviceSize range,
+                               const VkAllocationCallbacks *pAllocator = nullptr);
+    ~VulkanUniformRing();
+    VulkanUniformRing(const VulkanUniformRing &) = delete;
+    VulkanUniformRing &operator=(const VulkanUniformRing &) = delete;
+    VulkanUniformRing(VulkanUniformRing &&) = delete;
+    VulkanUniformRing &operator=(VulkanUniformRing &&) = delete;
+
+    // Rewind the ring of the frame, call it after the frame fence is signaled
+    void Reset(uint32_t currentFrame);
+    /**
+     * @brief Copy a uniform block to the ring of the frame.
+     * @return The dynamic offset of the block.
+     */
+    uint32_t Push(uint32_t currentFrame, const void *data, VkDeviceSize size);
+    // Flush the written blocks of the frame, once per frame before submission
+    void Flush(uint32_t currentFrame);
+
+    // Buffer info for the dynamic uniform buffer descriptor of the frame
+    inline VkDescriptorBufferInfo *GetDescriptorBufferInfo(uint32_t currentFrame) { return &m_Buffers[currentFrame].DescriptorBufferInfo; }
+    inline VkDeviceSize GetUsedSize(uint32_t currentFrame) const { return m_Heads[currentFrame]; }
+    inline VkDeviceSize GetFrameSize() const { return m_FrameSize; }
+};
+
+#endif
@@ -0,0 +1,390 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#include "VulkanUploadBatch.h"
+#include "VulkanTools.h"
+#include "VulkanInitializer.hpp"
+
+#include <cstring>
+
+VulkanUploadBatch::VulkanUploadBatch(VulkanDevice *pDevice, const VkAllocationCallbacks *pAllocator)
+{
+    if (pDevice == nullptr || pDevice->GetDevice() == VK_NULL_HANDLE)
+    {
+        FATAL("Upload batch must be created with a valid device!");
+    }
+    const QueueFamilyIndices *pIndices = pDevice->GetDeviceQueueFamilyIndices();
+    const Queues *pQueues = pDevice->GetDeviceQueues();
+    if (!pIndices->TransferHasValue && !pIndices->GraphicsHasValue)
+    {
+        FATAL("It seems neither the transfer queue nor the graphics queue are enabled when initializing device!");
+    }
+
+    p_Device = pDevice;
+    p_Allocator = pAllocator;
+    m_Async = p_Device->AsyncTransferSupport();
+    // Without a dedicated transfer family everything runs on the graphics queue, mip blits need it anyway
+    if (pIndices->GraphicsHasValue)
+    {
+        m_GraphicsFamily = pIndices->Graphics;
+        m_GraphicsQueue = pQueues->Graphics;
+        m_GraphicsCmdPool = p_Device->GetGraphicsCommandPool();
+    }
+    else
+    {
+        m_GraphicsFamily = pIndices->Transfer;
+        m_GraphicsQueue = pQueues->Transfer;
+    }
+    m_TransferFamily = m_Async ? pIndices->Transfer : m_GraphicsFamily;
+    m_TransferQueue = m_Async ? pQueues->Transfer : m_GraphicsQueue;
+    m_TransferCmdPool = p_Device->GetTransferCommandPool();
+}
+
+VulkanUploadBatch::~VulkanUploadBatch()
+{
+    if (!m_Submitted)
+    {
+        Submit();
+    }
+    Wait();
+}
+
+VkCommandBuffer VulkanUploadBatch::GetTransferCommandBuffer()
+{
+    if (m_Submitted)
+    {
+        FATAL("Can not record to a submitted upload batch before waiting for it!");
+    }
+    if (!m_Async && m_GraphicsCmdPool != VK_NULL_HANDLE)
+    {
+        return GetGraphicsCommandBuffer();
+    }
+    if (m_TransferCmdBuffer == VK_NULL_HANDLE)
+    {
+        m_TransferCmdBuffer = p_Device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, m_TransferCmdPool, true);
+    }
+    return m_TransferCmdBuffer;
+}
+
+VkCommandBuffer VulkanUploadBatch::GetGraphicsCommandBuffer()
+{
+    if (m_Submitted)
+    {
+        FATAL("Can not record to a submitted upload batch before waiting for it!");
+    }
+    if (m_GraphicsCmdPool == VK_NULL_HANDLE)
+    {
+        return GetTransferCommandBuffer();
+    }
+    if (m_GraphicsCmdBuffer == VK_NULL_HANDLE)
+    {
+        m_GraphicsCmdBuffer = p_Device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, m_GraphicsCmdPool, true);
+    }
+    return m_GraphicsCmdBuffer;
+}
+
+VulkanStagingRing::Region VulkanUploadBatch::Stage(const void *pData, VkDeviceSize size, VkDeviceSize alignment)
+{
+    VulkanStagingRing *pStagingRing = p_Device->GetStagingRing();
+    if (pStagingRing->GetPendingSize() > 0 && pStagingRing->GetPendingSize() + size > pStagingRing->GetCapacity() / 2)
+    {
+        // Commands recorded after this point go to new command buffers on the same queues, so their order is kept
+        SubmitAsync();
+    }
+
+    VulkanStagingRing::Region region = pStagingRing->Allocate(size, alignment);
+    if (pData != nullptr)
+    {
+        memcpy(region.Mapped, pData, static_cast<size_t>(size));
+    }
+    return region;
+}
+
+void VulkanUploadBatch::CopyBuffer(const void *pData, VkDeviceSize size, VulkanBuffer *pDsts, size_t dstCount, VkDeviceSize dstOffset)
+{
+    for (size_t i = 0; i < dstCount; ++i)
+    {
+        if (pDsts[i].Buffer == VK_NULL_HANDLE)
+        {
+            FATAL("The dst buffer is not initialized!");
+        }
+        if (dstOffset + size > pDsts[i].Size)
+        {
+            FATAL("Upload range exceeds the destination buffer size!");
+        }
+    }
+
+    VulkanStagingRing::Region staging = Stage(pData, size);
+    VkCommandBuffer cmdBuffer = GetTransferCommandBuffer();
+
+    VkBufferCopy bufferCopy{};
+    bufferCopy.srcOffset = staging.Offset;
+    bufferCopy.dstOffset = dstOffset;
+    bufferCopy.size = size;
+    for (size_t i = 0; i < dstCount; ++i)
+    {
+        vkCmdCopyBuffer(cmdBuffer, staging.Buffer, pDsts[i].Buffer, 1, &bufferCopy);
+        ReleaseBuffer(pDsts[i].Buffer, dstOffset, size, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT);
+    }
+}
+
+void VulkanUploadBatch::ReleaseBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkBufferMemoryBarrier barrier = vkinfo::BufferMemoryBarrier();
+    barrier.buffer = buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    if (m_Async)
+    {
+        // Release on the transfer queue, the destination access is ignored here
+        barrier.srcQueueFamilyIndex = m_TransferFamily;
+        barrier.dstQueueFamilyIndex = m_GraphicsFamily;
+        barrier.dstAccessMask = VK_ACCESS_NONE;
+        vkCmdPipelineBarrier(GetTransferCommandBuffer(),
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0,
+                             0, nullptr,
+                             1, &barrier,
+                             0, nullptr);
+        // Acquire on the graphics queue after the semaphore wait, the source access is ignored here
+        barrier.srcAccessMask = VK_ACCESS_NONE;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(GetGraphicsCommandBuffer(),
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             dstStage,
+                             0,
+                             0, nullptr,
+                             1, &barrier,
+                             0, nullptr);
+    }
+    else
+    {
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(GetTransferCommandBuffer(),
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             dstStage,
+                             0,
+                             0, nullptr,
+                             1, &barrier,
+                             0, nullptr);
+    }
+}
+
+void VulkanUploadBatch::ReleaseImage(VkImage image,
+                                     const VkImageSubresourceRange &subresource,
+                                     VkImageLayout oldLayout,
+                                     VkImageLayout newLayout,
+                                     VkPipelineStageFlags dstStage,
+                                     VkAccessFlags dstAccess)
+{
+    VkImageMemoryBarrier barrier = vkinfo::ImageMemoryBarrier();
+    barrier.image = image;
+    barrier.subresourceRange = subresource;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    if (m_Async)
+    {
+        // The layout transition happens once, between the release and the acquire
+        barrier.srcQueueFamilyIndex = m_TransferFamily;
+        barrier.dstQueueFamilyIndex = m_GraphicsFamily;
+        barrier.dstAccessMask = VK_ACCESS_NONE;
+        vkCmdPipelineBarrier(GetTransferCommandBuffer(),
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+        barrier.srcAccessMask = VK_ACCESS_NONE;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(GetGraphicsCommandBuffer(),
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             dstStage,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+    }
+    else
+    {
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(GetTransferCommandBuffer(),
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             dstStage,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+    }
+}
+
+void VulkanUploadBatch::DestroyWhenComplete(std::function<void()> &&deleter)
+{
+    if (m_Submitted)
+    {
+        FATAL("Can not record to a submitted upload batch before waiting for it!");
+    }
+    m_Deleters.push_back(std::move(deleter));
+}
+
+void VulkanUploadBatch::Submit()
+{
+    if (m_Submitted || (m_TransferCmdBuffer == VK_NULL_HANDLE && m_GraphicsCmdBuffer == VK_NULL_HANDLE))
+    {
+        return;
+    }
+
+    m_Fence = p_Device->AcquireFence();
+    if (m_TransferCmdBuffer != VK_NULL_HANDLE)
+    {
+        CHECK_VK_RESULT(vkEndCommandBuffer(m_TransferCmdBuffer));
+    }
+    if (m_GraphicsCmdBuffer != VK_NULL_HANDLE)
+    {
+        CHECK_VK_RESULT(vkEndCommandBuffer(m_GraphicsCmdBuffer));
+    }
+
+    if (m_Async)
+    {
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        uint64_t timelineValue = 0U;
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        if (p_Device->TimelineSemaphoreSupport())
+        {
+            semaphore = p_Device->GetUploadTimeline();
+            timelineValue = p_Device->NextUploadTimelineValue();
+        }
+        else
+        {
+            m_Semaphore = p_Device->AcquireSemaphore();
+            semaphore = m_Semaphore;
+        }
+
+        if (m_TransferCmdBuffer != VK_NULL_HANDLE)
+        {
+            VkSubmitInfo transferSubmit = vkinfo::SubmitInfo();
+            transferSubmit.commandBufferCount = 1;
+            transferSubmit.pCommandBuffers = &m_TransferCmdBuffer;
+            transferSubmit.signalSemaphoreCount = 1;
+            transferSubmit.pSignalSemaphores = &semaphore;
+            if (p_Device->TimelineSemaphoreSupport())
+            {
+                timelineInfo.signalSemaphoreValueCount = 1;
+                timelineInfo.pSignalSemaphoreValues = &timelineValue;
+                transferSubmit.pNext = &timelineInfo;
+            }
+            CHECK_VK_RESULT(vkQueueSubmit(m_TransferQueue, 1, &transferSubmit, VK_NULL_HANDLE));
+            // Staging regions of this batch are recycled once the copies are done
+            p_Device->GetStagingRing()->Submit(m_TransferQueue);
+        }
+
+        // The graphics queue waits for the copies only, earlier rendering keeps running
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo graphicsSubmit = vkinfo::SubmitInfo();
+        graphicsSubmit.commandBufferCount = m_GraphicsCmdBuffer != VK_NULL_HANDLE ? 1U : 0U;
+        graphicsSubmit.pCommandBuffers = &m_GraphicsCmdBuffer;
+        if (m_TransferCmdBuffer != VK_NULL_HANDLE)
+        {
+            graphicsSubmit.waitSemaphoreCount = 1;
+            graphicsSubmit.pWaitSemaphores = &semaphore;
+            graphicsSubmit.pWaitDstStageMask = &waitStage;
+            if (p_Device->TimelineSemaphoreSupport())
+            {
+                timelineInfo.signalSemaphoreValueCount = 0;
+                timelineInfo.pSignalSemaphoreValues = nullptr;
+                timelineInfo.waitSemaphoreValueCount = 1;
+                timelineInfo.pWaitSemaphoreValues = &timelineValue;
+                graphicsSubmit.pNext = &timelineInfo;
+            }
+        }
+        CHECK_VK_RESULT(vkQueueSubmit(m_GraphicsQueue, 1, &graphicsSubmit, m_Fence));
+    }
+    else
+    {
+        VkCommandBuffer cmdBuffer = m_GraphicsCmdBuffer != VK_NULL_HANDLE ? m_GraphicsCmdBuffer : m_TransferCmdBuffer;
+        VkSubmitInfo submitInfo = vkinfo::SubmitInfo();
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &cmdBuffer;
+        CHECK_VK_RESULT(vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, m_Fence));
+        p_Device->GetStagingRing()->Submit(m_GraphicsQueue);
+    }
+    m_Submitted = true;
+    ++m_SubmitCount;
+}
+
+void VulkanUploadBatch::Reset()
+{
+    m_Fence = VK_NULL_HANDLE;
+    m_TransferCmdBuffer = VK_NULL_HANDLE;
+    m_GraphicsCmdBuffer = VK_NULL_HANDLE;
+    m_Semaphore = VK_NULL_HANDLE;
+    m_Submitted = false;
+    m_Deleters.clear();
+}
+
+void VulkanUploadBatch::Wait()
+{
+    if (!m_Submitted)
+    {
+        // Nothing was recorded, so nothing uses the transient objects
+        if (m_TransferCmdBuffer == VK_NULL_HANDLE && m_GraphicsCmdBuffer == VK_NULL_HANDLE)
+        {
+            for (size_t i = 0; i < m_Deleters.size(); ++i)
+            {
+                m_Deleters[i]();
+            }
+            m_Deleters.clear();
+        }
+        return;
+    }
+
+    CHECK_VK_RESULT(vkWaitForFences(p_Device->GetDevice(), 1, &m_Fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
+    p_Device->ReleaseFence(m_Fence);
+    p_Device->FreeCommandBuffer(m_TransferCmdBuffer, m_TransferCmdPool);
+    p_Device->FreeCommandBuffer(m_GraphicsCmdBuffer, m_GraphicsCmdPool);
+    p_Device->ReleaseSemaphore(m_Semaphore);
+    for (size_t i = 0; i < m_Deleters.size(); ++i)
+    {
+        m_Deleters[i]();
+    }
+    Reset();
+}
+
+void VulkanUploadBatch::SubmitAsync()
+{
+    Submit();
+    if (!m_Submitted)
+    {
+        Wait();
+        return;
+    }
+
+    p_Device->TrackUpload(m_Fence, m_TransferCmdBuffer, m_GraphicsCmdBuffer, m_Semaphore, std::move(m_Deleters));
+    Reset();
+}
+
+bool VulkanUploadBatch::IsComplete()
+{
+    return !m_Submitted || vkGetFenceStatus(p_Device->GetDevice(), m_Fence) == VK_SUCCESS;
+}
@@ -0,0 +1,121 @@
+/*
+ *
+ ******************************************************************************
+ *    Copyright [2024] [YongSong]
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ ******************************************************************************
+ *
+ */
+
+#ifndef VULKAN_UPLOAD_BATCH_HEADER
+#define VULKAN_UPLOAD_BATCH_HEADER
+
+#pragma once
+
+#include "VulkanCore.h"
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanTexture.h"
+#include "VulkanStagingRing.h"
+
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Collects uploads of many resources, submits them once and signals one fence.
+ * With a dedicated transfer queue family, copies run on the transfer queue and the resources are released to the graphics queue family,
+ * the graphics queue acquires them after waiting on the upload timeline semaphore, so uploads overlap with rendering.
+ * Otherwise both command buffers are the same one on the graphics queue.
+ * @note Resources must be created with exclusive sharing mode. Record copies to GetTransferCommandBuffer(),
+ * then hand the resources over with ReleaseBuffer()/ReleaseImage() before recording graphics work such as mip blits.
+ */
+class DVAPI_ATTR VulkanUploadBatch final
+{
+private:
+    VulkanDevice *p_Device = nullptr;
+    const VkAllocationCallbacks *p_Allocator = nullptr;
+    bool m_Async = false;
+    uint32_t m_TransferFamily = 0U;
+    uint32_t m_GraphicsFamily = 0U;
+    VkQueue m_TransferQueue = VK_NULL_HANDLE;
+    VkQueue m_GraphicsQueue = VK_NULL_HANDLE;
+    VkCommandPool m_TransferCmdPool = VK_NULL_HANDLE;
+    VkCommandPool m_GraphicsCmdPool = VK_NULL_HANDLE;
+    VkCommandBuffer m_TransferCmdBuffer = VK_NULL_HANDLE;
+    VkCommandBuffer m_GraphicsCmdBuffer = VK_NULL_HANDLE;
+    VkSemaphore m_Semaphore = VK_NULL_HANDLE;
+    VkFence m_Fence = VK_NULL_HANDLE;
+    bool m_Submitted = false;
+    uint32_t m_SubmitCount = 0U;
+    // Transient objects destroyed once the commands recorded so far are finished
+    std::vector<std::function<void()>> m_Deleters = {};
+
+    void Reset();
+
+public:
+    explicit VulkanUploadBatch(VulkanDevice *pDevice, const VkAllocationCallbacks *pAllocator = nullptr);
+    // Submit the pending commands and wait for the batch unless it was handed to the device with SubmitAsync
+    ~VulkanUploadBatch();
+    VulkanUploadBatch(const VulkanUploadBatch &) = delete;
+    VulkanUploadBatch &operator=(const VulkanUploadBatch &) = delete;
+    VulkanUploadBatch(VulkanUploadBatch &&) = delete;
+    VulkanUploadBatch &operator=(VulkanUploadBatch &&) = delete;
+
+    // Command buffer for copies, recording begins on the first call
+    VkCommandBuffer GetTransferCommandBuffer();
+    // Command buffer for work that needs the graphics queue, e.g. mip blits, recording begins on the first call
+    VkCommandBuffer GetGraphicsCommandBuffer();
+    /**
+     * @brief Copy data into the staging ring, the region stays valid until the batch finishes.
+     * @note The batch is flushed first if the unsubmitted staging data would take more than half of the ring.
+     * Pass nullptr to write the region directly.
+     */
+    VulkanStagingRing::Region Stage(const void *pData, VkDeviceSize size, VkDeviceSize alignment = 0U);
+    // Stage data once, record copies to every dst buffer and release the written ranges to the graphics queue
+    void CopyBuffer(const void *pData, VkDeviceSize size, VulkanBuffer *pDsts, size_t dstCount = 1, VkDeviceSize dstOffset = 0U);
+    /**
+     * @brief Make a buffer range written on the transfer command buffer visible to graphics work.
+     * @note This is a queue family ownership transfer with a dedicated transfer queue, otherwise a plain barrier.
+     */
+    void ReleaseBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+    /**
+     * @brief Make an image written on the transfer command buffer visible to graphics work, changing its layout on the way.
+     * @note This is a queue family ownership transfer with a dedicated transfer queue, otherwise a plain barrier.
+     */
+    void ReleaseImage(VkImage image,
+                      const VkImageSubresourceRange &subresource,
+                      VkImageLayout oldLayout,
+                      VkImageLayout newLayout,
+                      VkPipelineStageFlags dstStage,
+                      VkAccessFlags dstAccess);
+    /**
+     * @brief Run the deleter once the commands recorded so far are finished, e.g. to destroy transient descriptor pools or views.
+     * @note The deleter runs in Wait(), or in VulkanDevice::CollectUploads() after SubmitAsync().
+     */
+    void DestroyWhenComplete(std::function<void()> &&deleter);
+    // End recording and submit the batch with its fence
+    void Submit();
+    // Wait for the submitted batch and release its command buffers, the batch can be recorded again afterwards
+    void Wait();
+    // Submit the batch and let the device release it once finished, the batch can be recorded again right away
+    void SubmitAsync();
+    // Whether the submitted batch is finished, always true if nothing is submitted
+    bool IsComplete();
+
+    inline bool IsAsync() const { return m_Async; }
+    // Times this batch has been submitted, including flushes caused by a full staging ring
+    inline uint32_t GetSubmitCount() const { return m_SubmitCount; }
+};
+
+#endif
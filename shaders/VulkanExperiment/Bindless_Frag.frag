@@ -0,0 +1,17 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec3 fragNormal;
+layout (location = 2) in vec2 fragUV;
+layout (location = 3) flat in uint fragTextureIndex;
+
+// Global texture table, indexed by the texture index of the draw parameters
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+
+layout (location = 0) out vec4 outColor;
+
+void main()
+{
+    outColor = texture(textures[nonuniformEXT(fragTextureIndex)], fragUV) * vec4(fragColor, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 450
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 color;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec2 uv;
+// Per-instance transform, takes locations 4 to 7
+layout (location = 4) in mat4 instanceModel;
+
+layout (set = 0, binding = 0) uniform CameraUniform {
+    mat4 View;
+    mat4 InverseView;
+    mat4 Projection;
+    mat4 InverseProjection;
+} cam;
+
+layout (location = 0) out vec3 fragColor;
+layout (location = 1) out vec3 fragNormal;
+layout (location = 2) out vec2 fragUV;
+
+void main()
+{
+    gl_Position = cam.Projection * cam.View * instanceModel * vec4(position, 1.0);
+    fragColor = color;
+    fragNormal = normal;
+    fragUV = uv;
+}
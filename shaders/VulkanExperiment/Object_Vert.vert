@@ -0,0 +1,40 @@
+#version 450
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 color;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec2 uv;
+
+layout (set = 0, binding = 0) uniform CameraUniform {
+    mat4 View;
+    mat4 InverseView;
+    mat4 Projection;
+    mat4 InverseProjection;
+} cam;
+
+struct DrawParameter {
+    mat4 UniqueModel;
+    uint TextureIndex;
+    uint MeshIndex;
+    uint Padding0;
+    uint Padding1;
+};
+
+// Indexed by firstInstance of the indirect command
+layout (std430, set = 0, binding = 1) readonly buffer DrawParameters {
+    DrawParameter draws[];
+};
+
+layout (location = 0) out vec3 fragColor;
+layout (location = 1) out vec3 fragNormal;
+layout (location = 2) out vec2 fragUV;
+layout (location = 3) flat out uint fragTextureIndex;
+
+void main()
+{
+    gl_Position = cam.Projection * cam.View * draws[gl_InstanceIndex].UniqueModel * vec4(position, 1.0);
+    fragColor = color;
+    fragNormal = normal;
+    fragUV = uv;
+    fragTextureIndex = draws[gl_InstanceIndex].TextureIndex;
+}
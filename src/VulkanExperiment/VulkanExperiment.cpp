@@ -45,6 +45,22 @@ public:
         {
             delete p_SkyBoxPipelineConfig;
         }
+        if (m_InstancedPipeline != VK_NULL_HANDLE)
+        {
+            p_RenderSystem->DestroyPipeline(m_InstancedPipeline);
+        }
+        if (m_InstancedPipelineLayout != VK_NULL_HANDLE)
+        {
+            p_RenderSystem->DestroyPipelineLayout(m_InstancedPipelineLayout);
+        }
+        if (p_InstancedPipelineConfig != nullptr)
+        {
+            delete p_InstancedPipelineConfig;
+        }
+        if (p_InstancedModel != nullptr)
+        {
+            delete p_InstancedModel;
+        }
         if (m_ModelGraphicsPipeline != VK_NULL_HANDLE)
         {
             p_RenderSystem->DestroyPipeline(m_ModelGraphicsPipeline);
@@ -61,6 +77,11 @@ public:
         {
             delete p_Models[i];
         }
+        // The renderer keeps unreferenced textures cached and destroys them with itself
+        for (size_t i = 0; i < m_CachedTextureHandles.size(); ++i)
+        {
+            ReleaseTexture(m_CachedTextureHandles[i]);
+        }
         p_RenderSystem->DestroyDescriptorPool(VulkanRenderSystem::GetGlobalDescriptorPool());
         for (size_t i = 0; i < m_DescriptorSetLayouts.size(); ++i)
         {
@@ -90,13 +111,25 @@ private:
 
 private:
     std::vector<VulkanModel *> p_Models = {};
-
-    // Model and camera
+    // Tracked texture handle of each model for the memory budget policy, models sharing a cached texture share the handle
+    std::vector<uint32_t> m_TextureHandles = {};
+    // Texture cache handles acquired by the models, released on destruction
+    std::vector<uint32_t> m_CachedTextureHandles = {};
+    // Bindless texture index of each model, empty if bindless textures are not supported
+    std::vector<uint32_t> m_TextureIndices = {};
+
+    // Model, draw parameters and camera
     std::vector<VkDescriptorSetLayout> m_DescriptorSetLayouts = {};
     PipelineConfigInfo *p_ModelGraphcisPipelineConfig = nullptr;
     VkPipelineLayout m_ModelGraphicsPipelineLayout = VK_NULL_HANDLE;
     VkPipeline m_ModelGraphicsPipeline = VK_NULL_HANDLE;
 
+    // Instanced cubes, drawn with one call, set 0 is compatible with the model pipeline layout
+    VulkanModel *p_InstancedModel = nullptr;
+    PipelineConfigInfo *p_InstancedPipelineConfig = nullptr;
+    VkPipelineLayout m_InstancedPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_InstancedPipeline = VK_NULL_HANDLE;
+
     // Sky box
     std::vector<VkDescriptorSetLayout> m_SkyBoxDescriptorSetLayout = {};
     PipelineConfigInfo *p_SkyBoxPipelineConfig = nullptr;
@@ -136,10 +169,28 @@ void VulkanExperiment::LoadModels()
                   HOME_DIR "res/textures/skybox_scene/Back.jpg"},
                  false,
                  true);
-    CreateUniformBuffers(sizeof(VulkanCamera::Matrix), p_SkyBox->m_TransformBuffers.data(), p_SkyBox->m_TransformBuffers.size());
 
-    // Global uniform buffer
-    CreateUniformBuffers(sizeof(VulkanCamera::Matrix), p_Camera->m_CameraUniformBuffers.data(), p_Camera->m_CameraUniformBuffers.size());
+    // Camera and sky box transforms are pushed to the uniform ring every frame
+    CreateUniformRing(1U << 16U, sizeof(VulkanCamera::Matrix));
+
+    // Instanced cubes own their buffers, so they are loaded before the geometry arena
+    p_InstancedModel = LoadModel(HOME_DIR "res/models/Cube.obj", MODEL_TYPE_OBJ, 0, VK_VERTEX_INPUT_RATE_VERTEX);
+    CreateInstanceBuffers(p_InstancedModel, 1, 10000);
+    for (int x = 0; x < 100; ++x)
+    {
+        for (int z = 0; z < 100; ++z)
+        {
+            opm::vec3 translation{static_cast<opm::T>(-25.0 + 0.5 * x), 2.0, static_cast<opm::T>(-25.0 + 0.5 * z)};
+            p_InstancedModel->AddInstance(opm::Transform(opm::mat4{1.0}, {0.05, 0.05, 0.05}, {0.0, 0.0, 0.0}, translation));
+        }
+    }
+    opm::srgb cubeColor(100, 60, 60, 100);
+    CreateTextures(p_InstancedModel->m_ColorTextures.data(), p_InstancedModel->m_ColorTextures.size(), &cubeColor);
+
+    // Models loaded from now on share the arena vertex and index buffers, sky box keeps its own buffers
+    CreateGeometryArena(1U << 18U, 1U << 20U, 64U);
+    // Model textures are sampled from one global table if descriptor indexing is supported
+    CreateBindlessTextures(64U);
 
     // Models
     p_Models.push_back(std::move(LoadModel(HOME_DIR "res/models/Viking_Room.obj", MODEL_TYPE_OBJ, 0, VK_VERTEX_INPUT_RATE_VERTEX)));
@@ -151,16 +202,34 @@ void VulkanExperiment::LoadModels()
     std::vector<IndexType> index = {0, 1, 2, 2, 3, 0};
     p_Models.push_back(std::move(LoadModel(vertex, 0, VK_VERTEX_INPUT_RATE_VERTEX, index)));
     p_Models[1]->Transform({1.0, 1.0, 1.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, -1.0});
+    p_Models.push_back(std::move(LoadModel(vertex, 0, VK_VERTEX_INPUT_RATE_VERTEX, index)));
+    p_Models[2]->Transform({0.5, 0.5, 0.5}, {0.0, 0.0, 0.0}, {1.5, 0.0, -1.0});
 
     // p_Models.push_back(std::move(LoadModel(HOME_DIR "res/models/obj.obj", MODEL_TYPE_OBJ, 0, VK_VERTEX_INPUT_RATE_VERTEX)));
     // p_Models.push_back(std::move(LoadModel(HOME_DIR "res/models/spacecraft.obj", MODEL_TYPE_OBJ, 0, VK_VERTEX_INPUT_RATE_VERTEX)));
 
-    for (size_t i = 0; i < p_Models.size(); ++i)
+    // Decoded on worker threads, the texture sets allocated by CreateGraphicsPipelines are looked up and rewritten when the image is swapped in
+    CreateTexturesAsync(HOME_DIR "res/textures/Viking_Room.png", p_Models[0]->m_ColorTextures.data(), p_Models[0]->m_ColorTextures.size(), true, true, &p_Models[0]->m_TextureSets, 0);
+    // Both quads sample the same file, it is decoded and uploaded once by the texture cache
+    for (size_t i = 1; i < p_Models.size(); ++i)
+    {
+        m_CachedTextureHandles.push_back(AcquireTexture(HOME_DIR "res/textures/Quad.jpg", true, true));
+        p_Models[i]->p_CachedColorTexture = GetCachedTexture(m_CachedTextureHandles.back());
+    }
+    // Textures of models unseen for the longest time are downgraded first when memory runs low, a shared texture is tracked once with the sets of every model
+    m_TextureHandles.push_back(TrackTextures(p_Models[0]->m_ColorTextures.data(), p_Models[0]->m_ColorTextures.size(), &p_Models[0]->m_TextureSets, 0));
+    for (size_t i = 1; i < p_Models.size(); ++i)
     {
-        CreateUniformBuffers(sizeof(opm::mat4), p_Models[i]->m_TransformBuffers.data(), p_Models[i]->m_TransformBuffers.size());
+        m_TextureHandles.push_back(TrackTextures(p_Models[i]->p_CachedColorTexture, 1, &p_Models[i]->m_TextureSets, 0));
+    }
+    // Models sharing a texture share its bindless index
+    if (p_BindlessTextures != nullptr)
+    {
+        for (size_t i = 0; i < p_Models.size(); ++i)
+        {
+            m_TextureIndices.push_back(p_BindlessTextures->Add(&p_Models[i]->GetColorTexture(0)));
+        }
     }
-    CreateTextures(HOME_DIR "res/textures/Viking_Room.png", p_Models[0]->m_ColorTextures.data(), p_Models[0]->m_ColorTextures.size(), true, true);
-    CreateTextures(HOME_DIR "res/textures/Quad.jpg", p_Models[1]->m_ColorTextures.data(), p_Models[1]->m_ColorTextures.size(), true, true);
     // opm::srgb color(100, 60, 60, 100);
     // CreateTextures(p_Models[1]->m_ColorTextures.data(), p_Models[1]->m_ColorTextures.size(), &color);
 }
@@ -168,11 +237,10 @@ void VulkanExperiment::LoadModels()
 void VulkanExperiment::CreateDescriptorPool()
 {
     VulkanRenderSystem::GetGlobalDescriptorPool() = p_RenderSystem->InitSystem(m_Settings.MaxFramesInFlight, p_Device->GetDevice())
-                                                        .SetMaxSets((p_Models.size() * 2 + 1 + 2) * m_Settings.MaxFramesInFlight)
-                                                        .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_Settings.MaxFramesInFlight)                           // camera uniform
-                                                        .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, p_Models.size() * m_Settings.MaxFramesInFlight)         // module uniform
-                                                        .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, p_Models.size() * m_Settings.MaxFramesInFlight) // module texture
-                                                        .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_Settings.MaxFramesInFlight)                           // sky box uniform
+                                                        .SetMaxSets((p_Models.size() + 1 + 2 + 2) * m_Settings.MaxFramesInFlight)
+                                                        .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, m_Settings.MaxFramesInFlight)                   // camera and sky box uniform ring
+                                                        .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_Settings.MaxFramesInFlight)                           // draw parameters
+                                                        .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (p_Models.size() + 1) * m_Settings.MaxFramesInFlight) // module texture
                                                         .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_Settings.MaxFramesInFlight)                   // sky cube texture
                                                         .BuildDescriptorPool(0);
 }
@@ -184,17 +252,21 @@ void VulkanExperiment::CreateDescriptorPool()
  */
 void VulkanExperiment::CreateGraphicsPipelines()
 {
-    // Sky box descriptor sets
-    VkDescriptorSetLayout transform = p_RenderSystem->AddSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT)
-                                          .BuildDescriptorSetLayout();
-    m_SkyBoxDescriptorSetLayout.push_back(transform);
-    p_SkyBox->m_DescriptorSetLayouts.push_back(transform);
-    p_RenderSystem->AllocateDescriptorSets(VulkanRenderSystem::GetGlobalDescriptorPool(), transform, p_SkyBox->m_TransformSets.data(), p_SkyBox->m_TransformSets.size());
-    for (size_t j = 0; j < p_SkyBox->m_TransformSets.size(); ++j)
+    // Per-frame set 0 of both the sky box and the model pipeline layout: uniform ring at binding 0, draw parameters at binding 1
+    p_UniformRing->m_SetLayout = p_RenderSystem->AddSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT)
+                                     .AddSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT)
+                                     .BuildDescriptorSetLayout();
+    m_DescriptorSetLayouts.push_back(p_UniformRing->m_SetLayout);
+    p_RenderSystem->AllocateDescriptorSets(VulkanRenderSystem::GetGlobalDescriptorPool(), p_UniformRing->m_SetLayout, p_UniformRing->m_Sets.data(), p_UniformRing->m_Sets.size());
+    for (uint32_t i = 0; i < p_UniformRing->m_Sets.size(); ++i)
     {
-        p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, p_SkyBox->m_TransformSets[j], 0, &p_SkyBox->m_TransformBuffers[j].DescriptorBufferInfo);
+        p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, p_UniformRing->m_Sets[i], 0, p_UniformRing->GetDescriptorBufferInfo(i));
+        p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, p_UniformRing->m_Sets[i], 1, &p_GeometryArena->m_DrawParameterBuffers[i].DescriptorBufferInfo);
     }
 
+    // Sky box descriptor sets
+    p_SkyBox->m_DescriptorSetLayouts.push_back(p_UniformRing->m_SetLayout);
+
     VkDescriptorSetLayout texture = p_RenderSystem->AddSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
                                         .BuildDescriptorSetLayout();
     m_SkyBoxDescriptorSetLayout.push_back(texture);
@@ -202,7 +274,7 @@ void VulkanExperiment::CreateGraphicsPipelines()
     p_RenderSystem->AllocateDescriptorSets(VulkanRenderSystem::GetGlobalDescriptorPool(), texture, p_SkyBox->m_TextureSets.data(), p_SkyBox->m_TextureSets.size());
     for (size_t j = 0; j < p_SkyBox->m_TextureSets.size(); ++j)
     {
-        p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, p_SkyBox->m_TextureSets[j], 0, &p_SkyBox->m_ColorTextures[j].DescriptorImageInfo);
+        p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, p_SkyBox->m_TextureSets[j], 0, &p_SkyBox->GetColorTexture(static_cast<uint32_t>(j)).DescriptorImageInfo);
     }
     p_RenderSystem->UpdateDescriptorSets();
 
@@ -224,45 +296,35 @@ void VulkanExperiment::CreateGraphicsPipelines()
                            .BuildShaderStage(SHADER_DIR "Sky_Box.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
                            .BuildGraphicsPipeline(p_SkyBoxPipelineConfig);
 
-    // Camera descriptors
-    p_Camera->m_CameraSetLayout = p_RenderSystem->AddSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT)
-                                      .BuildDescriptorSetLayout();
-    m_DescriptorSetLayouts.push_back(p_Camera->m_CameraSetLayout);
-    p_RenderSystem->AllocateDescriptorSets(VulkanRenderSystem::GetGlobalDescriptorPool(), p_Camera->m_CameraSetLayout, p_Camera->m_CameraSets.data(), p_Camera->m_CameraSets.size());
-    for (uint32_t i = 0; i < p_Camera->m_CameraSets.size(); ++i)
-    {
-        p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, p_Camera->m_CameraSets[i], 0, &p_Camera->m_CameraUniformBuffers[i].DescriptorBufferInfo);
-    }
-    // Model transform descriptors
-    VkDescriptorSetLayout modelTransformSetLayout = p_RenderSystem->AddSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT)
-                                                        .BuildDescriptorSetLayout();
-    m_DescriptorSetLayouts.push_back(modelTransformSetLayout);
-    for (size_t i = 0; i < p_Models.size(); ++i)
-    {
-        p_Models[i]->m_DescriptorSetLayouts.push_back(modelTransformSetLayout);
-        p_RenderSystem->AllocateDescriptorSets(VulkanRenderSystem::GetGlobalDescriptorPool(), modelTransformSetLayout, p_Models[i]->m_TransformSets.data(), p_Models[i]->m_TransformSets.size());
-        for (size_t j = 0; j < p_Models[i]->m_TransformSets.size(); ++j)
-        {
-            p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, p_Models[i]->m_TransformSets[j], 0, &p_Models[i]->m_TransformBuffers[j].DescriptorBufferInfo);
-        }
-    }
-    // Model texture descriptors
+    // Model texture descriptors, with bindless textures only the instanced cubes use a texture set
     VkDescriptorSetLayout modelTextureSetLayout = p_RenderSystem->AddSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
                                                       .BuildDescriptorSetLayout();
     m_DescriptorSetLayouts.push_back(modelTextureSetLayout);
-    for (size_t i = 0; i < p_Models.size(); ++i)
+    for (size_t i = 0; i < p_Models.size() && p_BindlessTextures == nullptr; ++i)
     {
         p_Models[i]->m_DescriptorSetLayouts.push_back(modelTextureSetLayout);
         p_RenderSystem->AllocateDescriptorSets(VulkanRenderSystem::GetGlobalDescriptorPool(), modelTextureSetLayout, p_Models[i]->m_TextureSets.data(), p_Models[i]->m_TextureSets.size());
         for (size_t j = 0; j < p_Models[i]->m_TextureSets.size(); ++j)
         {
-            p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, p_Models[i]->m_TextureSets[j], 0, &p_Models[i]->m_ColorTextures[j].DescriptorImageInfo);
+            p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, p_Models[i]->m_TextureSets[j], 0, &p_Models[i]->GetColorTexture(static_cast<uint32_t>(j)).DescriptorImageInfo);
         }
     }
+    p_InstancedModel->m_DescriptorSetLayouts.push_back(modelTextureSetLayout);
+    p_RenderSystem->AllocateDescriptorSets(VulkanRenderSystem::GetGlobalDescriptorPool(), modelTextureSetLayout, p_InstancedModel->m_TextureSets.data(), p_InstancedModel->m_TextureSets.size());
+    for (size_t j = 0; j < p_InstancedModel->m_TextureSets.size(); ++j)
+    {
+        p_RenderSystem->WriteDescriptorSets(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, p_InstancedModel->m_TextureSets[j], 0, &p_InstancedModel->GetColorTexture(static_cast<uint32_t>(j)).DescriptorImageInfo);
+    }
     p_RenderSystem->UpdateDescriptorSets();
 
-    // Model and camera graphics pipeline
-    m_ModelGraphicsPipelineLayout = p_RenderSystem->BuildPipelineLayout(0, nullptr, m_DescriptorSetLayouts.data(), m_DescriptorSetLayouts.size());
+    // Model and camera graphics pipeline, draws are indirect commands whose firstInstance indexes the draw parameters
+    // The bindless texture table replaces the per-model texture set as set 1, it is owned by the renderer and not destroyed with m_DescriptorSetLayouts
+    std::vector<VkDescriptorSetLayout> modelSetLayouts = m_DescriptorSetLayouts;
+    if (p_BindlessTextures != nullptr)
+    {
+        modelSetLayouts = {p_UniformRing->m_SetLayout, p_BindlessTextures->m_SetLayout};
+    }
+    m_ModelGraphicsPipelineLayout = p_RenderSystem->BuildPipelineLayout(0, nullptr, modelSetLayouts.data(), modelSetLayouts.size());
     p_ModelGraphcisPipelineConfig = new PipelineConfigInfo();
     p_RenderSystem->MakeDefaultGraphicsPipelineConfigInfo(p_ModelGraphcisPipelineConfig,
                                                           m_ModelGraphicsPipelineLayout,
@@ -270,16 +332,37 @@ void VulkanExperiment::CreateGraphicsPipelines()
                                                           0,
                                                           VulkanModel::GetBindingDescription(),
                                                           VulkanModel::GetAttributeDescription());
-    m_ModelGraphicsPipeline = p_RenderSystem->BuildShaderStage(SHADER_DIR "Basic_Vert.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
-                                  .BuildShaderStage(SHADER_DIR "Basic_Frag.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+    m_ModelGraphicsPipeline = p_RenderSystem->BuildShaderStage(SHADER_DIR "Object_Vert.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
+                                  .BuildShaderStage(p_BindlessTextures != nullptr ? SHADER_DIR "Bindless_Frag.frag.spv" : SHADER_DIR "Basic_Frag.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
                                   .BuildGraphicsPipeline(p_ModelGraphcisPipelineConfig);
+
+    // Instanced graphics pipeline, the instance transform is read from binding 1 and the texture from its own set 1
+    m_InstancedPipelineLayout = p_RenderSystem->BuildPipelineLayout(0, nullptr, m_DescriptorSetLayouts.data(), m_DescriptorSetLayouts.size());
+    p_InstancedPipelineConfig = new PipelineConfigInfo();
+    p_RenderSystem->MakeDefaultGraphicsPipelineConfigInfo(p_InstancedPipelineConfig,
+                                                          m_InstancedPipelineLayout,
+                                                          p_SwapChain->GetRenderPass(),
+                                                          0,
+                                                          VulkanModel::GetInstanceBindingDescription(1),
+                                                          VulkanModel::GetInstanceAttributeDescription(1));
+    m_InstancedPipeline = p_RenderSystem->BuildShaderStage(SHADER_DIR "Instanced_Vert.vert.spv", VK_SHADER_STAGE_VERTEX_BIT)
+                              .BuildShaderStage(SHADER_DIR "Basic_Frag.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+                              .BuildGraphicsPipeline(p_InstancedPipelineConfig);
 }
 
 void VulkanExperiment::Prepare()
 {
     VulkanRenderer::Prepare();
     CreateRenderPasses();
+
+    // Without the pools every requested fence or semaphore would be created and destroyed once
+    uint32_t createCount = p_Device->GetSyncObjectCreateCount();
+    uint32_t reuseCount = p_Device->GetSyncObjectReuseCount();
     LoadModels();
+    createCount = p_Device->GetSyncObjectCreateCount() - createCount;
+    reuseCount = p_Device->GetSyncObjectReuseCount() - reuseCount;
+    INFO("Scene load requested %u fences and semaphores, the pools created %u of them\n", createCount + reuseCount, createCount);
+
     CreateDescriptorPool();
     CreateGraphicsPipelines();
     PrepareUI(p_SwapChain->GetRenderPass(), 0);
@@ -303,24 +386,26 @@ void VulkanExperiment::Render()
     if (cmdBuffer != VK_NULL_HANDLE)
     {
         /*============================== Update uniforms ==============================*/
-        // Update current global uniform buffer
+        // Push camera matrices to the uniform ring, the ring is flushed once when the frame is submitted
         p_Camera->UpdateViewMat();
         p_Camera->UpdatePerspectiveMat(opm::MATH_PI_4, static_cast<float>(m_Width) / static_cast<float>(m_Height), 0.1, 100.0);
-        UpdateUniformBuffers(&p_Camera->m_CameraUniformBuffers[p_SwapChain->m_CurrentFrame], 1, &p_Camera->GetUniformData());
+        uint32_t cameraOffset = p_UniformRing->Push(p_SwapChain->m_CurrentFrame, &p_Camera->GetUniformData(), sizeof(VulkanCamera::Matrix));
 
-        // Update model transform uniform buffer
         // p_Models[0]->Transform({1.0, 1.0, 1.0}, {0.0, 0.0, 0.01}, {0.0, 0.0, 0.0});
         p_Models[1]->Transform({1.0, 1.0, 1.0}, {0.0, 0.0, -0.01}, {0.0, 0.0, 0.0});
-        for (size_t i = 0; i < p_Models.size(); ++i)
-        {
-            opm::mat4 modelMat = p_Models[i]->m_UniqueModelMat.Transpose();
-            UpdateUniformBuffers(&p_Models[i]->m_TransformBuffers[p_SwapChain->m_CurrentFrame], 1, &modelMat);
-        }
 
-        // Update sky box transform uniform buffer
+        // Cull models, draw parameters are only recorded for visible ones
+        m_Frustum.Update(p_Camera->GetProjectionMat(), p_Camera->GetViewMat());
+        m_Frustum.Cull(p_Models.data(), p_Models.size());
+        p_GeometryArena->ResetDraws(p_SwapChain->m_CurrentFrame);
+
+        // Instance transforms are copied only when they changed
+        p_InstancedModel->UpdateInstanceBuffer(p_SwapChain->m_CurrentFrame);
+
+        // Push sky box transform to the uniform ring
         VulkanCamera::Matrix m = p_Camera->GetUniformData();
         m.ViewMat[3] = {0.0, 0.0, 0.0, 1.0};
-        UpdateUniformBuffers(&p_SkyBox->m_TransformBuffers[p_SwapChain->m_CurrentFrame], 1, &m);
+        uint32_t skyBoxOffset = p_UniformRing->Push(p_SwapChain->m_CurrentFrame, &m, sizeof(VulkanCamera::Matrix));
 
         /*============================== Begin render pass ==============================*/
         BeginRenderPass(cmdBuffer, p_SwapChain->GetRenderPass());
@@ -329,22 +414,51 @@ void VulkanExperiment::Render()
 
         // Sky box
         vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_SkyBoxPipeline);
-        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_SkyBoxPipelineLayout, 0, 1, &p_SkyBox->m_TransformSets[p_SwapChain->m_CurrentFrame], 0, nullptr);
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_SkyBoxPipelineLayout, 0, 1, &p_UniformRing->m_Sets[p_SwapChain->m_CurrentFrame], 1, &skyBoxOffset);
         vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_SkyBoxPipelineLayout, 1, 1, &p_SkyBox->m_TextureSets[p_SwapChain->m_CurrentFrame], 0, nullptr);
         p_SkyBox->Bind(cmdBuffer);
         p_SkyBox->Draw(cmdBuffer);
 
         // Objects
         vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ModelGraphicsPipeline);
-        // Camera descriptor
-        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ModelGraphicsPipelineLayout, 0, 1, &p_Camera->m_CameraSets[p_SwapChain->m_CurrentFrame], 0, nullptr);
+        // Camera and draw parameters share set 0, bound once for all models
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ModelGraphicsPipelineLayout, 0, 1, &p_UniformRing->m_Sets[p_SwapChain->m_CurrentFrame], 1, &cameraOffset);
+        p_GeometryArena->Bind(cmdBuffer);
+        // Draw parameters of visible models, shaders index them with gl_InstanceIndex which is the firstInstance of each command
+        std::vector<size_t> drawnModels = {};
         for (size_t i = 0; i < p_Models.size(); ++i)
         {
-            vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ModelGraphicsPipelineLayout, 1, 1, &p_Models[i]->m_TransformSets[p_SwapChain->m_CurrentFrame], 0, nullptr);
-            vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ModelGraphicsPipelineLayout, 2, 1, &p_Models[i]->m_TextureSets[p_SwapChain->m_CurrentFrame], 0, nullptr);
-            p_Models[i]->Bind(cmdBuffer);
-            p_Models[i]->Draw(cmdBuffer);
+            if (!p_Models[i]->m_Visible)
+            {
+                continue;
+            }
+            MarkTexturesUsed(m_TextureHandles[i]);
+            uint32_t textureIndex = p_BindlessTextures != nullptr ? m_TextureIndices[i] : static_cast<uint32_t>(i);
+            p_GeometryArena->AddDraw(p_SwapChain->m_CurrentFrame, p_Models[i]->m_MeshIndex, p_Models[i]->m_UniqueModelMat.Transpose(), textureIndex);
+            drawnModels.push_back(i);
+        }
+        // With bindless textures the texture table is bound once and the whole scene is one indirect call,
+        // otherwise each model binds its own texture set before its single command
+        if (p_BindlessTextures != nullptr)
+        {
+            p_BindlessTextures->Bind(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ModelGraphicsPipelineLayout, 1, p_SwapChain->m_CurrentFrame);
+            p_GeometryArena->DrawIndirect(cmdBuffer, p_SwapChain->m_CurrentFrame);
         }
+        else
+        {
+            // Draws were recorded in order after ResetDraws, so draw j belongs to drawnModels[j]
+            for (size_t j = 0; j < drawnModels.size(); ++j)
+            {
+                vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ModelGraphicsPipelineLayout, 1, 1, &p_Models[drawnModels[j]]->m_TextureSets[p_SwapChain->m_CurrentFrame], 0, nullptr);
+                p_GeometryArena->DrawIndirect(cmdBuffer, p_SwapChain->m_CurrentFrame, static_cast<uint32_t>(j), 1);
+            }
+        }
+
+        // Instanced cubes, the camera set stays bound since set 0 and the (empty) push constant ranges of both layouts match
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_InstancedPipeline);
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_InstancedPipelineLayout, 1, 1, &p_InstancedModel->m_TextureSets[p_SwapChain->m_CurrentFrame], 0, nullptr);
+        p_InstancedModel->BindInstances(cmdBuffer, p_SwapChain->m_CurrentFrame);
+        p_InstancedModel->DrawInstances(cmdBuffer);
 
         /*============================== End render pass ==============================*/
         EndRenderPass(cmdBuffer);
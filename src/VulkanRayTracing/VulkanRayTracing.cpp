@@ -225,7 +225,7 @@ void VulkanComputeRayTracing::CreateStorageImages()
         samplerCI.maxLod = static_cast<float>(imageCI.mipLevels);
         samplerCI.minLod = 0.0f;
         samplerCI.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-        CHECK_VK_RESULT(vkCreateSampler(p_Device->GetDevice(), &samplerCI, p_Allocator, &m_StorageTextures[i].Sampler));
+        p_Device->CreateSampler(&samplerCI, &m_StorageTextures[i]);
 
         VkImageViewCreateInfo viewCI = vkinfo::ImageViewInfo();
         viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;